@@ -2,6 +2,8 @@
 #include <QTextBlock>
 
 #include "TestAnnotator.h"
+#include "codetextedit/KeywordScanner.h"
+#include "codetextedit/LineIndex.h"
 
 using codetextedit::Annotation;
 
@@ -10,15 +12,20 @@ TestAnnotator::TestAnnotator(QObject* parent) : QObject(parent)
 }
 
 void TestAnnotator::prepareAnalysis(QStringList lines)
+{
+    prepareAnalysis(lines, LineTokens());
+}
+
+void TestAnnotator::prepareAnalysis(QStringList lines, LineTokens tokens)
 {
     m_lines = lines;
+    m_tokens = tokens;
     m_currentLine = 0;
 }
 
 bool TestAnnotator::analyzeStep()
 {
-    QString line = m_lines[m_currentLine];
-    scanLine(m_currentLine, line);
+    m_annotationMap[ m_currentLine ] = annotateCommand(command(m_currentLine));
 
     ++ m_currentLine;
 
@@ -26,89 +33,127 @@ bool TestAnnotator::analyzeStep()
     return hasMore;
 }
 
+bool TestAnnotator::analyzeRange(int first, int count, AnnotationContainer *results)
+{
+    for (int i = 0; i < count; ++i)
+        results[i] = annotateCommand(command(first + i));
+
+    return true;
+}
+
+QString TestAnnotator::solutionHelp(const QString &helpKey) const
+{
+    // Shared by every annotation with the key, instead of a copy in each of them.
+    static const QHash<QString, QString> help = {
+        {"XX.1", "This is an XX Error 1"},
+        {"XX.2", "This is an XX command 2"},
+        {"XX.3", "This is an XX command 3"},
+        {"XX.4", "This is an XX command 4"},
+        {"ZZ.1", "This is an ZZ Error 1"},
+        {"ZZ.2", "This is an ZZ command 2"},
+        {"ZZ.3", "This is an ZZ command 3"},
+        {"ZZ.4", "This is an ZZ command 4"},
+        {"YY.1", "This is a YY command"},
+    };
+    return help.value(helpKey);
+}
+
 AnnotationMap TestAnnotator::analysisResult()
 {
-    auto copy = m_annotationMap;
-    m_annotationMap.clear();
-    return copy;
+    AnnotationMap result;
+    result.swap(m_annotationMap);
+    return result;
+}
+
+AnnotationContainer TestAnnotator::scanLine(const QString& line)
+{
+    // Only the command is looked at, as a view of the line instead of a split copy.
+    return annotateCommand(firstField(line, ','));
+}
+
+QStringRef TestAnnotator::command(int line) const
+{
+    // The editor's tokens already give the command, the line is not split again.
+    if (m_tokens.isEmpty())
+        return firstField(m_lines[line], ',');
+    return KeywordScanner::firstCommand(m_lines[line], m_tokens[line]);
 }
 
-void TestAnnotator::scanLine(int lineNum, QString line)
+AnnotationContainer TestAnnotator::annotateCommand(const QStringRef& command)
 {
-    QStringList list = line.split(',');
     AnnotationContainer container;
 
-    if (list[0]=="XX")
+    if (command==QLatin1String("XX"))
     {
         Annotation *annotation = new Annotation;
         annotation->setCategory(Annotation::CATEGORY_Unspecified);
-        annotation->setSolutionHelp("This is an XX Error 1");
+        annotation->setHelpKey("XX.1");
         annotation->setMessage("This is an XX message 1");
         annotation->setAlertColor("green");
         container.append(annotation);
 
         annotation = new Annotation;
         annotation->setCategory(Annotation::CATEGORY_Hint);
-        annotation->setSolutionHelp("This is an XX command 2");
+        annotation->setHelpKey("XX.2");
         annotation->setMessage("This is an XX message 2  to be or not to be");
         annotation->setAlertColor("#FF00FF");
         container.append(annotation);
 
         annotation = new Annotation;
         annotation->setCategory(Annotation::CATEGORY_Warning);
-        annotation->setSolutionHelp("This is an XX command 3");
+        annotation->setHelpKey("XX.3");
         annotation->setMessage("This is an XX message 3");
         annotation->setAlertColor("blue");
         container.append(annotation);
 
         annotation = new Annotation;
         annotation->setCategory(Annotation::CATEGORY_Error);
-        annotation->setSolutionHelp("This is an XX command 4");
+        annotation->setHelpKey("XX.4");
         annotation->setMessage("This is an XX message 4");
         annotation->setAlertColor("red");
         container.append(annotation);
     }
 
-    if (list[0]=="ZZ")
+    if (command==QLatin1String("ZZ"))
     {
         Annotation *annotation = new Annotation;
         annotation->setCategory(Annotation::CATEGORY_Unspecified);
-        annotation->setSolutionHelp("This is an ZZ Error 1");
+        annotation->setHelpKey("ZZ.1");
         annotation->setMessage("This is an ZZ message 1");
         annotation->setAlertColor("yellow");
         container.append(annotation);
 
         annotation = new Annotation;
         annotation->setCategory(Annotation::CATEGORY_Hint);
-        annotation->setSolutionHelp("This is an ZZ command 2");
+        annotation->setHelpKey("ZZ.2");
         annotation->setMessage("This is an ZZ message 2  to be or not to be");
         annotation->setAlertColor("magenta");
         container.append(annotation);
 
         annotation = new Annotation;
         annotation->setCategory(Annotation::CATEGORY_Warning);
-        annotation->setSolutionHelp("This is an ZZ command 3");
+        annotation->setHelpKey("ZZ.3");
         annotation->setMessage("This is an ZZ message 3");
         annotation->setAlertColor("#00FF00");
         container.append(annotation);
 
         annotation = new Annotation;
         annotation->setCategory(Annotation::CATEGORY_Error);
-        annotation->setSolutionHelp("This is an ZZ command 4");
+        annotation->setHelpKey("ZZ.4");
         annotation->setMessage("This is an ZZ message 4");
         annotation->setAlertColor("red");
         container.append(annotation);
     }
 
-    else if (list[0]=="YY")
+    else if (command==QLatin1String("YY"))
     {
         Annotation *annotation = new Annotation;
 
         annotation->setCategory(Annotation::CATEGORY_Hint);
-        annotation->setSolutionHelp("This is a YY command");
+        annotation->setHelpKey("YY.1");
         annotation->setMessage("This is a YY message");
         annotation->setAlertColor("blue");
         container.append(annotation);
     }
-    m_annotationMap[ lineNum ] = container;
+    return container;
 }
@@ -3,6 +3,7 @@
 
 #include <QList>
 #include <QMap>
+#include <QHash>
 #include <QTextDocument>
 #include "codetextedit/Annotation.h"
 
@@ -11,21 +12,28 @@ using namespace codetextedit;
 
 
 
-class TestAnnotator : public QObject, public codetextedit::Annotator
+class TestAnnotator : public QObject, public codetextedit::Annotator, public codetextedit::SolutionHelpProvider
 {
 public:
     explicit TestAnnotator(QObject *parent = nullptr);
     virtual ~TestAnnotator() = default;
 
     void prepareAnalysis(QStringList lines) override;
+    void prepareAnalysis(QStringList lines, LineTokens tokens) override;
     bool analyzeStep() override;
+    bool analyzeRange(int first, int count, AnnotationContainer* results) override;
     AnnotationMap analysisResult() override;
+    QString version() const override {return "2";}
+    QString solutionHelp(const QString& helpKey) const override;
 
-    void scanLine(int lineNum, QString line);
-
+    AnnotationContainer scanLine(const QString& line);
 
 private:
+    QStringRef command(int line) const;
+    AnnotationContainer annotateCommand(const QStringRef& command);
+
     QStringList m_lines;
+    LineTokens m_tokens;
     int m_currentLine;
     AnnotationMap m_annotationMap;
 };
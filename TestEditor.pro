@@ -1,11 +1,11 @@
-QT += widgets qml quick quickwidgets
-CONFIG += c++11
+# The demo editor, the annotator helper process, the lint tool and the unit tests.
+# "make check" runs the unit tests.
+TEMPLATE = subdirs
 
-include(codetextedit/CodeTextEdit.pri)
+SUBDIRS += \
+    editor \
+    annotatorhost \
+    lint \
+    tests \
 
-HEADERS += \
-    TestAnnotator.h \
-    
-SOURCES += \
-    TestAnnotator.cpp \
-    main.cpp \
+annotatorhost.file = annotatorhost/TestAnnotatorHost.pro
@@ -0,0 +1,23 @@
+# Stand-in annotator helper process for RemoteAnnotator, hosting TestAnnotator.
+QT += gui network
+CONFIG += c++11 console
+CONFIG -= app_bundle
+
+INCLUDEPATH += $$PWD/..
+
+HEADERS += \
+    ../TestAnnotator.h \
+    ../codetextedit/Annotation.h \
+    ../codetextedit/AnnotatorHost.h \
+    ../codetextedit/AnnotatorIpc.h \
+    ../codetextedit/KeywordScanner.h \
+    ../codetextedit/KeywordSpan.h \
+    ../codetextedit/LineIndex.h \
+
+SOURCES += \
+    ../TestAnnotator.cpp \
+    ../codetextedit/AnnotatorHost.cpp \
+    ../codetextedit/AnnotatorIpc.cpp \
+    ../codetextedit/KeywordScanner.cpp \
+    ../codetextedit/LineIndex.cpp \
+    main.cpp \
@@ -0,0 +1,27 @@
+#include "codetextedit/AnnotatorHost.h"
+#include "TestAnnotator.h"
+
+#include <QCoreApplication>
+#include <QDebug>
+
+using namespace codetextedit;
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+
+    QString serverName = AnnotatorHost::serverName(app.arguments());
+    if(serverName.isEmpty()) {
+        qCritical() << "Usage: TestAnnotatorHost --server <name>";
+        return 1;
+    }
+
+    TestAnnotator annotator;
+    AnnotatorHost host(&annotator);
+    QObject::connect(&host, &AnnotatorHost::finished, &app, &QCoreApplication::quit);
+
+    if(! host.connectToEditor(serverName))
+        return 1;
+
+    return app.exec();
+}
@@ -14,6 +14,8 @@ CodeTextEdit is free software dual licensed under the GNU LGPL or MIT License.
 #include <QColor>
 #include <QTextDocument>
 
+#include "KeywordSpan.h"
+
 namespace codetextedit
 {
     class Annotation
@@ -33,17 +35,25 @@ namespace codetextedit
         QColor      m_alertColor;
         QString     m_message;
         QString     m_solutionHelp;
+        QString     m_helpKey;
+        QString     m_source;
 
     public:
         Category    category() const {return m_category;}
         QColor      alertColor() const {return m_alertColor;}
         QString     message() const {return m_message;}
         QString     solutionHelp() const {return m_solutionHelp;}
+        /// Compact stand in for the solution help, which is then fetched when it is shown.
+        QString     helpKey() const {return m_helpKey;}
+        /// Name of the annotator which produced it, set by the editor.
+        QString     source() const {return m_source;}
 
         void setCategory(Category category) {m_category=category;}
         void setAlertColor(const QColor& color) {m_alertColor = color;}
         void setMessage(const QString& message) {m_message = message;}
         void setSolutionHelp(const QString& help) {m_solutionHelp=help;}
+        void setHelpKey(const QString& key) {m_helpKey=key;}
+        void setSource(const QString& source) {m_source=source;}
 
         Annotation() = default;
         virtual ~Annotation() = default;
@@ -53,6 +63,18 @@ namespace codetextedit
     using AnnotationContainer = QList<Annotation*>;
     using AnnotationMap = QMap<LineNumber, AnnotationContainer>;
 
+    ///
+    /// \brief Supplies solution help for annotations which only carry a help key.
+    ///
+    class SolutionHelpProvider
+    {
+    public:
+        virtual ~SolutionHelpProvider() {}
+
+        /// Help text for the key, empty if the provider does not know it.
+        virtual QString solutionHelp(const QString& helpKey) const = 0;
+    };
+
     class Annotator
     {
     public:
@@ -62,12 +84,35 @@ namespace codetextedit
         /// Copies the source to a local variable
         virtual void prepareAnalysis(QStringList lines) = 0;
 
+        /// Like prepareAnalysis(), with the lexer's tokens of every line, see KeywordScanner.
+        /// Called instead of it where the lines were lexed already, e.g. for highlighting, so
+        /// a line can be classified from its tokens instead of being split again. The default
+        /// ignores the tokens.
+        virtual void prepareAnalysis(QStringList lines, LineTokens /*tokens*/) {prepareAnalysis(lines);}
+
         /// True if finished
         virtual bool analyzeStep() = 0;
 
+        /// Optional batched form of analyzeStep(). Analyzes lines [first, first + count) of the
+        /// prepared source into results[0] .. results[count - 1], a buffer owned by the caller,
+        /// and transfers ownership of the annotations. When used, analysisResult() is not called.
+        /// After an edit only the changed lines are requested, the ranges may skip lines.
+        /// Returns false if only analyzeStep() is supported.
+        virtual bool analyzeRange(int /*first*/, int /*count*/, AnnotationContainer* /*results*/) {return false;}
+
         /// Retrieve the result. Transfers ownership of all heap allocated objects to caller.
         virtual AnnotationMap analysisResult() = 0;
 
+        /// Identifies the rule set. Cached results are discarded when it changes.
+        virtual QString version() const {return QString();}
+
+        /// Called on the analysis thread just before it exits. Release thread affine resources here.
+        virtual void analysisThreadFinished() {}
+
+        /// Help text for an annotation's help key. Called on the GUI thread when a popup opens,
+        /// possibly while an analysis runs.
+        virtual QString solutionHelp(const QString& /*helpKey*/) const {return QString();}
+
     protected:
     };
 
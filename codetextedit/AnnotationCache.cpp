@@ -0,0 +1,334 @@
+/***********************************************************************
+The CodeTextEditor provides an editor showing live hints and annotations.
+
+Copyright (c) 2020 Brian Newham <seaweedsolutionsltd@gmail.com>.
+
+CodeTextEdit is free software dual licensed under the GNU LGPL or MIT License.
+***********************************************************************/
+
+#include "AnnotationCache.h"
+
+#include <QCryptographicHash>
+#include <QStandardPaths>
+#include <QFileInfo>
+#include <QSaveFile>
+#include <QFile>
+#include <QDir>
+#include <QHash>
+#include <QDebug>
+
+#include <cstring>
+
+namespace codetextedit
+{
+
+namespace
+{
+    // The file is written in native byte order. A cache written on a machine with the
+    // other byte order fails the magic check and is simply treated as a miss.
+    const quint32 cacheMagic = 0x43455443;   // "CTEC"
+    const quint32 cacheFormatVersion = 3;
+    const int hashSize = 20;                 // SHA-1
+
+    struct CacheHeader
+    {
+        quint32 magic;
+        quint32 formatVersion;
+        quint32 filePath;                    // String table indexes of the key
+        quint32 annotatorVersion;
+        quint32 keywordsVersion;
+        quint32 annotationCount;
+        quint32 runCount;
+        quint32 stringCount;
+        quint32 stringDataSize;              // In UTF-16 code units
+        char    contentHash[hashSize];
+    };
+
+    struct AnnotationRecord
+    {
+        qint32  line;
+        quint32 rgba;
+        quint32 message;
+        quint32 solutionHelp;
+        quint32 helpKey;
+        quint32 category;
+        quint32 source;
+    };
+
+    struct FormatRunRecord
+    {
+        qint32  line;
+        qint32  start;
+        qint32  length;
+        qint32  formatId;
+    };
+
+    // File layout, every section 4 byte aligned:
+    //   CacheHeader
+    //   AnnotationRecord[annotationCount]
+    //   FormatRunRecord[runCount]
+    //   quint32 stringOffsets[stringCount + 1]
+    //   ushort  stringData[stringDataSize]
+
+    class StringTable
+    {
+    public:
+        quint32 add(const QString& string)
+        {
+            auto it = m_indexes.constFind(string);
+            if(it != m_indexes.constEnd())
+                return it.value();
+
+            quint32 index = quint32(m_offsets.size());
+            m_indexes.insert(string, index);
+            m_offsets.append(quint32(m_data.size()));
+            m_data.append(string);
+            return index;
+        }
+
+        quint32 count() const {return quint32(m_offsets.size());}
+        quint32 dataSize() const {return quint32(m_data.size());}
+
+        void write(QByteArray& out) const
+        {
+            QVector<quint32> offsets = m_offsets;
+            offsets.append(quint32(m_data.size()));
+            out.append(reinterpret_cast<const char*>(offsets.constData()), offsets.size() * int(sizeof(quint32)));
+            out.append(reinterpret_cast<const char*>(m_data.utf16()), m_data.size() * int(sizeof(ushort)));
+        }
+
+    private:
+        QHash<QString, quint32> m_indexes;
+        QVector<quint32>        m_offsets;
+        QString                 m_data;
+    };
+
+    class StringReader
+    {
+    public:
+        StringReader(const quint32* offsets, const ushort* data, quint32 count)
+            : m_offsets(offsets), m_data(data), m_strings(int(count)), m_read(int(count), false) {}
+
+        bool isValid(quint32 index) const {return index < quint32(m_strings.size());}
+
+        // Identical messages are decoded once and then shared.
+        QString at(quint32 index)
+        {
+            if(! m_read[int(index)]) {
+                m_strings[int(index)] = QString(reinterpret_cast<const QChar*>(m_data + m_offsets[index]),
+                                                int(m_offsets[index + 1] - m_offsets[index]));
+                m_read[int(index)] = true;
+            }
+            return m_strings[int(index)];
+        }
+
+    private:
+        const quint32*   m_offsets;
+        const ushort*    m_data;
+        QVector<QString> m_strings;
+        QVector<bool>    m_read;
+    };
+
+    QByteArray encode(const AnnotationCache::Key& key, const AnnotationMap& annotations, const FormatRunMap& formats)
+    {
+        StringTable strings;
+        QVector<AnnotationRecord> annotationRecords;
+        QVector<FormatRunRecord> runRecords;
+
+        CacheHeader header;
+        std::memset(&header, 0, sizeof(header));
+        header.magic = cacheMagic;
+        header.formatVersion = cacheFormatVersion;
+        header.filePath = strings.add(key.filePath);
+        header.annotatorVersion = strings.add(key.annotatorVersion);
+        header.keywordsVersion = strings.add(key.keywordsVersion);
+        std::memcpy(header.contentHash, key.contentHash.constData(), size_t(qMin(key.contentHash.size(), hashSize)));
+
+        for(auto it = annotations.constBegin(); it != annotations.constEnd(); ++it) {
+            for(const Annotation* annotation : it.value()) {
+                AnnotationRecord record;
+                record.line = it.key();
+                record.rgba = annotation->alertColor().rgba();
+                record.message = strings.add(annotation->message());
+                record.solutionHelp = strings.add(annotation->solutionHelp());
+                record.helpKey = strings.add(annotation->helpKey());
+                record.category = quint32(annotation->category());
+                record.source = strings.add(annotation->source());
+                annotationRecords.append(record);
+            }
+        }
+
+        for(auto it = formats.constBegin(); it != formats.constEnd(); ++it) {
+            for(const FormatRun& run : it.value()) {
+                FormatRunRecord record;
+                record.line = it.key();
+                record.start = run.start;
+                record.length = run.length;
+                record.formatId = run.formatId;
+                runRecords.append(record);
+            }
+        }
+
+        header.annotationCount = quint32(annotationRecords.size());
+        header.runCount = quint32(runRecords.size());
+        header.stringCount = strings.count();
+        header.stringDataSize = strings.dataSize();
+
+        QByteArray out;
+        out.append(reinterpret_cast<const char*>(&header), int(sizeof(header)));
+        out.append(reinterpret_cast<const char*>(annotationRecords.constData()), annotationRecords.size() * int(sizeof(AnnotationRecord)));
+        out.append(reinterpret_cast<const char*>(runRecords.constData()), runRecords.size() * int(sizeof(FormatRunRecord)));
+        strings.write(out);
+        return out;
+    }
+
+    bool decode(const uchar* data, qint64 size, const AnnotationCache::Key& key, AnnotationMap& annotations, FormatRunMap& formats)
+    {
+        if(size < qint64(sizeof(CacheHeader)))
+            return false;
+
+        const CacheHeader* header = reinterpret_cast<const CacheHeader*>(data);
+        if(header->magic != cacheMagic || header->formatVersion != cacheFormatVersion)
+            return false;
+
+        qint64 expected = qint64(sizeof(CacheHeader))
+                        + qint64(header->annotationCount) * qint64(sizeof(AnnotationRecord))
+                        + qint64(header->runCount) * qint64(sizeof(FormatRunRecord))
+                        + (qint64(header->stringCount) + 1) * qint64(sizeof(quint32))
+                        + qint64(header->stringDataSize) * qint64(sizeof(ushort));
+        if(expected != size)
+            return false;
+
+        auto annotationRecords = reinterpret_cast<const AnnotationRecord*>(data + sizeof(CacheHeader));
+        auto runRecords = reinterpret_cast<const FormatRunRecord*>(annotationRecords + header->annotationCount);
+        auto stringOffsets = reinterpret_cast<const quint32*>(runRecords + header->runCount);
+        auto stringData = reinterpret_cast<const ushort*>(stringOffsets + header->stringCount + 1);
+
+        for(quint32 i = 0; i < header->stringCount; ++i) {
+            if(stringOffsets[i] > stringOffsets[i + 1])
+                return false;
+        }
+        if(stringOffsets[header->stringCount] > header->stringDataSize)
+            return false;
+
+        StringReader strings(stringOffsets, stringData, header->stringCount);
+        if(! strings.isValid(header->filePath) || ! strings.isValid(header->annotatorVersion) || ! strings.isValid(header->keywordsVersion))
+            return false;
+
+        if(strings.at(header->filePath) != key.filePath
+                || strings.at(header->annotatorVersion) != key.annotatorVersion
+                || strings.at(header->keywordsVersion) != key.keywordsVersion
+                || key.contentHash.size() != hashSize
+                || std::memcmp(header->contentHash, key.contentHash.constData(), hashSize) != 0)
+            return false;
+
+        for(quint32 i = 0; i < header->annotationCount; ++i) {
+            const AnnotationRecord& record = annotationRecords[i];
+            if(! strings.isValid(record.message) || ! strings.isValid(record.solutionHelp) || ! strings.isValid(record.helpKey)
+                    || ! strings.isValid(record.source) || record.category > Annotation::CATEGORY_Error) {
+                for(auto container : annotations)
+                    qDeleteAll(container);
+                annotations.clear();
+                return false;
+            }
+
+            Annotation* annotation = new Annotation;
+            annotation->setCategory(Annotation::Category(record.category));
+            annotation->setAlertColor(QColor::fromRgba(record.rgba));
+            annotation->setMessage(strings.at(record.message));
+            annotation->setSolutionHelp(strings.at(record.solutionHelp));
+            annotation->setHelpKey(strings.at(record.helpKey));
+            annotation->setSource(strings.at(record.source));
+            annotations[record.line].append(annotation);
+        }
+
+        for(quint32 i = 0; i < header->runCount; ++i) {
+            const FormatRunRecord& record = runRecords[i];
+            FormatRun run;
+            run.start = record.start;
+            run.length = record.length;
+            run.formatId = record.formatId;
+            formats[record.line].append(run);
+        }
+
+        return true;
+    }
+}
+
+AnnotationCache::AnnotationCache(const QString &directory)
+    : m_directory(directory)
+{
+    if(m_directory.isEmpty()) {
+        QString base = QStandardPaths::writableLocation(QStandardPaths::CacheLocation);
+        if(base.isEmpty())
+            base = QDir::tempPath();
+        m_directory = base + "/codetextedit";
+    }
+}
+
+QByteArray AnnotationCache::contentHash(const QByteArray &content)
+{
+    return QCryptographicHash::hash(content, QCryptographicHash::Sha1);
+}
+
+bool AnnotationCache::load(const Key &key, AnnotationMap &annotations, FormatRunMap &formats) const
+{
+    QFile file(cacheFilePath(key.filePath));
+    if(! file.open(QFile::ReadOnly))
+        return false;
+
+    qint64 size = file.size();
+    if(size <= 0)
+        return false;
+
+    uchar* data = file.map(0, size);
+    if(data == nullptr)
+        return false;
+
+    bool ok = decode(data, size, key, annotations, formats);
+    file.unmap(data);
+
+    if(! ok)
+        formats.clear();
+
+    return ok;
+}
+
+bool AnnotationCache::store(const Key &key, const AnnotationMap &annotations, const FormatRunMap &formats) const
+{
+    if(! QDir().mkpath(m_directory))
+        return false;
+
+    QByteArray content = encode(key, annotations, formats);
+    QString path = cacheFilePath(key.filePath);
+
+    QFile existing(path);
+    if(existing.size() == content.size() && existing.open(QFile::ReadOnly)) {
+        if(existing.readAll() == content)
+            return true;
+        existing.close();
+    }
+
+    QSaveFile file(path);
+    if(! file.open(QFile::WriteOnly)) {
+        qWarning() << "Cannot write annotation cache" << path;
+        return false;
+    }
+
+    file.write(content);
+    return file.commit();
+}
+
+void AnnotationCache::remove(const QString &filePath) const
+{
+    QFile::remove(cacheFilePath(filePath));
+}
+
+QString AnnotationCache::cacheFilePath(const QString &filePath) const
+{
+    QString absolutePath = QFileInfo(filePath).absoluteFilePath();
+    QByteArray name = QCryptographicHash::hash(absolutePath.toUtf8(), QCryptographicHash::Sha1).toHex();
+    return m_directory + '/' + QString::fromLatin1(name) + ".ctec";
+}
+
+} // namespace codetextedit
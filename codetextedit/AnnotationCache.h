@@ -0,0 +1,75 @@
+/***********************************************************************
+The CodeTextEditor provides an editor showing live hints and annotations.
+
+Copyright (c) 2020 Brian Newham <seaweedsolutionsltd@gmail.com>.
+
+CodeTextEdit is free software dual licensed under the GNU LGPL or MIT License.
+***********************************************************************/
+
+#ifndef ANNOTATIONCACHE_H
+#define ANNOTATIONCACHE_H
+
+#include <QString>
+#include <QByteArray>
+#include <QVector>
+#include <QMap>
+
+#include "Annotation.h"
+
+namespace codetextedit
+{
+    ///
+    /// \brief One highlighter format applied to a span of a line.
+    ///
+    struct FormatRun
+    {
+        int start = 0;
+        int length = 0;
+        int formatId = -1;
+    };
+
+    using FormatRunList = QVector<FormatRun>;
+    using FormatRunMap = QMap<LineNumber, FormatRunList>;
+
+    ///
+    /// \brief On-disk cache of analysis results and highlight formats.
+    ///
+    /// Each source file maps to one binary file in the cache directory. The file is
+    /// memory mapped on load and only accepted if every field of the key matches, so
+    /// an edited file, a new annotator or a new keyword set simply miss the cache.
+    ///
+    class AnnotationCache
+    {
+    public:
+        struct Key
+        {
+            QString     filePath;
+            QByteArray  contentHash;
+            QString     annotatorVersion;
+            QString     keywordsVersion;
+        };
+
+        /// An empty directory selects the standard per-user cache location.
+        explicit AnnotationCache(const QString& directory = QString());
+
+        QString directory() const {return m_directory;}
+
+        static QByteArray contentHash(const QByteArray& content);
+
+        /// Fills annotations and formats from the cache. Caller owns the annotations.
+        bool load(const Key& key, AnnotationMap& annotations, FormatRunMap& formats) const;
+
+        /// Writes the entry atomically. Unchanged entries are not rewritten.
+        bool store(const Key& key, const AnnotationMap& annotations, const FormatRunMap& formats) const;
+
+        void remove(const QString& filePath) const;
+
+    private:
+        QString cacheFilePath(const QString& filePath) const;
+
+        QString m_directory;
+    };
+
+} // namespace codetextedit
+
+#endif // ANNOTATIONCACHE_H
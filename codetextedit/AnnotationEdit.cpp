@@ -8,7 +8,12 @@ CodeTextEdit is free software dual licensed under the GNU LGPL or MIT License.
 
 #include "AnnotationEdit.h"
 #include "AnnotationWorker.h"
+#include "SearchWorker.h"
+#include "DocumentSaver.h"
+#include "FileChangeWorker.h"
+#include "LineDiff.h"
 #include "GraphicsAnnotationItem.h"
+#include "LineIndex.h"
 
 #include <QTextDocument>
 #include <QTextBlock>
@@ -18,11 +23,18 @@ CodeTextEdit is free software dual licensed under the GNU LGPL or MIT License.
 #include <QTextCursor>
 #include <QMouseEvent>
 #include <QVBoxLayout>
+#include <QHBoxLayout>
 #include <QLabel>
 #include <QSizePolicy>
 #include <QGraphicsProxyWidget>
 #include <QGroupBox>
 #include <QFontMetrics>
+#include <QFileInfo>
+#include <QSaveFile>
+#include <QTextStream>
+
+#include <algorithm>
+#include <utility>
 
 namespace codetextedit
 {
@@ -32,36 +44,69 @@ static const int fontSize = 10;
 //static const QString fontFamilyAnnotation = "Arial";
 static const QString fontFamilyEditor = "Source Code Pro";
 static const QString fontFamilyAnnotation = "Source Code Pro";
-
-AnnotationDialog::AnnotationDialog(const AnnotationContainer& container, QWidget *parent)
+// Characters read from the document per event loop pass while saving.
+static const int saveChunkChars = 256 * 1024;
+// Only matches on screen get a selection, this bounds the work for very dense results.
+static const int maxFindSelections = 2000;
+// Delays after the last edit before keystroke and idle annotators run.
+static const int keystrokeAnalysisMsecs = 400;
+static const int idleAnalysisMsecs = 2000;
+// Label checks are kept apart from the annotators' results, after all of them.
+static const int symbolSource = BlockData::maxSources - 1;
+static const char* symbolSourceName = "labels";
+
+AnnotationDialog::AnnotationDialog(QWidget *parent)
     : QDialog(parent)
 {
     setWindowFlags(Qt::Popup);
-    QVBoxLayout *layout = new QVBoxLayout(this);
-    for (Annotation* annotation : container)
-    {
-        QColor color = annotation->alertColor();
-        auto hexComponent = [](int color)->QString {return QString("%1").arg(color,2,16,QLatin1Char('0'));};
-        QString hexString = '#' + hexComponent(color.red()) + hexComponent(color.green()) + hexComponent(color.blue());
-        QString colorStr = "color: " + hexString;
-
-        QLabel *label = new QLabel(annotation->message(),this);
-        label->setStyleSheet(colorStr);
-        layout->addWidget(label);
+    m_layout = new QVBoxLayout(this);
+    setLayout(m_layout);
+}
 
-        label = new QLabel(annotation->solutionHelp(),this);
-        label->setStyleSheet(colorStr);
-        layout->addWidget(label);
+void AnnotationDialog::setAnnotations(const AnnotationContainer& container, const QStringList& helpTexts)
+{
+    while (m_entries.count() < container.count())
+    {
+        Entry entry;
+        entry.message = new QLabel(this);
+        entry.help = new QLabel(this);
+        entry.separator = new QLabel("===============", this);
+        m_layout->addWidget(entry.message);
+        m_layout->addWidget(entry.help);
+        m_layout->addWidget(entry.separator);
+        m_entries.append(entry);
+    }
 
-        layout->addWidget(new QLabel("==============="));
+    for (int i=0; i<m_entries.count(); i++)
+    {
+        const Entry& entry = m_entries[i];
+        bool used = i < container.count();
+        entry.message->setVisible(used);
+        entry.help->setVisible(used);
+        entry.separator->setVisible(used);
+        if (!used)
+            continue;
+
+        // A palette colour instead of a style sheet, which would be parsed on every open.
+        QPalette palette = entry.message->palette();
+        palette.setColor(QPalette::WindowText, container[i]->alertColor());
+        entry.message->setPalette(palette);
+        entry.help->setPalette(palette);
+
+        // Named annotators are credited, so the source of each finding is clear.
+        if (container[i]->source().isEmpty())
+            entry.message->setText(container[i]->message());
+        else
+            entry.message->setText(QString("[%1] %2").arg(container[i]->source(), container[i]->message()));
+        entry.help->setText(helpTexts.value(i));
     }
-    setLayout(layout);
+    adjustSize();
 }
 
 AnnotationEdit::AnnotationEdit(Annotator* annotator, CodeTextHighlighter *highlighter, QWidget* parent)
     : QWidget(parent)
     , m_highlighter(highlighter)
-    , m_annotator(annotator)
+    , m_annotationMetrics(QFont(fontFamilyAnnotation,fontSize,QFont::Bold))
 {
     m_splitter = new QSplitter(this);
     m_graphicsScene = new QGraphicsScene(this);
@@ -69,6 +114,7 @@ AnnotationEdit::AnnotationEdit(Annotator* annotator, CodeTextHighlighter *highli
     m_textEdit = new AnnotationTextEdit(m_splitter);
     m_empty = new QWidget(this);
     m_gvContainer = new QWidget(this);
+    m_overviewRuler = new AnnotationOverviewRuler(m_gvContainer);
 
     m_textEdit->setGeometry(0,0,width()*0.6,height());
     m_textEdit->setFont(QFont(fontFamilyEditor,fontSize));
@@ -86,7 +132,12 @@ AnnotationEdit::AnnotationEdit(Annotator* annotator, CodeTextHighlighter *highli
     QVBoxLayout* hbox = new QVBoxLayout(this);
     hbox->setContentsMargins(0,0,0,0);
     hbox->setSpacing(0);
-    hbox->addWidget(m_graphicsView);
+    QHBoxLayout* viewRow = new QHBoxLayout;
+    viewRow->setContentsMargins(0,0,0,0);
+    viewRow->setSpacing(0);
+    viewRow->addWidget(m_graphicsView);
+    viewRow->addWidget(m_overviewRuler);
+    hbox->addLayout(viewRow);
     hbox->addWidget(m_empty);
     m_empty->setMaximumHeight(m_graphicsView->height() - m_graphicsView->viewport()->height());
     m_gvContainer->setLayout(hbox);
@@ -94,9 +145,11 @@ AnnotationEdit::AnnotationEdit(Annotator* annotator, CodeTextHighlighter *highli
     m_splitter->addWidget(m_textEdit);
     m_splitter->addWidget(m_gvContainer);
 
-    connect(m_textEdit->document()->documentLayout(), &QAbstractTextDocumentLayout::update, [this](const QRectF&) { this->updateAnnotations(); });
+    // Layout passes (resizes, font changes, highlighting) only resize the scene, edits are analyzed.
+    connect(m_textEdit->document()->documentLayout(), &QAbstractTextDocumentLayout::documentSizeChanged, this, &AnnotationEdit::synchronizeSceneWithDocument);
+    connect(m_textEdit->document(), &QTextDocument::contentsChange, this, &AnnotationEdit::documentContentsChange);
     connect(m_textEdit, &QTextEdit::textChanged, this, &AnnotationEdit::textChanged);
-    connect(m_textEdit, &QTextEdit::textChanged, this, &AnnotationEdit::updateAnnotations);
+    connect(m_textEdit, &AnnotationTextEdit::blockHeightsChanged, this, &AnnotationEdit::repositionItems);
     connect(m_textEdit, &QTextEdit::cursorPositionChanged, [this]() {
         m_textEdit->clearHighlight();
         GraphicsAnnotationItem::setHighlight(nullptr);
@@ -107,20 +160,43 @@ AnnotationEdit::AnnotationEdit(Annotator* annotator, CodeTextHighlighter *highli
        synchronizeSceneWithDocument();
     });
     connect(m_textEdit, &AnnotationTextEdit::blockHighlighted, [this](int blockNumber) {
-       GraphicsAnnotationItem *item = m_blockToItemMap.value(blockNumber, nullptr);
-       GraphicsAnnotationItem::setHighlight(item);
+       BlockData *data = BlockData::of(m_textEdit->document()->findBlockByNumber(blockNumber));
+       GraphicsAnnotationItem::setHighlight(data != nullptr ? data->item() : nullptr);
     });
     connect(m_graphicsView, &AnnotationGraphicsView::mouseMove, this, &AnnotationEdit::highlightLine);
+    connect(m_overviewRuler, &AnnotationOverviewRuler::positionClicked, this, &AnnotationEdit::overviewPositionClicked);
+    connect(m_textEdit->document(), &QTextDocument::blockCountChanged, m_overviewRuler, &AnnotationOverviewRuler::setLineCount);
+    connect(m_textEdit, &AnnotationTextEdit::lineNumberClicked, this, [this](int blockNumber) { toggleFold(blockNumber); });
     m_textEdit->setFocus();
 
     m_highlighter->setDocument(m_textEdit->document());
+    m_blockCount = m_textEdit->document()->blockCount();
+    m_summaryTree.reset(m_blockCount);
 
-    m_annotationRefreshTimer.setInterval(400);
+    m_annotationRefreshTimer.setInterval(keystrokeAnalysisMsecs);
     m_annotationRefreshTimer.setSingleShot(true);
-    connect(&m_annotationRefreshTimer, &QTimer::timeout, this, &AnnotationEdit::refreshAnnotations);
+    connect(&m_annotationRefreshTimer, &QTimer::timeout, [this]() { refreshAnnotations(SCHEDULE_Keystroke); });
+    m_idleRefreshTimer.setInterval(idleAnalysisMsecs);
+    m_idleRefreshTimer.setSingleShot(true);
+    connect(&m_idleRefreshTimer, &QTimer::timeout, [this]() { refreshAnnotations(SCHEDULE_Idle); });
+
+    addAnnotator(annotator, QString(), SCHEDULE_Keystroke);
+
+    m_findRestartTimer.setInterval(250);
+    m_findRestartTimer.setSingleShot(true);
+    connect(&m_findRestartTimer, &QTimer::timeout, this, &AnnotationEdit::startFind);
 
-    m_annotationWorker = new AnnotationWorker(m_annotator, this);
-    connect(m_annotationWorker, &AnnotationWorker::analyzed, this, &AnnotationEdit::rebuildAnnotations);
+    // Tools regenerating a file often write it in several steps.
+    m_fileChangeTimer.setInterval(200);
+    m_fileChangeTimer.setSingleShot(true);
+    connect(&m_fileChangeTimer, &QTimer::timeout, this, &AnnotationEdit::checkFileOnDisk);
+    connect(&m_fileWatcher, &QFileSystemWatcher::fileChanged, [this]() { m_fileChangeTimer.start(); });
+
+    m_searchWorker = new SearchWorker(this);
+    connect(m_searchWorker, &SearchWorker::matchesFound, this, &AnnotationEdit::findMatchesFound);
+    connect(m_searchWorker, &SearchWorker::searchFinished, this, &AnnotationEdit::findSearchFinished);
+    connect(m_textEdit->document(), &QTextDocument::contentsChange, this, &AnnotationEdit::findContentsChanged);
+    connect(m_textEdit->verticalScrollBar(), &QScrollBar::valueChanged, this, &AnnotationEdit::updateFindSelections);
 
     setMouseTracking(true);
 
@@ -133,14 +209,46 @@ AnnotationEdit::AnnotationEdit(Annotator* annotator, CodeTextHighlighter *highli
 
 AnnotationEdit::~AnnotationEdit()
 {
-    m_annotationWorker->kill();
+    for (const AnnotatorSlot& slot : m_annotators)
+        slot.worker->kill();
+
+    // Returns at once for a worker never started, e.g. an idle one whose timer had not fired.
+    for (const AnnotatorSlot& slot : m_annotators)
+        slot.worker->wait();
 
-    while(!m_annotationWorker->isFinished())
-        QThread::msleep(100);
+    m_searchWorker->kill();
+    m_searchWorker->wait();
+
+    // Leaves the file on disk as it was.
+    delete m_saver;
+    delete m_fileChangeWorker;
 
     deleteAll();
 }
 
+void AnnotationEdit::addAnnotator(Annotator *annotator, const QString &name, Schedule schedule)
+{
+    Q_ASSERT(m_annotators.size() < symbolSource);
+
+    AnnotatorSlot slot;
+    slot.annotator = annotator;
+    slot.name = name;
+    slot.schedule = schedule;
+    slot.worker = new AnnotationWorker(annotator, this);
+
+    int source = m_annotators.size();
+    connect(slot.worker, &AnnotationWorker::resultReady, this, [this, source]() { analysisFinished(source); });
+    m_annotators.append(slot);
+}
+
+QString AnnotationEdit::annotatorVersions() const
+{
+    QStringList versions;
+    for (const AnnotatorSlot& slot : m_annotators)
+        versions.append(slot.name + ':' + slot.annotator->version());
+    return versions.join('|');
+}
+
 void AnnotationEdit::loadFile(QString filePath)
 {
     QFile file(filePath);
@@ -149,14 +257,343 @@ void AnnotationEdit::loadFile(QString filePath)
 
     auto content = file.readAll();
 
+    cancelSave();
+    m_filePath = QFileInfo(filePath).absoluteFilePath();
+    m_cachePending = false;
+    updateFileWatch();
+    for (AnnotatorSlot& slot : m_annotators)
+        slot.loaded = false;
+
+    AnnotationMap cachedAnnotations;
+    FormatRunMap cachedFormats;
+    bool cacheHit = false;
+
+    if(m_cacheEnabled) {
+        Keywords* keywords = m_highlighter->keywords();
+
+        m_cacheKey.filePath = m_filePath;
+        m_cacheKey.contentHash = AnnotationCache::contentHash(content);
+        m_cacheKey.annotatorVersion = annotatorVersions();
+        m_cacheKey.keywordsVersion = keywords ? keywords->version : QString();
+
+        cacheHit = m_cache.load(m_cacheKey, cachedAnnotations, cachedFormats);
+        m_cachePending = true;
+    }
+
+    if(cacheHit)
+        m_highlighter->setCachedFormats(cachedFormats);
+
     m_textEdit->setPlainText(content);
+    m_highlighter->clearCachedFormats();
 
-    updateAnnotations();
+    // A cache hit fills the gutter straight away, the analysis below re-checks it in the background.
+    // Cached annotations go back to the annotator named by their source, syntax errors included.
     synchronizeSceneWithDocument();
+    if(cacheHit)
+    {
+        QVector<AnnotationMap> bySource(m_annotators.size());
+        for (auto it = cachedAnnotations.constBegin(); it != cachedAnnotations.constEnd(); ++it)
+        {
+            for (Annotation* annotation : it.value())
+            {
+                // Label checks are made again from the index.
+                if (annotation->source() == symbolSourceName)
+                {
+                    delete annotation;
+                    continue;
+                }
+
+                int source = 0;
+                while (source < m_annotators.size() && m_annotators[source].name != annotation->source())
+                    ++ source;
+                bySource[source < m_annotators.size() ? source : 0][it.key()].append(annotation);
+            }
+        }
+
+        for (int source = 0; source < m_annotators.size(); ++source)
+        {
+            AnnotationResult cached(m_revision);
+            cached.adopt(bySource[source]);
+            applyResult(std::move(cached), source, false);
+            m_annotators[source].fullAnalysisPending = true;
+        }
+    }
+
+    updateAnnotations();
+}
+
+bool AnnotationEdit::saveFile(QString filePath)
+{
+    if (m_saver != nullptr)
+        return false;
+
+    m_saver = new DocumentSaver(QFileInfo(filePath).absoluteFilePath());
+    connect(m_saver, &DocumentSaver::spaceAvailable, this, &AnnotationEdit::saveStep);
+    connect(m_saver, &DocumentSaver::saved, this, &AnnotationEdit::saveFinished);
+    connect(m_saver, &DocumentSaver::failed, this, &AnnotationEdit::saveError);
+
+    // Read only keeps the blocks still to be read as they were when the save started.
+    m_saveWasReadOnly = m_textEdit->isReadOnly();
+    m_textEdit->setReadOnly(true);
+    m_saveBlock = m_textEdit->document()->firstBlock();
+    m_saveRevision = m_revision;
+
+    m_saver->start(QThread::LowPriority);
+    saveStep();
+    return true;
+}
+
+void AnnotationEdit::saveStep()
+{
+    if (m_saver == nullptr || !m_saveBlock.isValid())
+        return;
+
+    QString chunk;
+    while (m_saveBlock.isValid() && chunk.size() < saveChunkChars)
+    {
+        chunk += m_saveBlock.text();
+        m_saveBlock = m_saveBlock.next();
+        if (m_saveBlock.isValid())
+            chunk += '\n';
+    }
+    m_saver->append(chunk);
+
+    if (!m_saveBlock.isValid())
+    {
+        m_saver->finish();
+        m_textEdit->setReadOnly(m_saveWasReadOnly);
+        return;
+    }
+
+    // With the queue full, spaceAvailable() picks this up again.
+    if (m_saver->hasSpace())
+        QTimer::singleShot(0, this, &AnnotationEdit::saveStep);
+}
+
+void AnnotationEdit::saveFinished(QString filePath)
+{
+    // From a saver cancelled after it had sent this.
+    if (sender() != m_saver)
+        return;
+
+    releaseSaver();
+
+    // The buffer is read only while saving, so this only fails for edits made afterwards.
+    if (m_revision == m_saveRevision)
+        m_textEdit->document()->setModified(false);
+    m_filePath = filePath;
+    updateFileWatch();
+    restartDeferredFileCheck();
+
+    emit fileSaved(filePath);
+}
+
+void AnnotationEdit::saveError(QString filePath, QString error)
+{
+    if (sender() != m_saver)
+        return;
+
+    if (m_saveBlock.isValid())
+        m_textEdit->setReadOnly(m_saveWasReadOnly);
+    releaseSaver();
+    restartDeferredFileCheck();
+
+    emit saveFailed(filePath, error);
+}
+
+void AnnotationEdit::restartDeferredFileCheck()
+{
+    if (!m_fileCheckDeferred)
+        return;
+
+    m_fileCheckDeferred = false;
+    m_fileChangeTimer.start();
+}
+
+void AnnotationEdit::releaseSaver()
+{
+    m_saveBlock = QTextBlock();
+    m_saver->wait();
+    m_saver->deleteLater();
+    m_saver = nullptr;
+}
+
+void AnnotationEdit::cancelSave()
+{
+    if (m_saver == nullptr)
+        return;
+
+    // Called before the document changes, while the blocks still to be read are valid. The
+    // temporary file is dropped, the target keeps what it had.
+    QString filePath = m_saver->filePath();
+    m_saver->abort();
+    if (m_saveBlock.isValid())
+        m_textEdit->setReadOnly(m_saveWasReadOnly);
+    releaseSaver();
+    restartDeferredFileCheck();
+
+    emit saveFailed(filePath, QStringLiteral("The document was replaced before it was saved"));
+}
+
+void AnnotationEdit::setFileWatchingEnabled(bool enabled)
+{
+    m_fileWatchingEnabled = enabled;
+    updateFileWatch();
+}
+
+void AnnotationEdit::updateFileWatch()
+{
+    QStringList watched = m_fileWatcher.files();
+    bool watch = m_fileWatchingEnabled && !m_filePath.isEmpty();
+    if (watch && watched == QStringList(m_filePath))
+        return;
+
+    if (!watched.isEmpty())
+        m_fileWatcher.removePaths(watched);
+    if (watch)
+        m_fileWatcher.addPath(m_filePath);
+}
+
+void AnnotationEdit::reloadFromDisk()
+{
+    m_forceReload = true;
+    checkFileOnDisk();
+}
+
+void AnnotationEdit::checkFileOnDisk()
+{
+    if (m_filePath.isEmpty())
+        return;
+    if (m_saver != nullptr)
+    {
+        m_fileCheckDeferred = true;
+        return;
+    }
+
+    // Replacing a file atomically drops it from the watcher.
+    updateFileWatch();
+
+    if (m_textEdit->document()->isModified() && !m_forceReload)
+    {
+        emit fileChangedOnDisk(m_filePath);
+        return;
+    }
+
+    if (m_fileChangeWorker == nullptr)
+    {
+        m_fileChangeWorker = new FileChangeWorker;
+        connect(m_fileChangeWorker, &FileChangeWorker::compared, this, &AnnotationEdit::fileCompared);
+    }
+
+    QStringList lines;
+    extractLines(m_textEdit->document(), lines);
+    m_fileChangeWorker->compare(m_filePath, lines, m_revision);
+}
+
+void AnnotationEdit::fileCompared()
+{
+    FileChangeWorker::Result result = m_fileChangeWorker->takeResult();
+    if (result.revision == -1 || result.filePath != m_filePath)
+        return;
+
+    // Typed into while the diff ran, compare again with the new text.
+    if (result.revision != m_revision)
+    {
+        m_fileChangeTimer.start();
+        return;
+    }
+
+    // Mid-write or gone, the next change notification tries again.
+    if (!result.readOk)
+        return;
+
+    // A save started while the diff ran. Its walk over the blocks must not see them change,
+    // so the file is compared again once the save is done.
+    if (m_saver != nullptr)
+    {
+        m_fileCheckDeferred = true;
+        return;
+    }
+
+    m_forceReload = false;
+    if (!result.hunks.isEmpty())
+        applyHunks(result.hunks);
+    m_textEdit->document()->setModified(false);
+}
+
+void AnnotationEdit::applyHunks(const QVector<LineHunk> &hunks)
+{
+    QTextDocument *document = m_textEdit->document();
+
+    // The first visible line stays at the top, moved by the lines added or removed above it.
+    QScrollBar* scrollBar = m_textEdit->verticalScrollBar();
+    int topBlock = m_textEdit->cursorForPosition(QPoint(0,0)).blockNumber();
+    int topOffset = scrollBar->value() - int(m_textEdit->blockTop(topBlock));
+    int horizontal = m_textEdit->horizontalScrollBar()->value();
+    int newTopBlock = topBlock;
+    for (const LineHunk& hunk : hunks)
+    {
+        if (hunk.oldStart + hunk.oldCount <= topBlock)
+            newTopBlock += hunk.lines.count() - hunk.oldCount;
+        else if (hunk.oldStart <= topBlock)
+            newTopBlock = hunk.newStart;
+    }
+
+    {
+        // Only the replaced lines are highlighted again, and they are analyzed in one pass.
+        BulkEdit bulkEdit(this);
+        QTextCursor cursor(document);
+        cursor.beginEditBlock();
+
+        // Bottom up, so the line numbers of the hunks still to come stay valid.
+        for (int h = hunks.count() - 1; h >= 0; --h)
+        {
+            const LineHunk& hunk = hunks[h];
+            QString text = hunk.lines.join('\n');
+            int start, end;
+            if (hunk.oldStart + hunk.oldCount < document->blockCount())
+            {
+                // A kept line follows, so every new line brings its own newline.
+                start = document->findBlockByNumber(hunk.oldStart).position();
+                end = document->findBlockByNumber(hunk.oldStart + hunk.oldCount).position();
+                if (!hunk.lines.isEmpty())
+                    text += '\n';
+            }
+            else if (hunk.oldStart == 0)
+            {
+                start = 0;
+                end = document->characterCount() - 1;
+            }
+            else
+            {
+                // Up to the end, the newline ending the line before goes instead.
+                QTextBlock before = document->findBlockByNumber(hunk.oldStart - 1);
+                start = before.position() + before.length() - 1;
+                end = document->characterCount() - 1;
+                if (!hunk.lines.isEmpty())
+                    text.prepend('\n');
+            }
+
+            cursor.setPosition(start);
+            cursor.setPosition(end, QTextCursor::KeepAnchor);
+            cursor.insertText(text);
+        }
+
+        cursor.endEditBlock();
+    }
+
+    newTopBlock = qBound(0, newTopBlock, document->blockCount() - 1);
+    scrollBar->setValue(int(m_textEdit->blockTop(newTopBlock)) + topOffset);
+    m_textEdit->horizontalScrollBar()->setValue(horizontal);
 }
 
 void AnnotationEdit::setContents(QString contents)
 {
+    cancelSave();
+    m_filePath.clear();
+    m_cachePending = false;
+    updateFileWatch();
+
     m_textEdit->setPlainText(contents);
 
     updateAnnotations();
@@ -170,9 +607,21 @@ QString AnnotationEdit::toPlainText()
 
 void AnnotationEdit::setPlainText(QString text)
 {
+    cancelSave();
     m_textEdit->setPlainText(text);
 }
 
+void AnnotationEdit::setWordWrapEnabled(bool enabled)
+{
+    // The gutter follows through blockHeightsChanged as the blocks are laid out again.
+    m_textEdit->setWordWrapMode(enabled ? QTextOption::WrapAtWordBoundaryOrAnywhere : QTextOption::NoWrap);
+}
+
+bool AnnotationEdit::isWordWrapEnabled() const
+{
+    return m_textEdit->wordWrapMode() != QTextOption::NoWrap;
+}
+
 void AnnotationEdit::resizeEvent(QResizeEvent *event)
 {
     //int viewportHeight = m_textEdit->viewport()->height();
@@ -185,6 +634,7 @@ void AnnotationEdit::resizeEvent(QResizeEvent *event)
     //m_graphicsScene->setSceneRect(0,0,m_graphicsView->width(),viewportHeight);
     QWidget::resizeEvent(event);
     synchronizeSceneWithDocument();
+    updateFindSelections();
 }
 
 void AnnotationEdit::mousePressEvent(QMouseEvent *event)
@@ -205,7 +655,12 @@ void AnnotationEdit::mousePressEvent(QMouseEvent *event)
     if (item != nullptr)
     {
         GraphicsAnnotationItem *textItem = dynamic_cast<GraphicsAnnotationItem*>(item);
-        if (textItem != nullptr)
+        BlockData *data = m_items.value(textItem, nullptr);
+        if (data != nullptr && m_folds.contains(data))
+        {
+            unfold(data);
+        }
+        else if (textItem != nullptr)
         {
            int index = textItem->capture(scenePt);
            if (textItem->isCaptured())
@@ -215,7 +670,7 @@ void AnnotationEdit::mousePressEvent(QMouseEvent *event)
            else if (index != -1)
            {
                m_currentItem = textItem;
-               QColor color = m_itemMap[m_currentItem][index]->alertColor();
+               QColor color = m_items.value(m_currentItem)->annotations()[index]->alertColor();
                m_currentItem->setDefaultTextColor(color);
                m_currentItem->setFont(QFont(fontFamilyAnnotation,fontSize,QFont::Bold));
                m_currentItem->update();
@@ -226,203 +681,1464 @@ void AnnotationEdit::mousePressEvent(QMouseEvent *event)
 
 void AnnotationEdit::updateAnnotations()
 {
-    m_annotationRefreshTimer.start();
+    startAnalysisTimers();
     synchronizeSceneWithDocument();
 }
 
-void AnnotationEdit::refreshAnnotations()
+void AnnotationEdit::startAnalysisTimers()
 {
-    QStringList lines;
-    bool allBlank = extractLines(m_textEdit->document(), lines);
-    if(allBlank)
-        return;
-
-    m_annotationWorker->analyze(lines);
+    // Every edit restarts both, so idle annotators wait for a pause in typing.
+    m_annotationRefreshTimer.start();
+    m_idleRefreshTimer.start();
 }
 
-void AnnotationEdit::rebuildAnnotations(AnnotationMap annotations)
+void AnnotationEdit::refreshAnnotations(Schedule schedule)
 {
-    deleteAll();
+    if (m_bulkEditDepth > 0)
+    {
+        m_bulkAnalysisPending = true;
+        return;
+    }
 
-    QTextDocument *document = m_textEdit->document();
-    m_annotationMap = annotations;
+    if (schedule == SCHEDULE_Keystroke)
+        updateSymbols();
 
-    int buttonTab = 0;
-    LineNumber lineNum = 0;
-    int ascent = 0, descent = 0;
+    QStringList lines;
+    bool allBlank = extractLines(m_textEdit->document(), lines);
+    if(allBlank)
+        return;
 
-    for (QTextBlock block = document->begin(); block != document->end(); block = block.next())
+    // The highlighter's tokens go along, so the annotators need not split the lines again.
+    // Shared, a block's tokens are only copied if it is lexed again during the analysis.
+    LineTokens tokens;
+    tokens.reserve(lines.size());
+    for (QTextBlock block = m_textEdit->document()->firstBlock(); block.isValid(); block = block.next())
     {
-        QTextLine line = block.layout()->lineAt(0);
-        if(! line.isValid()) {
-            qWarning() << "Invalid line found: Probably too early to function.";
-            return;
+        BlockData *data = BlockData::of(block);
+        if (data != nullptr)
+        {
+            tokens.append(blockTokens(data));
+            continue;
         }
 
-        ascent = line.ascent();
-        descent = line.descent();
-
-        m_textEdit->setAscentDescent(ascent,descent);
-        break;
+        QVector<KeywordSpan> spans;
+        m_highlighter->keywordScanner().scan(block.text(), spans);
+        tokens.append(spans);
     }
 
-    for (QTextBlock block = document->begin(); block != document->end(); block = block.next())
+    for (int source = 0; source < m_annotators.size(); ++source)
     {
-        int yBlock = int(block.layout()->position().y());
-        int yBaseline = yBlock + ascent;
-        bool inserted = false;
+        const AnnotatorSlot& slot = m_annotators[source];
+        if (slot.schedule != schedule)
+            continue;
 
-        GraphicsAnnotationItem* item = nullptr;
-        if (!block.text().isEmpty())
+        // The whole text still goes along, the annotator may need it as context.
+        QVector<QPair<LineNumber, LineNumber>> dirtyRanges;
+        if (!slot.fullAnalysisPending)
         {
-            AnnotationContainer container = m_annotationMap[lineNum];
-            if (!container.isEmpty())
-            {
-                int buttonIndex = -1;
-                QString bracketString;
-                if (container.count() > 1)
-                    bracketString = " (" + QString::number(container.count()) + ')';
-                QString priorityString = priorityMessage(container,buttonIndex) + bracketString;
-
-                int maxWidth = longestWidth(container);
-                int width = textWidth(priorityString);
-                if (width > maxWidth)
-                    maxWidth = width;
-                if (buttonTab < maxWidth)
-                    buttonTab = maxWidth;
-
-                item  = new GraphicsAnnotationItem(priorityString,container,buttonIndex);
-                m_itemMap.insert(item, container);
-                item->setFont(QFont(fontFamilyAnnotation,fontSize,QFont::Normal));
-                item->setPlainText(priorityString);
-                if (buttonIndex != -1 && item->buttonsCount()>0)
-                {
-                    m_currentItem = item;
-                    item->reset();
-                    item->setDefaultTextColor(container[buttonIndex]->alertColor());
-                }
-                else if (container.count()==1)
-                {
-                    item->setDefaultTextColor(container[0]->alertColor());
-                }
-                inserted = true;
-            } // if
-        } // if
-        if (!inserted)
-            item = new GraphicsAnnotationItem;
-
-        m_blockToItemMap.insert(block.blockNumber(),item);
-        m_itemToBlockMap.insert(item,block.blockNumber());
-        item->setPos(0,yBaseline);
-        item->setLineAscentDescent(ascent, descent);
-        m_graphicsScene->addItem(item);
-
-        ++ lineNum;
-    } // for
-    int gap = textWidth("   ");
-    for (GraphicsAnnotationItem* item : m_itemToBlockMap.keys())
-        item->setButtonTab(buttonTab+gap);
+            dirtyRanges = dirtyLines(source);
+            if (dirtyRanges.isEmpty())
+                continue;
+        }
 
-    synchronizeSceneWithDocument();
+        slot.worker->analyze(lines, m_revision, dirtyRanges, tokens);
+    }
 }
 
-void AnnotationEdit::synchronizeSceneWithDocument()
+void AnnotationEdit::documentContentsChange(int position, int charsRemoved, int charsAdded)
 {
-    QTextDocument *document = m_textEdit->document();
-    //qDebug() << "height " << height() << " gv height " << m_graphicsView->height() << "gvc " << m_gvContainer->height() << " empyt " << m_empty->height();
-    int size = int(document->documentLayout()->documentSize().height());
-    if (size <= m_textEdit->height() - 1)
-        size = m_graphicsView->height() - 2;
-
-    //qDebug() << "TextDoc: " << size << "  Canvas: " << rect;
+    if (charsRemoved == 0 && charsAdded == 0)
+        return;
 
-    m_graphicsScene->setSceneRect(QRectF(0,0,m_graphicsView->width(),size));
-//    qDebug() << m_textEdit->viewport()->size() << m_graphicsView->size();
+    ++ m_revision;
+    updateBlockStructure(position, charsAdded);
+    if (m_bulkEditDepth > 0)
+    {
+        addDirtyRange(position, charsRemoved, charsAdded);
+        m_bulkAnalysisPending = true;
+        return;
+    }
+    updateAnnotations();
 }
 
-void AnnotationEdit::textEditScrollBarChanged(int value)
+void AnnotationEdit::beginBulkEdit()
 {
-    // I had trouble with event feedback so I had to squelch the cross signalling while updating.
-    //  They scrollbars where keeping each other busy.
-
-    double ratio = (double)value/m_textEdit->verticalScrollBar()->maximum();
-
-//    qDebug() << "TE->GV: "
-//             << "  GV: " << m_graphicsView->verticalScrollBar()->minimum() << m_graphicsView->verticalScrollBar()->value() << m_graphicsView->verticalScrollBar()->maximum()
-//             << "  TE: " << m_textEdit->verticalScrollBar()->minimum() << m_textEdit->verticalScrollBar()->value() << m_textEdit->verticalScrollBar()->maximum()
-//             << "  ==> " << value << ratio;
-
-    disconnect(m_graphicsView->verticalScrollBar(), &QScrollBar::valueChanged, this, &AnnotationEdit::graphicsViewScrollBarChanged);
-    m_graphicsView->verticalScrollBar()->setValue(ratio * m_graphicsView->verticalScrollBar()->maximum());
-    connect(m_graphicsView->verticalScrollBar(), &QScrollBar::valueChanged, this, &AnnotationEdit::graphicsViewScrollBarChanged);
+    cancelSave();
+    if (m_bulkEditDepth++ == 0)
+        m_highlighter->setSuspended(true);
 }
 
-void AnnotationEdit::graphicsViewScrollBarChanged(int value)
+void AnnotationEdit::endBulkEdit()
 {
-    // I had trouble with event feedback so I had to squelch the cross signalling while updating.
-    //  They scrollbars where keeping each other busy.
+    Q_ASSERT(m_bulkEditDepth > 0);
+    if (--m_bulkEditDepth > 0)
+        return;
 
-    double ratio = (double)value/m_graphicsView->verticalScrollBar()->maximum();
+    m_highlighter->setSuspended(false);
 
-//    qDebug() << "GV->TE: "
-//             << "  GV: " << m_graphicsView->verticalScrollBar()->minimum() << m_graphicsView->verticalScrollBar()->value() << m_graphicsView->verticalScrollBar()->maximum()
-//             << "  TE: " << m_textEdit->verticalScrollBar()->minimum() << m_textEdit->verticalScrollBar()->value() << m_textEdit->verticalScrollBar()->maximum()
-//             << "  ==> " << value << ratio;
+    // Each touched block is highlighted once, however many edits it saw.
+    QTextDocument *document = m_textEdit->document();
+    int lastBlock = -1;
+    for (const QPair<int,int>& range : m_dirtyRanges)
+    {
+        for (QTextBlock block = document->findBlock(range.first); block.isValid() && block.position() <= range.second; block = block.next())
+        {
+            if (block.blockNumber() <= lastBlock)
+                continue;
+            m_highlighter->rehighlightBlock(block);
+            lastBlock = block.blockNumber();
+        }
+    }
+    m_dirtyRanges.clear();
 
-    disconnect(m_textEdit->verticalScrollBar(), &QScrollBar::valueChanged, this, &AnnotationEdit::textEditScrollBarChanged);
-    m_textEdit->verticalScrollBar()->setValue(ratio * m_textEdit->verticalScrollBar()->maximum());
-    connect(m_textEdit->verticalScrollBar(), &QScrollBar::valueChanged, this, &AnnotationEdit::textEditScrollBarChanged);
+    if (m_bulkRepositionFrom != -1)
+    {
+        repositionItems(m_bulkRepositionFrom);
+        m_bulkRepositionFrom = -1;
+    }
+    if (m_bulkSceneSyncPending)
+    {
+        m_bulkSceneSyncPending = false;
+        synchronizeSceneWithDocument();
+    }
+    if (m_bulkAnalysisPending)
+    {
+        m_bulkAnalysisPending = false;
+        m_annotationRefreshTimer.stop();
+        m_idleRefreshTimer.stop();
+        refreshAnnotations(SCHEDULE_Keystroke);
+        refreshAnnotations(SCHEDULE_Idle);
+    }
 }
 
-void AnnotationEdit::showPopup(GraphicsAnnotationItem *item)
+void AnnotationEdit::addDirtyRange(int position, int charsRemoved, int charsAdded)
 {
-    AnnotationContainer container = m_itemMap[item];
-    if (!container.isEmpty())
+    int delta = charsAdded - charsRemoved;
+    int start = position;
+    int end = position + charsAdded;
+
+    // Ranges ending before the edit stay as they are, ones it overlaps merge into it and
+    // the ones after it move by the change in length.
+    auto first = std::lower_bound(m_dirtyRanges.begin(), m_dirtyRanges.end(), position,
+                                  [](const QPair<int,int>& range, int value) {return range.second < value;});
+    int index = int(first - m_dirtyRanges.begin());
+    int last = index;
+    while (last < m_dirtyRanges.count() && m_dirtyRanges[last].first <= position + charsRemoved)
     {
-        item->setFont(QFont(fontFamilyAnnotation,fontSize,QFont::Bold));
-        item->update();
-        AnnotationDialog dialog(container,this);
-        dialog.exec();
-        item->setFont(QFont(fontFamilyAnnotation,fontSize,QFont::Normal));
-        item->update();
+        start = qMin(start, m_dirtyRanges[last].first);
+        end = qMax(end, m_dirtyRanges[last].second + delta);
+        ++ last;
+    }
+    for (int i = last; i < m_dirtyRanges.count(); ++i)
+    {
+        m_dirtyRanges[i].first += delta;
+        m_dirtyRanges[i].second += delta;
     }
+
+    m_dirtyRanges.remove(index, last - index);
+    m_dirtyRanges.insert(index, qMakePair(start, end));
 }
 
-QString AnnotationEdit::priorityMessage(const AnnotationContainer& container, int& buttonIndex)
+void AnnotationEdit::updateBlockStructure(int position, int charsAdded)
 {
-    buttonIndex = -1;
-    if (!container.isEmpty())
+    // Blocks removed by the edit have already taken their rows along, see blockDataDeleted().
+    QTextDocument *document = m_textEdit->document();
+    QTextBlock block = document->findBlock(position);
+    QTextBlock last = document->findBlock(position + charsAdded);
+    if (!block.isValid())
+        block = document->lastBlock();
+    if (!last.isValid())
+        last = document->lastBlock();
+
+    int first = block.blockNumber();
+    int delta = document->blockCount() - m_blockCount;
+    m_blockCount = document->blockCount();
+
+    int countBefore = 0;
+    for (int category = 0; category < AnnotationIndex::categoryCount; ++category)
+        countBefore += m_annotationIndex.annotationCount(Annotation::Category(category));
+
+    // The edited lines replaced old lines [first, oldEnd), the lines below only move.
+    int oldEnd = last.blockNumber() + 1 - delta;
+    m_annotationIndex.removeLines(first, oldEnd);
+    m_annotationIndex.shiftLines(oldEnd, delta);
+    m_summaryTree.replaceLines(first, oldEnd - first, last.blockNumber() + 1 - first);
+    m_overviewRuler->setLineCount(m_blockCount);
+    m_overviewRuler->removeLines(first, oldEnd);
+    m_overviewRuler->shiftLines(oldEnd, delta);
+
+    // Edited blocks keep showing what they had until they are analyzed again.
+    for (LineNumber line = first; block.isValid(); block = block.next(), ++line)
     {
-        for (int i=0; i<container.count()  && buttonIndex==-1; i++)
-        {
-            if (container[i]->category()==Annotation::CATEGORY_Error)
-                buttonIndex = i;
-        }
-        for (int i=0; i<container.count() && buttonIndex==-1; i++)
-        {
-            if (container[i]->category()==Annotation::CATEGORY_Warning)
-                buttonIndex = i;
-        }
-        for (int i=0; i<container.count() && buttonIndex==-1; i++)
+        BlockData *data = ensureBlockData(block);
+        data->markDirty();
+        m_symbolDirty.insert(data);
+        if (!data->annotations().isEmpty())
         {
-            if (container[i]->category()==Annotation::CATEGORY_Hint)
-                buttonIndex = i;
+            m_annotationIndex.setLine(line, data->annotations());
+            m_summaryTree.setLine(line, data->annotations());
+            m_overviewRuler->setLine(line, data->annotations());
         }
-        if (buttonIndex==-1)
-            buttonIndex = 0;
+        // Edited lines are never left hidden.
+        if (!block.isVisible())
+            m_foldRepairs.insert(data);
+        if (block == last)
+            break;
+    }
+
+    // Hidden lines below a line which is no fold header lost theirs to the edit.
+    QTextBlock after = last.next();
+    if (after.isValid() && !after.isVisible() && !m_folds.contains(BlockData::of(last)))
+        m_foldRepairs.insert(ensureBlockData(last));
+    if (!m_foldRepairs.isEmpty())
+        QTimer::singleShot(0, this, &AnnotationEdit::repairFolds);
+
+    // Rows below move with their lines, once for a whole bulk edit.
+    if (delta != 0 && m_bulkEditDepth > 0)
+        m_bulkRepositionFrom = m_bulkRepositionFrom == -1 ? first : qMin(m_bulkRepositionFrom, first);
+    else if (delta != 0)
+        repositionItems(first);
+    updateButtonTab();
+
+    int countAfter = 0;
+    for (int category = 0; category < AnnotationIndex::categoryCount; ++category)
+        countAfter += m_annotationIndex.annotationCount(Annotation::Category(category));
+    if (countAfter != countBefore)
+    {
+        updateFoldSummaries();
+        emit annotationCountsChanged();
+    }
+}
+
+BlockData *AnnotationEdit::ensureBlockData(const QTextBlock &block)
+{
+    BlockData *data = BlockData::of(block);
+    if (data == nullptr)
+    {
+        data = new BlockData(block, this);
+        QTextBlock(block).setUserData(data);
+        updateItem(data);
+    }
+    else if (data->observer() != this)
+    {
+        // Made by the highlighter when it lexed the block.
+        data->attach(this);
+        updateItem(data);
+    }
+    return data;
+}
+
+const QVector<KeywordSpan> &AnnotationEdit::blockTokens(BlockData *data)
+{
+    // The highlighter's tokens, only lexed here when it has not seen the current text.
+    if (!data->hasTokens())
+        m_highlighter->keywordScanner().scan(data->block().text(), data->resetTokens());
+    return data->tokens();
+}
+
+void AnnotationEdit::appendSyntaxErrors(BlockData *data, AnnotationContainer &container)
+{
+    for (const KeywordSpan& token : blockTokens(data))
+    {
+        if (!token.isError())
+            continue;
+
+        Annotation *annotation = new Annotation;
+        annotation->setCategory(Annotation::CATEGORY_Error);
+        annotation->setMessage(KeywordScanner::errorMessage(data->block().text(), token));
+        annotation->setAlertColor(QColor("red"));
+        container.append(annotation);
+    }
+}
+
+void AnnotationEdit::updateSymbols()
+{
+    // Without keywords there are no label names, so nothing is a label.
+    if (m_highlighter->keywords() == nullptr)
+    {
+        m_symbolDirty.clear();
+        m_changedSymbols.clear();
+        return;
+    }
+
+    if (m_symbolDirty.isEmpty() && m_changedSymbols.isEmpty())
+        return;
+
+    // The edited blocks are checked again, and the blocks defining or referring to a label
+    // whose definitions changed. Nothing else can have changed.
+    QSet<BlockData*> check = m_symbolDirty;
+    for (BlockData* data : m_symbolDirty)
+    {
+        QStringList definitions, references;
+        m_highlighter->keywordScanner().labelSymbols(data->block().text(), blockTokens(data), definitions, references);
+        m_symbolIndex.update(data, definitions, references, m_changedSymbols);
+    }
+    m_symbolDirty.clear();
+
+    for (const QString& label : m_changedSymbols)
+    {
+        check += m_symbolIndex.definitions(label);
+        check += m_symbolIndex.references(label);
+    }
+    m_changedSymbols.clear();
+
+    bool changed = false;
+    for (BlockData* data : check)
+    {
+        if (!setBlockAnnotations(data, symbolSource, labelAnnotations(data)))
+            continue;
+
+        LineNumber line = data->block().blockNumber();
+        m_annotationIndex.setLine(line, data->annotations());
+        m_summaryTree.setLine(line, data->annotations());
+        m_overviewRuler->setLine(line, data->annotations());
+        changed = true;
+    }
+
+    if (changed)
+    {
+        updateFoldSummaries();
+        updateButtonTab();
+        emit annotationCountsChanged();
+    }
+}
+
+AnnotationContainer AnnotationEdit::labelAnnotations(BlockData *data) const
+{
+    AnnotationContainer container;
+    auto addError = [&container](const QString& message) {
+        Annotation *annotation = new Annotation;
+        annotation->setCategory(Annotation::CATEGORY_Error);
+        annotation->setMessage(message);
+        annotation->setAlertColor(QColor("red"));
+        annotation->setSource(symbolSourceName);
+        container.append(annotation);
+    };
+
+    QStringList definitions = m_symbolIndex.definedBy(data);
+    definitions.removeDuplicates();
+    for (const QString& label : definitions)
+    {
+        int count = m_symbolIndex.definitionCount(label);
+        if (count > 1)
+            addError(QString("Label '%1' is defined %2 times").arg(label).arg(count));
+    }
+
+    QStringList references = m_symbolIndex.referencedBy(data);
+    references.removeDuplicates();
+    for (const QString& label : references)
+    {
+        if (m_symbolIndex.definitionCount(label) == 0)
+            addError(QString("Label '%1' is not defined").arg(label));
+    }
+    return container;
+}
+
+static bool sameAnnotations(const AnnotationContainer& a, const AnnotationContainer& b)
+{
+    if (a.count() != b.count())
+        return false;
+
+    for (int i=0; i<a.count(); i++)
+    {
+        if (a[i]->category() != b[i]->category() || a[i]->message() != b[i]->message()
+                || a[i]->alertColor() != b[i]->alertColor() || a[i]->solutionHelp() != b[i]->solutionHelp()
+                || a[i]->helpKey() != b[i]->helpKey())
+            return false;
+    }
+    return true;
+}
+
+bool AnnotationEdit::setBlockAnnotations(BlockData *data, int source, const AnnotationContainer &container)
+{
+    data->setDirty(source, false);
+
+    // Most lines analyzed again after an edit come back as they were, their rows stay.
+    if (sameAnnotations(data->sourceAnnotations(source), container))
+    {
+        qDeleteAll(container);
+        return false;
+    }
+
+    data->setAnnotations(source, container);
+    updateItem(data);
+    return true;
+}
+
+void AnnotationEdit::updateItem(BlockData *data)
+{
+    const AnnotationContainer& container = data->annotations();
+
+    GraphicsAnnotationItem* item = nullptr;
+    if (m_folds.contains(data))
+    {
+        item = foldSummaryItem(data);
+    }
+    else if (container.isEmpty())
+    {
+        item = new GraphicsAnnotationItem;
     }
     else
     {
-        return "";
+        // Wide enough for any message the category filter can select.
+        int maxWidth = longestWidth(container);
+        if (container.count() > 1)
+            maxWidth += textWidth(" (" + QString::number(container.count()) + ')');
+
+        item  = new GraphicsAnnotationItem(QString(),container,-1);
+        item->setMessageWidth(maxWidth);
+        item->setFont(QFont(fontFamilyAnnotation,fontSize,QFont::Normal));
+        applyCategoryFilter(item, container);
+        if (item->visibleButtonsCount()>0)
+            m_currentItem = item;
+    }
+
+    if (data->item() != nullptr)
+        removeItem(data->item());
+
+    // Rows without annotations count as width 0, so every row is added and removed alike.
+    addMessageWidth(item->messageWidth());
+    if (m_profilingEnabled)
+        updateItemHeat(item, data);
+    data->setItem(item);
+    m_items.insert(item, data);
+
+    item->setButtonTab(m_buttonTab);
+    item->setLineAscentDescent(m_textEdit->ascent(), m_textEdit->descent());
+    item->setPos(0, int(m_textEdit->blockTop(data->block().blockNumber())) + m_textEdit->ascent());
+    item->setVisible(data->block().isVisible());
+    m_graphicsScene->addItem(item);
+}
+
+GraphicsAnnotationItem *AnnotationEdit::foldSummaryItem(BlockData *header)
+{
+    static const char* categoryNames[AnnotationSummaryTree::categoryCount] = {"notes", "hints", "warnings", "errors"};
+
+    // The header's own annotations are hidden behind the summary too, so they count.
+    LineNumber first = header->block().blockNumber();
+    LineNumber end = m_folds.value(header)->block().blockNumber() + 1;
+    AnnotationSummaryTree::Summary summary = m_summaryTree.summary(first, end);
+
+    QStringList counts;
+    int worst = -1;
+    for (int category = AnnotationSummaryTree::categoryCount - 1; category >= 0; --category)
+    {
+        if (summary.counts[category] == 0 || !isCategoryVisible(Annotation::Category(category)))
+            continue;
+        if (worst == -1)
+            worst = category;
+        counts.append(QString("%1 %2").arg(summary.counts[category]).arg(categoryNames[category]));
+    }
+
+    QString message = QString("+ %1 lines folded").arg(end - first - 1);
+    if (!counts.isEmpty())
+        message += ": " + counts.join(", ");
+
+    // Coloured like the first annotation of the worst category inside.
+    QColor color(0x80, 0x80, 0x80);
+    LineNumber worstLine = worst == -1 ? -1 : m_annotationIndex.nextLine(Annotation::Category(worst), first - 1);
+    if (worstLine != -1 && worstLine < end)
+    {
+        BlockData* data = BlockData::of(m_textEdit->document()->findBlockByNumber(worstLine));
+        if (data != nullptr)
+        {
+            for (const Annotation* annotation : data->annotations())
+            {
+                if (annotation->category() == worst)
+                {
+                    color = annotation->alertColor();
+                    break;
+                }
+            }
+        }
+    }
+
+    GraphicsAnnotationItem* item = new GraphicsAnnotationItem;
+    item->setPlainText(message);
+    item->setDefaultTextColor(color);
+    item->setFont(QFont(fontFamilyAnnotation,fontSize,QFont::Normal));
+    item->setMessageWidth(textWidth(message));
+    return item;
+}
+
+void AnnotationEdit::updateFoldSummaries()
+{
+    // Each is a range query, so a result costs O(log n) per fold however much is folded.
+    const QList<BlockData*> headers = m_folds.keys();
+    for (BlockData* header : headers)
+        updateItem(header);
+}
+
+bool AnnotationEdit::isLabelDefinition(BlockData *data)
+{
+    const QVector<KeywordSpan>& tokens = blockTokens(data);
+    return !tokens.isEmpty() && tokens.first().kind == KeywordSpan::SPAN_LabelTag && tokens.first().start == 0;
+}
+
+static int indentation(const QString& text)
+{
+    int column = 0;
+    for (QChar c : text)
+    {
+        if (c == '\t')
+            column += 8 - column % 8;
+        else if (c == ' ')
+            ++ column;
+        else
+            return column;
+    }
+    return -1;  // Blank
+}
+
+LineNumber AnnotationEdit::foldEnd(LineNumber line)
+{
+    QTextBlock header = m_textEdit->document()->findBlockByNumber(line);
+    int headerIndent = header.isValid() ? indentation(header.text()) : -1;
+    if (headerIndent == -1)
+        return line + 1;
+
+    // Blank lines after the section stay out, they separate it from the next one.
+    bool labelSection = isLabelDefinition(ensureBlockData(header));
+    LineNumber end = line + 1;
+    LineNumber current = line + 1;
+    for (QTextBlock block = header.next(); block.isValid(); block = block.next(), ++current)
+    {
+        int indent = indentation(block.text());
+        if (indent == -1)
+            continue;
+        if (labelSection ? isLabelDefinition(ensureBlockData(block)) : indent <= headerIndent)
+            break;
+        end = current + 1;
+    }
+    return end;
+}
+
+bool AnnotationEdit::isFolded(LineNumber line) const
+{
+    BlockData* data = BlockData::of(m_textEdit->document()->findBlockByNumber(line));
+    return data != nullptr && m_folds.contains(data);
+}
+
+bool AnnotationEdit::foldLine(LineNumber line)
+{
+    QTextBlock header = m_textEdit->document()->findBlockByNumber(line);
+    if (!header.isValid() || !header.isVisible() || isFolded(line))
+        return false;
+
+    LineNumber end = foldEnd(line);
+    if (end <= line + 1)
+        return false;
+    QTextBlock last = m_textEdit->document()->findBlockByNumber(end - 1);
+
+    // Folds inside are merged, unfolding this one shows all of their lines.
+    QList<BlockData*> merged;
+    for (auto it = m_folds.begin(); it != m_folds.end(); )
+    {
+        LineNumber inner = it.key()->block().blockNumber();
+        if (inner > line && inner < end)
+        {
+            merged.append(it.key());
+            m_foldEnds.remove(it.value());
+            it = m_folds.erase(it);
+        }
+        else
+        {
+            ++ it;
+        }
+    }
+
+    // The cursor does not stay on a line that disappears.
+    int cursorLine = m_textEdit->textCursor().blockNumber();
+    if (cursorLine > line && cursorLine < end)
+    {
+        QTextCursor cursor(header);
+        cursor.movePosition(QTextCursor::EndOfBlock);
+        m_textEdit->setTextCursor(cursor);
+    }
+
+    BlockData* headerData = ensureBlockData(header);
+    BlockData* lastData = ensureBlockData(last);
+    m_folds.insert(headerData, lastData);
+    m_foldEnds.insert(lastData, headerData);
+
+    setBlocksVisible(header.next(), last, false);
+    for (BlockData* data : merged)
+        updateItem(data);
+    updateItem(headerData);
+    updateButtonTab();
+    return true;
+}
+
+bool AnnotationEdit::unfoldLine(LineNumber line)
+{
+    BlockData* data = BlockData::of(m_textEdit->document()->findBlockByNumber(line));
+    if (data == nullptr || !m_folds.contains(data))
+        return false;
+
+    unfold(data);
+    return true;
+}
+
+bool AnnotationEdit::toggleFold(LineNumber line)
+{
+    return isFolded(line) ? unfoldLine(line) : foldLine(line);
+}
+
+void AnnotationEdit::unfoldAll()
+{
+    while (!m_folds.isEmpty())
+        unfold(m_folds.begin().key());
+}
+
+void AnnotationEdit::unfold(BlockData *header)
+{
+    BlockData* last = m_folds.take(header);
+    m_foldEnds.remove(last);
+
+    setBlocksVisible(header->block().next(), last->block(), true);
+    updateItem(header);
+    updateButtonTab();
+}
+
+void AnnotationEdit::setBlocksVisible(QTextBlock first, QTextBlock last, bool visible)
+{
+    if (!first.isValid() || !last.isValid())
+        return;
+
+    for (QTextBlock block = first; block.isValid(); block = block.next())
+    {
+        block.setVisible(visible);
+        BlockData* data = BlockData::of(block);
+        if (data != nullptr && data->item() != nullptr)
+            data->item()->setVisible(visible);
+        if (block == last)
+            break;
+    }
+
+    // Lays the lines out again, their heights and so the rows below follow from that.
+    m_textEdit->document()->markContentsDirty(first.position(), last.position() + last.length() - first.position());
+}
+
+void AnnotationEdit::revealBlock(const QTextBlock &block)
+{
+    if (block.isVisible())
+        return;
+
+    QTextBlock header = block.previous();
+    while (header.isValid() && !header.isVisible())
+        header = header.previous();
+
+    BlockData* data = BlockData::of(header);
+    if (data != nullptr && m_folds.contains(data))
+        unfold(data);
+}
+
+void AnnotationEdit::repairFolds()
+{
+    QSet<BlockData*> repairs;
+    repairs.swap(m_foldRepairs);
+
+    for (BlockData* data : repairs)
+    {
+        QTextBlock block = data->block();
+
+        // An edit inside a fold undoes the fold.
+        if (!block.isVisible())
+        {
+            revealBlock(block);
+            while (block.isValid() && !block.isVisible())
+                block = block.previous();
+            if (!block.isValid())
+                continue;
+        }
+
+        // Lines still hidden below a line which is no header have lost theirs.
+        if (m_folds.contains(BlockData::of(block)))
+            continue;
+        QTextBlock first = block.next();
+        QTextBlock last = first;
+        if (!first.isValid() || first.isVisible())
+            continue;
+        while (last.next().isValid() && !last.next().isVisible())
+            last = last.next();
+        setBlocksVisible(first, last, true);
+
+        // E.g. a line split off the header, the fold those lines belonged to is gone.
+        BlockData* header = m_foldEnds.take(BlockData::of(last));
+        if (header != nullptr)
+        {
+            m_folds.remove(header);
+            updateItem(header);
+        }
+        // It may have been the header, its row summarized the fold.
+        updateItem(ensureBlockData(block));
+    }
+    updateButtonTab();
+}
+
+void AnnotationEdit::applyLineCosts(const QVector<LineCost> &costs, int source)
+{
+    // Costs come in line order, so mostly the next block is the one wanted.
+    QTextDocument *document = m_textEdit->document();
+    QTextBlock block;
+    LineNumber blockLine = -1;
+    for (const LineCost& cost : costs)
+    {
+        if (block.isValid() && cost.line == blockLine + 1)
+            block = block.next();
+        else
+            block = document->findBlockByNumber(cost.line);
+        blockLine = cost.line;
+        if (!block.isValid())
+            break;
+
+        ensureBlockData(block)->setCost(source, cost.nsecs);
+    }
+
+    updateHeat();
+}
+
+void AnnotationEdit::updateHeat()
+{
+    m_maxLineCost = 0;
+    for (auto it = m_items.constBegin(); it != m_items.constEnd(); ++it)
+        m_maxLineCost = qMax(m_maxLineCost, it.value()->totalCost());
+
+    for (auto it = m_items.constBegin(); it != m_items.constEnd(); ++it)
+        updateItemHeat(it.key(), it.value());
+}
+
+static QString sourceLabel(const QString& name, int source)
+{
+    return name.isEmpty() ? QString("annotator %1").arg(source) : name;
+}
+
+void AnnotationEdit::updateItemHeat(GraphicsAnnotationItem *item, const BlockData *data) const
+{
+    quint64 total = data->totalCost();
+    item->setHeat(m_maxLineCost == 0 ? 0 : qreal(total) / qreal(m_maxLineCost));
+
+    QStringList times;
+    for (int source = 0; source < m_annotators.size(); ++source)
+    {
+        if (data->cost(source) > 0)
+            times.append(QString("%1: %2 us").arg(sourceLabel(m_annotators[source].name, source))
+                                              .arg(data->cost(source) / 1000.0, 0, 'f', 1));
+    }
+    item->setToolTip(times.join('\n'));
+}
+
+void AnnotationEdit::setProfilingEnabled(bool enabled)
+{
+    if (enabled == m_profilingEnabled)
+        return;
+
+    m_profilingEnabled = enabled;
+    for (AnnotatorSlot& slot : m_annotators)
+    {
+        slot.worker->setProfilingEnabled(enabled);
+        // Every line gets a time, not only the ones edited next.
+        if (enabled)
+            slot.fullAnalysisPending = true;
+    }
+
+    if (enabled)
+    {
+        startAnalysisTimers();
+        return;
+    }
+
+    for (auto it = m_items.constBegin(); it != m_items.constEnd(); ++it)
+    {
+        it.value()->clearCosts();
+        it.key()->setHeat(0);
+        it.key()->setToolTip(QString());
+    }
+    m_maxLineCost = 0;
+}
+
+QString AnnotationEdit::profileReport(int topLines) const
+{
+    struct LineEntry
+    {
+        quint64 cost;
+        LineNumber line;
+        QString text;
+    };
+    struct CommandEntry
+    {
+        quint64 cost = 0;
+        int lines = 0;
+    };
+
+    QVector<quint64> sourceCosts(m_annotators.size());
+    QVector<int> sourceLines(m_annotators.size());
+    QVector<LineEntry> lines;
+    QHash<QString, CommandEntry> commands;
+
+    LineNumber line = 0;
+    for (QTextBlock block = document()->firstBlock(); block.isValid(); block = block.next(), ++line)
+    {
+        const BlockData* data = BlockData::of(block);
+        quint64 total = data != nullptr ? data->totalCost() : 0;
+        if (total == 0)
+            continue;
+
+        for (int source = 0; source < m_annotators.size(); ++source)
+        {
+            if (data->cost(source) > 0)
+            {
+                sourceCosts[source] += data->cost(source);
+                ++ sourceLines[source];
+            }
+        }
+
+        QString text = block.text();
+        CommandEntry& command = commands[firstField(text, ',').trimmed().toString()];
+        command.cost += total;
+        ++ command.lines;
+        lines.append(LineEntry{total, line, text});
+    }
+
+    QString report;
+    QTextStream out(&report);
+    out << "Analysis profile of " << (m_filePath.isEmpty() ? QString("unsaved text") : m_filePath) << "\n";
+    if (lines.isEmpty())
+    {
+        out << "No lines timed" << (m_profilingEnabled ? ", analysis is still running.\n" : ", profiling is off.\n");
+        return report;
+    }
+
+    out << "\nAnnotators\n";
+    for (int source = 0; source < m_annotators.size(); ++source)
+    {
+        if (sourceLines[source] == 0)
+            continue;
+        out << QString("  %1 %2 ms %3 lines %4 us/line\n")
+               .arg(sourceLabel(m_annotators[source].name, source), -20)
+               .arg(sourceCosts[source] / 1e6, 10, 'f', 2)
+               .arg(sourceLines[source], 8)
+               .arg(sourceCosts[source] / 1e3 / sourceLines[source], 10, 'f', 2);
+    }
+
+    int shown = qMin(topLines, lines.size());
+    std::partial_sort(lines.begin(), lines.begin() + shown, lines.end(),
+                      [](const LineEntry& a, const LineEntry& b) { return a.cost > b.cost; });
+    out << "\nSlowest lines\n";
+    for (int i = 0; i < shown; ++i)
+    {
+        out << QString("  %1 %2 us  %3\n")
+               .arg(lines[i].line + 1, 8)
+               .arg(lines[i].cost / 1e3, 12, 'f', 1)
+               .arg(lines[i].text.left(60));
+    }
+
+    QVector<QPair<quint64, QString>> byCost;
+    for (auto it = commands.constBegin(); it != commands.constEnd(); ++it)
+        byCost.append(qMakePair(it.value().cost, it.key()));
+    shown = qMin(topLines, byCost.size());
+    std::partial_sort(byCost.begin(), byCost.begin() + shown, byCost.end(),
+                      [](const QPair<quint64, QString>& a, const QPair<quint64, QString>& b) { return a.first > b.first; });
+    out << "\nCommands\n";
+    for (int i = 0; i < shown; ++i)
+    {
+        const CommandEntry& command = commands[byCost[i].second];
+        out << QString("  %1 %2 ms %3 lines %4 us/line\n")
+               .arg(byCost[i].second.isEmpty() ? QString("(blank)") : byCost[i].second, -20)
+               .arg(command.cost / 1e6, 10, 'f', 2)
+               .arg(command.lines, 8)
+               .arg(command.cost / 1e3 / command.lines, 10, 'f', 2);
+    }
+    return report;
+}
+
+bool AnnotationEdit::exportProfile(const QString &filePath, QString *error) const
+{
+    QSaveFile file(filePath);
+    if (!file.open(QFile::WriteOnly | QFile::Text))
+    {
+        if (error != nullptr)
+            *error = file.errorString();
+        return false;
+    }
+
+    file.write(profileReport().toUtf8());
+    if (!file.commit())
+    {
+        if (error != nullptr)
+            *error = file.errorString();
+        return false;
+    }
+    return true;
+}
+
+void AnnotationEdit::removeItem(GraphicsAnnotationItem *item)
+{
+    m_items.remove(item);
+    removeMessageWidth(item->messageWidth());
+    if (m_currentItem == item)
+        m_currentItem = nullptr;
+    delete item;
+}
+
+void AnnotationEdit::blockDataDeleted(BlockData *data)
+{
+    // Its labels go, what referred to them or defined them too is checked again.
+    m_symbolDirty.remove(data);
+    m_symbolIndex.remove(data, m_changedSymbols);
+
+    // A fold losing its header or its last line is undone once the edit is through.
+    m_foldRepairs.remove(data);
+    if (m_folds.contains(data))
+        m_foldEnds.remove(m_folds.take(data));
+    if (m_foldEnds.contains(data))
+    {
+        BlockData* header = m_foldEnds.take(data);
+        m_folds.remove(header);
+        m_foldRepairs.insert(header);
+    }
+
+    // Its line numbers are gone already, the index is updated once the change is reported.
+    if (data->item() != nullptr)
+        removeItem(data->item());
+}
+
+bool AnnotationEdit::updateLineMetrics()
+{
+    QTextLine line = m_textEdit->document()->firstBlock().layout()->lineAt(0);
+    if(! line.isValid()) {
+        qWarning() << "Invalid line found: Probably too early to function.";
+        return false;
+    }
+
+    int ascent = int(line.ascent());
+    int descent = int(line.descent());
+    if (ascent == m_textEdit->ascent() && descent == m_textEdit->descent())
+        return true;
+
+    m_textEdit->setAscentDescent(ascent,descent);
+    for (auto it = m_items.constBegin(); it != m_items.constEnd(); ++it)
+        it.key()->setLineAscentDescent(ascent, descent);
+    repositionItems(0);
+    return true;
+}
+
+void AnnotationEdit::applyResult(AnnotationResult result, int source, bool addSyntaxErrors)
+{
+    if (!updateLineMetrics())
+    {
+        // Layout passes no longer schedule analysis, so try again once it has settled.
+        // The blocks are still dirty, so they are analyzed again.
+        startAnalysisTimers();
+        return;
+    }
+
+    QTextDocument *document = m_textEdit->document();
+    QVector<QPair<LineNumber, LineNumber>> ranges = result.lineRanges();
+    if (!result.isPartial())
+    {
+        ranges.append(qMakePair(0, document->blockCount()));
+        m_annotators[source].fullAnalysisPending = false;
+    }
+
+    // A profiled result arriving after profiling was turned off is not shown.
+    if (m_profilingEnabled && !result.lineCosts().isEmpty())
+        applyLineCosts(result.lineCosts(), source);
+
+    // Only lines whose annotations changed touch their row, the index and the overview ruler.
+    AnnotationMap annotations = result.release();
+    bool changed = false;
+    for (const QPair<LineNumber, LineNumber>& range : ranges)
+    {
+        QTextBlock block = document->findBlockByNumber(range.first);
+        for (LineNumber line = range.first; line < range.second && block.isValid(); ++line, block = block.next())
+        {
+            AnnotationContainer container = annotations.take(line);
+            if (block.text().isEmpty())
+            {
+                qDeleteAll(container);
+                container.clear();
+            }
+
+            // The lexer's syntax errors travel with the first annotator's results.
+            BlockData *data = ensureBlockData(block);
+            if (addSyntaxErrors && source == 0)
+                appendSyntaxErrors(data, container);
+            for (Annotation* annotation : container)
+                annotation->setSource(m_annotators[source].name);
+            if (!setBlockAnnotations(data, source, container))
+                continue;
+
+            m_annotationIndex.setLine(line, data->annotations());
+            m_summaryTree.setLine(line, data->annotations());
+            m_overviewRuler->setLine(line, data->annotations());
+            changed = true;
+        }
+    }
+    for (auto it = annotations.constBegin(); it != annotations.constEnd(); ++it)
+        qDeleteAll(it.value());
+
+    if (changed)
+        updateFoldSummaries();
+    updateButtonTab();
+    if (changed)
+        emit annotationCountsChanged();
+
+    synchronizeSceneWithDocument();
+}
+
+void AnnotationEdit::analysisFinished(int source)
+{
+    // A stale result is deleted with it: the text changed and a newer run is scheduled.
+    AnnotationResult result = m_annotators[source].worker->takeResult();
+    if (result.revision() != m_revision)
+        return;
+
+    applyResult(std::move(result), source);
+    m_annotators[source].loaded = true;
+
+    // Stored once every annotator has been heard from, so the cache has all of the sources.
+    bool allLoaded = true;
+    for (const AnnotatorSlot& slot : m_annotators)
+        allLoaded = allLoaded && slot.loaded;
+    if (m_cachePending && allLoaded)
+    {
+        storeCache();
+        m_cachePending = false;
+    }
+}
+
+void AnnotationEdit::storeCache()
+{
+    // Only results that describe the file as it is on disk are worth keeping.
+    if(m_textEdit->document()->isModified())
+        return;
+
+    // The blocks keep owning the annotations, the map only lends them to the cache.
+    AnnotationMap annotations;
+    FormatRunMap formats;
+    LineNumber lineNum = 0;
+    QTextDocument *document = m_textEdit->document();
+    for (QTextBlock block = document->begin(); block != document->end(); block = block.next())
+    {
+        BlockData *data = BlockData::of(block);
+        if (data != nullptr && !data->annotations().isEmpty())
+            annotations.insert(lineNum, data->annotations());
+        FormatRunList runs = m_highlighter->formatRuns(block);
+        if (!runs.isEmpty())
+            formats.insert(lineNum, runs);
+        ++ lineNum;
+    }
+
+    m_cache.store(m_cacheKey, annotations, formats);
+}
+
+void AnnotationEdit::synchronizeSceneWithDocument()
+{
+    if (m_bulkEditDepth > 0)
+    {
+        m_bulkSceneSyncPending = true;
+        return;
+    }
+
+    QTextDocument *document = m_textEdit->document();
+    //qDebug() << "height " << height() << " gv height " << m_graphicsView->height() << "gvc " << m_gvContainer->height() << " empyt " << m_empty->height();
+    int size = int(document->documentLayout()->documentSize().height());
+    if (size <= m_textEdit->height() - 1)
+        size = m_graphicsView->height() - 2;
+
+    //qDebug() << "TextDoc: " << size << "  Canvas: " << rect;
+
+    m_graphicsScene->setSceneRect(QRectF(0,0,m_graphicsView->width(),size));
+//    qDebug() << m_textEdit->viewport()->size() << m_graphicsView->size();
+}
+
+void AnnotationEdit::repositionItems(int firstBlock)
+{
+    int ascent = m_textEdit->ascent();
+    QTextBlock block = m_textEdit->document()->findBlockByNumber(firstBlock);
+    for (int blockNumber = firstBlock; block.isValid(); block = block.next(), ++blockNumber)
+    {
+        BlockData *data = BlockData::of(block);
+        if (data != nullptr && data->item() != nullptr)
+            data->item()->setPos(0, int(m_textEdit->blockTop(blockNumber)) + ascent);
     }
+}
+
+void AnnotationEdit::textEditScrollBarChanged(int value)
+{
+    // I had trouble with event feedback so I had to squelch the cross signalling while updating.
+    //  They scrollbars where keeping each other busy.
+
+    double ratio = (double)value/m_textEdit->verticalScrollBar()->maximum();
+
+//    qDebug() << "TE->GV: "
+//             << "  GV: " << m_graphicsView->verticalScrollBar()->minimum() << m_graphicsView->verticalScrollBar()->value() << m_graphicsView->verticalScrollBar()->maximum()
+//             << "  TE: " << m_textEdit->verticalScrollBar()->minimum() << m_textEdit->verticalScrollBar()->value() << m_textEdit->verticalScrollBar()->maximum()
+//             << "  ==> " << value << ratio;
+
+    disconnect(m_graphicsView->verticalScrollBar(), &QScrollBar::valueChanged, this, &AnnotationEdit::graphicsViewScrollBarChanged);
+    m_graphicsView->verticalScrollBar()->setValue(ratio * m_graphicsView->verticalScrollBar()->maximum());
+    connect(m_graphicsView->verticalScrollBar(), &QScrollBar::valueChanged, this, &AnnotationEdit::graphicsViewScrollBarChanged);
+}
+
+void AnnotationEdit::graphicsViewScrollBarChanged(int value)
+{
+    // I had trouble with event feedback so I had to squelch the cross signalling while updating.
+    //  They scrollbars where keeping each other busy.
+
+    double ratio = (double)value/m_graphicsView->verticalScrollBar()->maximum();
+
+//    qDebug() << "GV->TE: "
+//             << "  GV: " << m_graphicsView->verticalScrollBar()->minimum() << m_graphicsView->verticalScrollBar()->value() << m_graphicsView->verticalScrollBar()->maximum()
+//             << "  TE: " << m_textEdit->verticalScrollBar()->minimum() << m_textEdit->verticalScrollBar()->value() << m_textEdit->verticalScrollBar()->maximum()
+//             << "  ==> " << value << ratio;
+
+    disconnect(m_textEdit->verticalScrollBar(), &QScrollBar::valueChanged, this, &AnnotationEdit::textEditScrollBarChanged);
+    m_textEdit->verticalScrollBar()->setValue(ratio * m_textEdit->verticalScrollBar()->maximum());
+    connect(m_textEdit->verticalScrollBar(), &QScrollBar::valueChanged, this, &AnnotationEdit::textEditScrollBarChanged);
+}
+
+void AnnotationEdit::overviewPositionClicked(double ratio)
+{
+    // Centre the clicked position, the graphics view follows through the scrollbar sync.
+    QScrollBar* scrollBar = m_textEdit->verticalScrollBar();
+    int value = int(ratio * (scrollBar->maximum() + scrollBar->pageStep())) - scrollBar->pageStep() / 2;
+    scrollBar->setValue(qBound(scrollBar->minimum(), value, scrollBar->maximum()));
+}
+
+void AnnotationEdit::findAll(const QString &query, Qt::CaseSensitivity cs)
+{
+    m_findQuery = query;
+    m_findCase = cs;
+    m_findRestartTimer.stop();
+
+    if (m_findQuery.isEmpty())
+    {
+        clearFind();
+        return;
+    }
+
+    startFind();
+}
+
+void AnnotationEdit::clearFind()
+{
+    m_findQuery.clear();
+    m_findRestartTimer.stop();
+    m_searchWorker->cancel();
+    ++ m_findGeneration;
+    m_findRunning = false;
+
+    m_findMatches.clear();
+    m_textEdit->setSearchSelections(QList<QTextEdit::ExtraSelection>());
+    emit findMatchCountChanged(0);
+}
+
+void AnnotationEdit::startFind()
+{
+    if (m_findQuery.isEmpty())
+        return;
+
+    // The worker searches a snapshot, its positions are document positions as long as the
+    // generation still matches.
+    ++ m_findGeneration;
+    m_findRunning = true;
+    m_findMatches.clear();
+    m_textEdit->setSearchSelections(QList<QTextEdit::ExtraSelection>());
+    emit findMatchCountChanged(0);
+
+    m_searchWorker->search(m_textEdit->toPlainText(), m_findQuery, m_findCase, m_findGeneration);
+}
+
+void AnnotationEdit::findContentsChanged()
+{
+    if (m_findQuery.isEmpty())
+        return;
+
+    // Positions from before the edit are stale, search again once typing pauses.
+    m_searchWorker->cancel();
+    ++ m_findGeneration;
+    m_findRunning = true;
+    if (!m_findMatches.isEmpty())
+    {
+        m_findMatches.clear();
+        m_textEdit->setSearchSelections(QList<QTextEdit::ExtraSelection>());
+        emit findMatchCountChanged(0);
+    }
+    m_findRestartTimer.start();
+}
+
+void AnnotationEdit::findMatchesFound(int generation, QVector<int> positions)
+{
+    if (generation != m_findGeneration || positions.isEmpty())
+        return;
+
+    // Chunks arrive in document order, so the list stays sorted.
+    m_findMatches += positions;
+    emit findMatchCountChanged(m_findMatches.count());
+
+    int first = 0, last = 0;
+    visibleTextRange(first, last);
+    if (positions.first() <= last && positions.last() + m_findQuery.size() >= first)
+        updateFindSelections();
+}
+
+void AnnotationEdit::findSearchFinished(int generation, int count)
+{
+    if (generation != m_findGeneration)
+        return;
+
+    m_findRunning = false;
+    emit findFinished(count);
+}
+
+void AnnotationEdit::visibleTextRange(int &first, int &last) const
+{
+    // Whole blocks, so matches scrolled off horizontally are still selected.
+    QWidget* viewport = m_textEdit->viewport();
+    QTextBlock firstBlock = m_textEdit->cursorForPosition(QPoint(0,0)).block();
+    QTextBlock lastBlock = m_textEdit->cursorForPosition(QPoint(0,viewport->height())).block();
+    first = firstBlock.position();
+    last = lastBlock.position() + lastBlock.length();
+}
+
+void AnnotationEdit::updateFindSelections()
+{
+    if (m_findMatches.isEmpty())
+        return;
+
+    int first = 0, last = 0;
+    visibleTextRange(first, last);
+
+    auto begin = std::lower_bound(m_findMatches.constBegin(), m_findMatches.constEnd(), first - m_findQuery.size() + 1);
+    auto end = std::upper_bound(begin, m_findMatches.constEnd(), last);
+
+    QTextCharFormat format;
+    format.setBackground(QColor("#FFE066"));
+
+    QList<QTextEdit::ExtraSelection> selections;
+    for (auto it = begin; it != end && selections.count() < maxFindSelections; ++it)
+    {
+        QTextEdit::ExtraSelection selection;
+        selection.format = format;
+        selection.cursor = QTextCursor(m_textEdit->document());
+        selection.cursor.setPosition(*it);
+        selection.cursor.setPosition(*it + m_findQuery.size(), QTextCursor::KeepAnchor);
+        selections.append(selection);
+    }
+    m_textEdit->setSearchSelections(selections);
+}
+
+bool AnnotationEdit::findNext()
+{
+    if (m_findMatches.isEmpty())
+        return false;
+
+    int from = m_textEdit->textCursor().selectionStart();
+    auto it = std::upper_bound(m_findMatches.constBegin(), m_findMatches.constEnd(), from);
+    selectMatch(it != m_findMatches.constEnd() ? *it : m_findMatches.first());
+    return true;
+}
+
+bool AnnotationEdit::findPrevious()
+{
+    if (m_findMatches.isEmpty())
+        return false;
+
+    int from = m_textEdit->textCursor().selectionStart();
+    auto it = std::lower_bound(m_findMatches.constBegin(), m_findMatches.constEnd(), from);
+    selectMatch(it != m_findMatches.constBegin() ? *(it - 1) : m_findMatches.last());
+    return true;
+}
+
+void AnnotationEdit::selectMatch(int position)
+{
+    QTextCursor cursor(m_textEdit->document());
+    cursor.setPosition(position);
+    cursor.setPosition(position + m_findQuery.size(), QTextCursor::KeepAnchor);
+    revealBlock(cursor.block());
+    m_textEdit->setTextCursor(cursor);
+    m_textEdit->ensureCursorVisible();
+}
+
+void AnnotationEdit::showPopup(GraphicsAnnotationItem *item)
+{
+    BlockData *data = m_items.value(item);
+    AnnotationContainer container = data != nullptr ? data->annotations() : AnnotationContainer();
+    if (!container.isEmpty())
+    {
+        item->setFont(QFont(fontFamilyAnnotation,fontSize,QFont::Bold));
+        item->update();
+        QStringList helpTexts;
+        for (const Annotation* annotation : container)
+            helpTexts.append(solutionHelp(annotation));
+
+        if (m_annotationDialog == nullptr)
+            m_annotationDialog = new AnnotationDialog(this);
+        m_annotationDialog->setAnnotations(container, helpTexts);
+        m_annotationDialog->exec();
+        item->setFont(QFont(fontFamilyAnnotation,fontSize,QFont::Normal));
+        item->update();
+    }
+}
+
+QString AnnotationEdit::solutionHelp(const Annotation *annotation) const
+{
+    // Help carried by the annotation wins, a key is only resolved when the popup needs it.
+    if (!annotation->solutionHelp().isEmpty() || annotation->helpKey().isEmpty())
+        return annotation->solutionHelp();
+
+    if (m_helpProvider != nullptr)
+    {
+        QString help = m_helpProvider->solutionHelp(annotation->helpKey());
+        if (!help.isEmpty())
+            return help;
+    }
+    // The annotator the annotation came from first, then any which knows the key.
+    for (const AnnotatorSlot& slot : m_annotators)
+    {
+        if (slot.name == annotation->source())
+            return slot.annotator->solutionHelp(annotation->helpKey());
+    }
+    for (const AnnotatorSlot& slot : m_annotators)
+    {
+        QString help = slot.annotator->solutionHelp(annotation->helpKey());
+        if (!help.isEmpty())
+            return help;
+    }
+    return QString();
+}
+
+QString AnnotationEdit::priorityMessage(const AnnotationContainer& container, int& buttonIndex)
+{
+    // The first visible annotation of the highest category wins.
+    buttonIndex = -1;
+    for (int i=0; i<container.count(); i++)
+    {
+        if (!isCategoryVisible(container[i]->category()))
+            continue;
+        if (buttonIndex == -1 || container[i]->category() > container[buttonIndex]->category())
+            buttonIndex = i;
+    }
+
+    if (buttonIndex == -1)
+        return "";
     return container[buttonIndex]->message();
 }
 
+void AnnotationEdit::setCategoryVisible(Annotation::Category category, bool visible)
+{
+    quint8 bit = quint8(1 << category);
+    quint8 mask = visible ? quint8(m_categoryMask | bit) : quint8(m_categoryMask & ~bit);
+    if (mask == m_categoryMask)
+        return;
+
+    m_categoryMask = mask;
+    m_overviewRuler->setCategoryVisible(category, visible);
+
+    if (m_currentItem != nullptr)
+    {
+        m_currentItem->setFont(QFont(fontFamilyAnnotation,fontSize,QFont::Normal));
+        m_currentItem = nullptr;
+    }
+
+    // Re-selects from the results already held by each row, nothing is analyzed or recreated.
+    for (auto it = m_items.constBegin(); it != m_items.constEnd(); ++it)
+    {
+        if (!it.value()->annotations().isEmpty() && !m_folds.contains(it.value()))
+            applyCategoryFilter(it.key(), it.value()->annotations());
+    }
+    updateFoldSummaries();
+}
+
+void AnnotationEdit::applyCategoryFilter(GraphicsAnnotationItem *item, const AnnotationContainer &container)
+{
+    QVector<int> visible;
+    for (int i=0; i<container.count(); i++)
+    {
+        if (isCategoryVisible(container[i]->category()))
+            visible.append(i);
+    }
+
+    int buttonIndex = -1;
+    QString priorityString = priorityMessage(container, buttonIndex);
+    if (visible.count() > 1)
+        priorityString += " (" + QString::number(visible.count()) + ')';
+
+    item->setVisibleAnnotations(visible, buttonIndex);
+    item->setPlainText(priorityString);
+    if (buttonIndex != -1)
+        item->setDefaultTextColor(container[buttonIndex]->alertColor());
+    item->update();
+}
+
+bool AnnotationEdit::gotoNextAnnotation(Annotation::Category category)
+{
+    LineNumber current = m_textEdit->textCursor().blockNumber();
+    LineNumber line = m_annotationIndex.nextLine(category, current);
+    if (line == -1)
+        line = m_annotationIndex.nextLine(category, -1);
+    if (line == -1)
+        return false;
+
+    gotoLine(line);
+    return true;
+}
+
+bool AnnotationEdit::gotoPreviousAnnotation(Annotation::Category category)
+{
+    LineNumber current = m_textEdit->textCursor().blockNumber();
+    LineNumber line = m_annotationIndex.previousLine(category, current);
+    if (line == -1)
+        line = m_annotationIndex.previousLine(category, m_textEdit->document()->blockCount());
+    if (line == -1)
+        return false;
+
+    gotoLine(line);
+    return true;
+}
+
+void AnnotationEdit::gotoLine(LineNumber line)
+{
+    QTextBlock block = m_textEdit->document()->findBlockByNumber(line);
+    if (!block.isValid())
+        return;
+
+    revealBlock(block);
+    m_textEdit->setTextCursor(QTextCursor(block));
+    m_textEdit->ensureCursorVisible();
+    m_textEdit->setFocus();
+}
+
 int AnnotationEdit::textWidth(const QString &string) const
 {
-    QFont font(fontFamilyAnnotation,fontSize,QFont::Bold);
-    QFontMetrics metrics(font);
-    return metrics.horizontalAdvance(string);
+    return m_annotationMetrics.horizontalAdvance(string);
+}
+
+void AnnotationEdit::addMessageWidth(int width)
+{
+    ++ m_messageWidths[width];
+}
+
+void AnnotationEdit::removeMessageWidth(int width)
+{
+    auto it = m_messageWidths.find(width);
+    if (it != m_messageWidths.end() && -- it.value() == 0)
+        m_messageWidths.erase(it);
+}
+
+void AnnotationEdit::updateButtonTab()
+{
+    // Items only move when the widest message changed.
+    int widest = m_messageWidths.isEmpty() ? 0 : m_messageWidths.lastKey();
+    int buttonTab = widest + textWidth("   ");
+    if (buttonTab == m_buttonTab)
+        return;
+
+    m_buttonTab = buttonTab;
+    for (auto it = m_items.constBegin(); it != m_items.constEnd(); ++it)
+        it.key()->setButtonTab(m_buttonTab);
 }
 
 int AnnotationEdit::longestWidth(const AnnotationContainer& container) const
@@ -440,17 +2156,26 @@ int AnnotationEdit::longestWidth(const AnnotationContainer& container) const
 
 void AnnotationEdit::deleteAll()
 {
+    // The document may outlive the rows, its blocks must not report back to them.
+    for (auto it = m_items.constBegin(); it != m_items.constEnd(); ++it)
+    {
+        it.value()->detach();
+        it.value()->setItem(nullptr);
+    }
+
+    m_symbolIndex.clear();
+    m_symbolDirty.clear();
+    m_changedSymbols.clear();
+    m_folds.clear();
+    m_foldEnds.clear();
+    m_foldRepairs.clear();
+
     GraphicsAnnotationItem::setHighlight(nullptr);
     m_currentItem = nullptr;
     m_graphicsScene->clear();
-    m_itemMap.clear();
-    m_blockToItemMap.clear();
-    m_itemToBlockMap.clear();
-
-    for(auto container: m_annotationMap.values())
-        qDeleteAll(container);
-
-    m_annotationMap.clear();
+    m_items.clear();
+    m_messageWidths.clear();
+    m_buttonTab = -1;
 }
 
 bool AnnotationEdit::extractLines(QTextDocument *document, QStringList& lines)
@@ -461,11 +2186,12 @@ bool AnnotationEdit::extractLines(QTextDocument *document, QStringList& lines)
 
     while(block.isValid())
     {
-        auto text = block.text();
-        if(! text.trimmed().isEmpty())
-            allBlank = false;
+        // Checked in place, trimming would copy every line.
+        QString text = block.text();
+        for(int i = 0; allBlank && i < text.size(); ++i)
+            allBlank = text.at(i).isSpace();
 
-        lines.append( block.text() );
+        lines.append( text );
         block = block.next();
     }
 
@@ -476,22 +2202,33 @@ bool AnnotationEdit::extractLines(QTextDocument *document, QStringList& lines)
     return false;
 }
 
+QVector<QPair<LineNumber, LineNumber>> AnnotationEdit::dirtyLines(int source) const
+{
+    QVector<QPair<LineNumber, LineNumber>> ranges;
+    LineNumber line = 0;
+    for (QTextBlock block = m_textEdit->document()->firstBlock(); block.isValid(); block = block.next(), ++line)
+    {
+        // Blocks without data have not been seen yet.
+        BlockData* data = BlockData::of(block);
+        if (data != nullptr && !data->isDirty(source))
+            continue;
+
+        if (!ranges.isEmpty() && ranges.last().second == line)
+            ++ ranges.last().second;
+        else
+            ranges.append(qMakePair(line, line + 1));
+    }
+    return ranges;
+}
+
 void AnnotationEdit::highlightLine(GraphicsAnnotationItem *item)
 {
     bool highlighted = false;
-    if (item != nullptr)
+    BlockData *data = m_items.value(item, nullptr);
+    if (data != nullptr)
     {
-       int blockNumber = m_itemToBlockMap[item];
-       QTextDocument *document = m_textEdit->document();
-       for (QTextBlock block = document->begin(); block != document->end(); block = block.next())
-       {
-           if (block.blockNumber() == blockNumber)
-           {
-               m_textEdit->highlightCurrentLine(block,true);
-               highlighted = true;
-               break;
-           }
-       }
+       m_textEdit->highlightCurrentLine(data->block(),true);
+       highlighted = true;
     }
    if (!highlighted)
    {
@@ -21,44 +21,199 @@ CodeTextEdit is free software dual licensed under the GNU LGPL or MIT License.
 #include <QGraphicsScene>
 #include <QGraphicsTextItem>
 #include <QTimer>
+#include <QFileSystemWatcher>
+#include <QLabel>
+#include <QVBoxLayout>
+#include <QFontMetrics>
+#include <QHash>
 
 #include "CodeTextHighlighter.h"
 #include "Annotation.h"
 #include "AnnotationTextEdit.h"
 #include "AnnotationGraphicsView.h"
+#include "AnnotationCache.h"
+#include "AnnotationResult.h"
+#include "AnnotationIndex.h"
+#include "AnnotationSummaryTree.h"
+#include "AnnotationOverviewRuler.h"
+#include "BlockData.h"
+#include "SymbolIndex.h"
 
 namespace codetextedit
 {
     class AnnotationWorker;
+    class SearchWorker;
+    class DocumentSaver;
+    class FileChangeWorker;
+    struct LineHunk;
     class GraphicsAnnotationItem;
     class AnnotationGraphicsView;
     ///
     /// \brief The AnnotationDialog class
     ///
+    /// Created once per editor. Its labels are reused between popups, extra ones are hidden.
+    ///
     class AnnotationDialog : public QDialog
     {
         Q_OBJECT
     public:
-        AnnotationDialog(const AnnotationContainer&, QWidget* parent);
+        AnnotationDialog(QWidget* parent);
+
+        /// helpTexts holds the solution help of each annotation, in the container's order.
+        void setAnnotations(const AnnotationContainer&, const QStringList& helpTexts);
+
+    private:
+        struct Entry
+        {
+            QLabel* message;
+            QLabel* help;
+            QLabel* separator;
+        };
+
+        QVBoxLayout*    m_layout;
+        QVector<Entry>  m_entries;
     };
 
     ///
     /// \brief The AnnotationEdit class
     ///
-    class AnnotationEdit : public QWidget
+    /// Annotations are kept with the text blocks they belong to, so inserting or removing
+    /// lines moves them along straight away. Only edited blocks are analyzed again, by each
+    /// annotator on its own thread and schedule.
+    ///
+    class AnnotationEdit : public QWidget, private BlockData::Observer
     {
         Q_OBJECT
 
     public:
+        /// How soon an annotator runs after an edit.
+        enum Schedule
+        {
+            SCHEDULE_Keystroke,     // As soon as typing pauses
+            SCHEDULE_Idle,          // Once the editor has been idle for a while
+        };
+
         AnnotationEdit(Annotator* annotator, CodeTextHighlighter* highlighter, QWidget *parent = nullptr);
         virtual ~AnnotationEdit();
 
+        /// Adds an annotator, before a file is loaded. The constructor's annotator is the first,
+        /// a keystroke one without a name. Each runs concurrently on its own thread and its
+        /// results show as soon as they are ready, merged per line in the order the annotators
+        /// were added. The name marks their source, see Annotation::source().
+        void addAnnotator(Annotator* annotator, const QString& name, Schedule schedule);
+        int annotatorCount() const {return m_annotators.size();}
+
         void loadFile(QString filePath);
+        /// Saves in the background, then emits fileSaved() or saveFailed(). The text is read in
+        /// chunks between events and written on another thread, the editor stays read only
+        /// until all of it has been read. False if a save is already running. loadFile(),
+        /// setContents(), setPlainText() and beginBulkEdit() cancel a running save, which then
+        /// emits saveFailed() and leaves the file untouched.
+        bool saveFile(QString filePath);
+        bool isSaving() const {return m_saver != nullptr;}
+
+        /// Watches the loaded file. A change on disk is diffed against the buffer in the
+        /// background and only the changed lines are replaced, the view stays where it was.
+        /// Off by default.
+        void setFileWatchingEnabled(bool enabled);
+        bool isFileWatchingEnabled() const {return m_fileWatchingEnabled;}
+        /// Merges in the file on disk the same way, even over unsaved edits.
+        void reloadFromDisk();
+        QString filePath() const {return m_filePath;}
+        void setCacheEnabled(bool enabled) {m_cacheEnabled = enabled;}
+        bool isCacheEnabled() const {return m_cacheEnabled;}
+
+        /// Looked up before the annotators for annotations which only carry a help key.
+        void setSolutionHelpProvider(SolutionHelpProvider* provider) {m_helpProvider = provider;}
+        QString solutionHelp(const Annotation* annotation) const;
         void setContents(QString contents);
         QString toPlainText();
         void setPlainText(QString text);
+
+        QTextDocument* document() const {return m_textEdit->document();}
+
+        /// Opens a bulk edit, scopes nest. Until the outermost one closes, edits are not
+        /// highlighted, analyzed or synced to the gutter, only the ranges they touch are
+        /// collected. Closing it rehighlights those ranges and analyzes once.
+        void beginBulkEdit();
+        void endBulkEdit();
+        bool isInBulkEdit() const {return m_bulkEditDepth > 0;}
+
+        ///
+        /// \brief Keeps a bulk edit open for its lifetime.
+        ///
+        class BulkEdit
+        {
+        public:
+            explicit BulkEdit(AnnotationEdit* edit) : m_edit(edit) {m_edit->beginBulkEdit();}
+            ~BulkEdit() {m_edit->endBulkEdit();}
+        private:
+            Q_DISABLE_COPY(BulkEdit)
+            AnnotationEdit* m_edit;
+        };
+
+        /// Lines wrap at the editor's width. Off by default.
+        void setWordWrapEnabled(bool enabled);
+        bool isWordWrapEnabled() const;
+        /// Line numbers left of the text. On by default.
+        void setLineNumbersVisible(bool visible) {m_textEdit->setLineNumbersVisible(visible);}
+        bool lineNumbersVisible() const {return m_textEdit->lineNumbersVisible();}
+
+        /// Totals for a status bar.
+        int annotationCount(Annotation::Category category) const {return m_annotationIndex.annotationCount(category);}
+        int annotatedLineCount(Annotation::Category category) const {return m_annotationIndex.lineCount(category);}
+        const AnnotationIndex& annotationIndex() const {return m_annotationIndex;}
+
+        /// Hides or shows a category in the gutter without analyzing again.
+        void setCategoryVisible(Annotation::Category category, bool visible);
+        bool isCategoryVisible(Annotation::Category category) const {return m_categoryMask & (1 << category);}
+
+        /// Moves the cursor to the next (previous) line holding the category, wrapping around.
+        bool gotoNextAnnotation(Annotation::Category category);
+        bool gotoPreviousAnnotation(Annotation::Category category);
+        void gotoLine(LineNumber line);
+
+        /// Folds the lines below the given one: up to the next label when it defines one,
+        /// otherwise the lines indented deeper than it. Its gutter row then summarizes the
+        /// annotations of the line and the folded ones. Folds inside are merged into it.
+        /// False if there is nothing to fold.
+        bool foldLine(LineNumber line);
+        bool unfoldLine(LineNumber line);
+        bool toggleFold(LineNumber line);
+        void unfoldAll();
+        bool isFolded(LineNumber line) const;
+        /// End of the lines foldLine() would fold, line + 1 if there are none.
+        LineNumber foldEnd(LineNumber line);
+
+        /// Finds every match of the query in the background. Matches are highlighted as
+        /// they arrive, an edit or a new query cancels the search in progress.
+        void findAll(const QString& query, Qt::CaseSensitivity cs = Qt::CaseInsensitive);
+        void clearFind();
+        /// Selects the next (previous) match from the cursor, wrapping around.
+        bool findNext();
+        bool findPrevious();
+        int findMatchCount() const {return m_findMatches.count();}
+        bool isFindRunning() const {return m_findRunning;}
+
+        /// Times each line every annotator analyzes and shades its gutter row by the time,
+        /// darkest on the slowest line, with the times in the row's tooltip. Turning it on
+        /// analyzes the whole document again. Annotators without analyzeRange() are not
+        /// timed per line. Off by default.
+        void setProfilingEnabled(bool enabled);
+        bool isProfilingEnabled() const {return m_profilingEnabled;}
+        /// The profile as text: time per annotator, the slowest lines and the time per
+        /// command, the first field of a line, which points at the rules that cost most.
+        QString profileReport(int topLines = 20) const;
+        bool exportProfile(const QString& filePath, QString* error = nullptr) const;
     signals:
         void textChanged();
+        void annotationCountsChanged();
+        void findMatchCountChanged(int count);
+        void findFinished(int count);
+        void fileSaved(QString filePath);
+        void saveFailed(QString filePath, QString error);
+        /// The file changed on disk while the buffer has unsaved edits, nothing was merged.
+        void fileChangedOnDisk(QString filePath);
 
     protected:
         void resizeEvent(QResizeEvent *) override;
@@ -66,26 +221,138 @@ namespace codetextedit
 
     private slots:
         void updateAnnotations();
-        void refreshAnnotations();
-        void rebuildAnnotations(AnnotationMap annotations);
+        void refreshAnnotations(Schedule schedule);
+        void analysisFinished(int source);
+        void documentContentsChange(int position, int charsRemoved, int charsAdded);
         void synchronizeSceneWithDocument();
+        void repositionItems(int firstBlock);
 
         void textEditScrollBarChanged(int);
         void graphicsViewScrollBarChanged(int);
         void highlightLine(GraphicsAnnotationItem*);
+        void overviewPositionClicked(double ratio);
+        void findMatchesFound(int generation, QVector<int> positions);
+        void findSearchFinished(int generation, int count);
+        void findContentsChanged();
+        void startFind();
+        void updateFindSelections();
+        void saveStep();
+        void saveFinished(QString filePath);
+        void saveError(QString filePath, QString error);
+        void checkFileOnDisk();
+        void fileCompared();
+        void repairFolds();
     private:
         void showPopup(GraphicsAnnotationItem*);
+        void applyResult(AnnotationResult result, int source, bool addSyntaxErrors = true);
+        void startAnalysisTimers();
+        QString annotatorVersions() const;
+        bool updateLineMetrics();
+        void updateBlockStructure(int position, int charsAdded);
+        BlockData* ensureBlockData(const QTextBlock& block);
+        const QVector<KeywordSpan>& blockTokens(BlockData* data);
+        void appendSyntaxErrors(BlockData* data, AnnotationContainer& container);
+        void updateSymbols();
+        AnnotationContainer labelAnnotations(BlockData* data) const;
+        bool setBlockAnnotations(BlockData* data, int source, const AnnotationContainer& container);
+        void applyLineCosts(const QVector<LineCost>& costs, int source);
+        void updateHeat();
+        void updateItemHeat(GraphicsAnnotationItem* item, const BlockData* data) const;
+        void updateItem(BlockData* data);
+        GraphicsAnnotationItem* foldSummaryItem(BlockData* header);
+        void updateFoldSummaries();
+        void setBlocksVisible(QTextBlock first, QTextBlock last, bool visible);
+        void unfold(BlockData* header);
+        void revealBlock(const QTextBlock& block);
+        bool isLabelDefinition(BlockData* data);
+        void removeItem(GraphicsAnnotationItem* item);
+        void blockDataDeleted(BlockData* data) override;
         QString priorityMessage(const AnnotationContainer&, int&);
+        void applyCategoryFilter(GraphicsAnnotationItem*, const AnnotationContainer&);
         int textWidth(const QString&) const;
         int longestWidth(const AnnotationContainer&) const;
+        void addMessageWidth(int width);
+        void removeMessageWidth(int width);
+        void updateButtonTab();
         void deleteAll();
         bool extractLines(QTextDocument* document, QStringList& lines);
+        QVector<QPair<LineNumber, LineNumber>> dirtyLines(int source) const;
+        void storeCache();
+        void releaseSaver();
+        void cancelSave();
+        void restartDeferredFileCheck();
+        void updateFileWatch();
+        void applyHunks(const QVector<LineHunk>& hunks);
+        void visibleTextRange(int& first, int& last) const;
+        void addDirtyRange(int position, int charsRemoved, int charsAdded);
+        void selectMatch(int position);
 
         CodeTextHighlighter*    m_highlighter = nullptr;
-        QTimer                  m_annotationRefreshTimer;
-        Annotator*              m_annotator = nullptr;
-        AnnotationMap           m_annotationMap;
-        AnnotationWorker*       m_annotationWorker = nullptr;
+        struct AnnotatorSlot
+        {
+            Annotator*          annotator = nullptr;
+            QString             name;
+            Schedule            schedule = SCHEDULE_Keystroke;
+            AnnotationWorker*   worker = nullptr;
+            bool                fullAnalysisPending = false;    // Clean blocks are analyzed too
+            bool                loaded = false;                 // Has analyzed the loaded file
+        };
+
+        QTimer                  m_annotationRefreshTimer;   // Keystroke annotators
+        QTimer                  m_idleRefreshTimer;         // Idle annotators
+        QVector<AnnotatorSlot>  m_annotators;       // The index is the source in BlockData
+
+        SymbolIndex             m_symbolIndex;
+        QSet<BlockData*>        m_symbolDirty;      // Edited since their labels were indexed
+        QSet<QString>           m_changedSymbols;   // Labels whose definitions changed since the last check
+        bool                    m_profilingEnabled = false;
+        quint64                 m_maxLineCost = 0;  // Of any block, the heat map's scale
+        SolutionHelpProvider*   m_helpProvider = nullptr;
+        AnnotationDialog*       m_annotationDialog = nullptr;
+        AnnotationIndex         m_annotationIndex;
+        AnnotationSummaryTree   m_summaryTree;      // Counts over line ranges, for folded rows
+
+        QHash<BlockData*, BlockData*> m_folds;      // Header -> last folded block
+        QHash<BlockData*, BlockData*> m_foldEnds;   // Last folded block -> header
+        QSet<BlockData*>        m_foldRepairs;      // Edited near hidden blocks, see repairFolds()
+        quint8                  m_categoryMask = 0x0F;
+        QFontMetrics            m_annotationMetrics;
+        QMap<int, int>          m_messageWidths;    // Width -> items needing it, the widest sets the button column
+        int                     m_buttonTab = -1;
+        int                     m_revision = 0;     // Bumped by every content change
+        int                     m_blockCount = 1;   // As of the last content change
+
+        int                     m_bulkEditDepth = 0;
+        QVector<QPair<int,int>> m_dirtyRanges;      // Sorted, disjoint [start, end) in current positions
+        bool                    m_bulkAnalysisPending = false;
+        bool                    m_bulkSceneSyncPending = false;
+        int                     m_bulkRepositionFrom = -1;
+
+        AnnotationCache         m_cache;
+        AnnotationCache::Key    m_cacheKey;
+        QString                 m_filePath;
+        bool                    m_cacheEnabled = true;
+        bool                    m_cachePending = false;
+
+        DocumentSaver*          m_saver = nullptr;
+        QTextBlock              m_saveBlock;        // Next block to hand to the saver
+        int                     m_saveRevision = 0;
+        bool                    m_saveWasReadOnly = false;
+
+        QFileSystemWatcher      m_fileWatcher;
+        QTimer                  m_fileChangeTimer;
+        FileChangeWorker*       m_fileChangeWorker = nullptr;
+        bool                    m_fileWatchingEnabled = false;
+        bool                    m_forceReload = false;
+        bool                    m_fileCheckDeferred = false;    // Checked again once the save is done
+
+        SearchWorker*           m_searchWorker = nullptr;
+        QTimer                  m_findRestartTimer;
+        QString                 m_findQuery;
+        Qt::CaseSensitivity     m_findCase = Qt::CaseInsensitive;
+        int                     m_findGeneration = 0;
+        bool                    m_findRunning = false;
+        QVector<int>            m_findMatches;      // Sorted document positions.
 
         QSplitter*              m_splitter;
         QGraphicsScene*         m_graphicsScene;
@@ -93,11 +360,10 @@ namespace codetextedit
         AnnotationTextEdit*     m_textEdit;
         QWidget*                m_empty;
         QWidget*                m_gvContainer;
+        AnnotationOverviewRuler* m_overviewRuler;
 
         GraphicsAnnotationItem* m_currentItem = nullptr;
-        QMap<GraphicsAnnotationItem*, AnnotationContainer> m_itemMap;
-        QMap<int,GraphicsAnnotationItem*> m_blockToItemMap;
-        QMap<GraphicsAnnotationItem*,int> m_itemToBlockMap;
+        QHash<GraphicsAnnotationItem*, BlockData*> m_items;    // Every block has a row
 
         friend GraphicsAnnotationItem;
     };
@@ -0,0 +1,114 @@
+/***********************************************************************
+The CodeTextEditor provides an editor showing live hints and annotations.
+
+Copyright (c) 2020 Brian Newham <seaweedsolutionsltd@gmail.com>.
+
+CodeTextEdit is free software dual licensed under the GNU LGPL or MIT License.
+***********************************************************************/
+
+#include "AnnotationIndex.h"
+
+#include <QVector>
+#include <QPair>
+
+namespace codetextedit
+{
+
+void AnnotationIndex::clear()
+{
+    for(int category = 0; category < categoryCount; ++category) {
+        m_lines[category].clear();
+        m_annotationCount[category] = 0;
+    }
+}
+
+void AnnotationIndex::setLine(LineNumber line, const AnnotationContainer &container)
+{
+    int counts[categoryCount] = {};
+    for(const Annotation* annotation : container)
+        ++ counts[annotation->category()];
+
+    for(int category = 0; category < categoryCount; ++category) {
+        QMap<LineNumber, int>& lines = m_lines[category];
+        auto it = lines.find(line);
+        int old = it != lines.end() ? it.value() : 0;
+
+        if(old == counts[category])
+            continue;
+
+        m_annotationCount[category] += counts[category] - old;
+
+        if(counts[category] == 0)
+            lines.erase(it);
+        else if(it != lines.end())
+            it.value() = counts[category];
+        else
+            lines.insert(line, counts[category]);
+    }
+}
+
+void AnnotationIndex::removeLine(LineNumber line)
+{
+    setLine(line, AnnotationContainer());
+}
+
+void AnnotationIndex::removeLines(LineNumber first, LineNumber end)
+{
+    for(int category = 0; category < categoryCount; ++category) {
+        QMap<LineNumber, int>& lines = m_lines[category];
+        auto it = lines.lowerBound(first);
+        while(it != lines.end() && it.key() < end) {
+            m_annotationCount[category] -= it.value();
+            it = lines.erase(it);
+        }
+    }
+}
+
+void AnnotationIndex::shiftLines(LineNumber from, int delta)
+{
+    if(delta == 0)
+        return;
+
+    for(int category = 0; category < categoryCount; ++category) {
+        QMap<LineNumber, int>& lines = m_lines[category];
+        auto it = lines.lowerBound(from);
+        if(it == lines.end())
+            continue;
+
+        // Still in order after the move, so each one is appended with an end hint.
+        QVector<QPair<LineNumber, int>> moved;
+        while(it != lines.end()) {
+            moved.append(qMakePair(it.key() + delta, it.value()));
+            it = lines.erase(it);
+        }
+        for(const QPair<LineNumber, int>& line : moved)
+            lines.insert(lines.constEnd(), line.first, line.second);
+    }
+}
+
+LineNumber AnnotationIndex::nextLine(Annotation::Category category, LineNumber after) const
+{
+    const QMap<LineNumber, int>& lines = m_lines[category];
+    auto it = lines.upperBound(after);
+    return it != lines.constEnd() ? it.key() : -1;
+}
+
+LineNumber AnnotationIndex::previousLine(Annotation::Category category, LineNumber before) const
+{
+    const QMap<LineNumber, int>& lines = m_lines[category];
+    auto it = lines.lowerBound(before);
+    if(it == lines.constBegin())
+        return -1;
+    return (--it).key();
+}
+
+int AnnotationIndex::worstCategory(LineNumber line) const
+{
+    for(int category = categoryCount - 1; category >= 0; --category) {
+        if(m_lines[category].contains(line))
+            return category;
+    }
+    return -1;
+}
+
+} // namespace codetextedit
@@ -0,0 +1,57 @@
+/***********************************************************************
+The CodeTextEditor provides an editor showing live hints and annotations.
+
+Copyright (c) 2020 Brian Newham <seaweedsolutionsltd@gmail.com>.
+
+CodeTextEdit is free software dual licensed under the GNU LGPL or MIT License.
+***********************************************************************/
+
+#ifndef ANNOTATIONINDEX_H
+#define ANNOTATIONINDEX_H
+
+#include <QMap>
+
+#include "Annotation.h"
+
+namespace codetextedit
+{
+    ///
+    /// \brief Per category index over the annotated lines.
+    ///
+    /// Lines are kept in one ordered map per category, so next and previous lookups are
+    /// O(log n) and totals are kept as running counts.
+    ///
+    class AnnotationIndex
+    {
+    public:
+        static const int categoryCount = Annotation::CATEGORY_Error + 1;
+
+        void clear();
+
+        /// Replaces what the line contributes to the index.
+        void setLine(LineNumber line, const AnnotationContainer& container);
+        void removeLine(LineNumber line);
+        /// Removes lines [first, end).
+        void removeLines(LineNumber first, LineNumber end);
+        /// Moves every line from the given one on by delta, after lines were inserted or
+        /// removed. The lines moved over must have been removed first.
+        void shiftLines(LineNumber from, int delta);
+
+        /// First line after (before) the given one holding the category, -1 if there is none.
+        LineNumber nextLine(Annotation::Category category, LineNumber after) const;
+        LineNumber previousLine(Annotation::Category category, LineNumber before) const;
+
+        int annotationCount(Annotation::Category category) const {return m_annotationCount[category];}
+        int lineCount(Annotation::Category category) const {return m_lines[category].size();}
+
+        /// Highest category on the line, -1 if the line has no annotations.
+        int worstCategory(LineNumber line) const;
+
+    private:
+        QMap<LineNumber, int>   m_lines[categoryCount];     // Annotations of the category per line
+        int                     m_annotationCount[categoryCount] = {};
+    };
+
+} // namespace codetextedit
+
+#endif // ANNOTATIONINDEX_H
@@ -0,0 +1,229 @@
+/***********************************************************************
+The CodeTextEditor provides an editor showing live hints and annotations.
+
+Copyright (c) 2020 Brian Newham <seaweedsolutionsltd@gmail.com>.
+
+CodeTextEdit is free software dual licensed under the GNU LGPL or MIT License.
+***********************************************************************/
+
+#include "AnnotationOverviewRuler.h"
+
+#include <QPainter>
+#include <QPaintEvent>
+#include <QMouseEvent>
+
+#include <cstring>
+
+namespace codetextedit
+{
+
+static const int rulerWidth = 10;
+static const int markHeight = 3;
+
+AnnotationOverviewRuler::AnnotationOverviewRuler(QWidget *parent)
+    : QWidget(parent)
+{
+    for(int category = 0; category < categoryCount; ++category)
+        m_visible[category] = true;
+
+    setFixedWidth(rulerWidth);
+    setSizePolicy(QSizePolicy::Fixed, QSizePolicy::Expanding);
+    setCursor(Qt::PointingHandCursor);
+}
+
+QSize AnnotationOverviewRuler::sizeHint() const
+{
+    return QSize(rulerWidth, 100);
+}
+
+void AnnotationOverviewRuler::setLineCount(int lineCount)
+{
+    if(lineCount == m_lineCount)
+        return;
+
+    m_lineCount = lineCount;
+    rebuildBuckets();
+}
+
+void AnnotationOverviewRuler::setLine(LineNumber line, const AnnotationContainer &container)
+{
+    if(container.isEmpty()) {
+        removeLine(line);
+        return;
+    }
+
+    // The line shows like its gutter row: the first annotation of the highest category.
+    const Annotation* worst = container.first();
+    for(const Annotation* annotation : container) {
+        if(annotation->category() > worst->category())
+            worst = annotation;
+    }
+
+    LineMark mark;
+    mark.category = worst->category();
+    mark.color = worst->alertColor().rgba();
+
+    auto it = m_marks.find(line);
+    if(it != m_marks.end()) {
+        if(it.value().category == mark.category && it.value().color == mark.color)
+            return;
+        addMark(line, it.value(), -1);
+        it.value() = mark;
+    }
+    else {
+        m_marks.insert(line, mark);
+    }
+    addMark(line, mark, 1);
+}
+
+void AnnotationOverviewRuler::removeLine(LineNumber line)
+{
+    auto it = m_marks.find(line);
+    if(it == m_marks.end())
+        return;
+
+    addMark(line, it.value(), -1);
+    m_marks.erase(it);
+}
+
+void AnnotationOverviewRuler::removeLines(LineNumber first, LineNumber end)
+{
+    auto it = m_marks.lowerBound(first);
+    while(it != m_marks.end() && it.key() < end) {
+        addMark(it.key(), it.value(), -1);
+        it = m_marks.erase(it);
+    }
+}
+
+void AnnotationOverviewRuler::shiftLines(LineNumber from, int delta)
+{
+    auto it = m_marks.lowerBound(from);
+    if(delta == 0 || it == m_marks.end())
+        return;
+
+    QVector<QPair<LineNumber, LineMark>> moved;
+    while(it != m_marks.end()) {
+        moved.append(qMakePair(it.key() + delta, it.value()));
+        it = m_marks.erase(it);
+    }
+    for(const QPair<LineNumber, LineMark>& mark : moved)
+        m_marks.insert(m_marks.constEnd(), mark.first, mark.second);
+
+    // Marks may change bucket, recount them all.
+    rebuildBuckets();
+}
+
+void AnnotationOverviewRuler::clear()
+{
+    m_marks.clear();
+    rebuildBuckets();
+}
+
+void AnnotationOverviewRuler::setCategoryVisible(Annotation::Category category, bool visible)
+{
+    if(m_visible[category] == visible)
+        return;
+
+    m_visible[category] = visible;
+    update();
+}
+
+int AnnotationOverviewRuler::bucketOf(LineNumber line) const
+{
+    if(m_buckets.isEmpty())
+        return -1;
+
+    int lineCount = qMax(m_lineCount, 1);
+    int bucket = int(qint64(line) * m_buckets.size() / lineCount);
+    return qBound(0, bucket, m_buckets.size() - 1);
+}
+
+void AnnotationOverviewRuler::addMark(LineNumber line, const LineMark &mark, int delta)
+{
+    int bucket = bucketOf(line);
+    if(bucket == -1)
+        return;
+
+    Bucket& counts = m_buckets[bucket];
+    counts.counts[mark.category] += delta;
+    if(delta > 0)
+        counts.colors[mark.category] = mark.color;
+    else if(counts.counts[mark.category] > 0 && counts.colors[mark.category] == mark.color)
+        counts.colors[mark.category] = bucketColor(bucket, mark.category, line);
+
+    updateBucket(bucket);
+}
+
+QRgb AnnotationOverviewRuler::bucketColor(int bucket, int category, LineNumber except) const
+{
+    // The removed mark may have set the colour, the last remaining one of the category sets
+    // it now, as in rebuildBuckets(). Only the bucket's own marks are looked at.
+    int lineCount = qMax(m_lineCount, 1);
+    LineNumber first = LineNumber((qint64(bucket) * lineCount + m_buckets.size() - 1) / m_buckets.size());
+
+    QRgb color = 0;
+    for(auto it = m_marks.lowerBound(first); it != m_marks.constEnd() && bucketOf(it.key()) == bucket; ++it) {
+        if(it.key() != except && it.value().category == category)
+            color = it.value().color;
+    }
+    return color;
+}
+
+void AnnotationOverviewRuler::rebuildBuckets()
+{
+    m_buckets.resize(qMax(height(), 0));
+    if(! m_buckets.isEmpty())
+        std::memset(m_buckets.data(), 0, size_t(m_buckets.size()) * sizeof(Bucket));
+
+    for(auto it = m_marks.constBegin(); it != m_marks.constEnd(); ++it) {
+        Bucket& bucket = m_buckets[bucketOf(it.key())];
+        ++ bucket.counts[it.value().category];
+        bucket.colors[it.value().category] = it.value().color;
+    }
+
+    update();
+}
+
+void AnnotationOverviewRuler::updateBucket(int bucket)
+{
+    update(0, bucket - markHeight / 2, width(), markHeight);
+}
+
+void AnnotationOverviewRuler::paintEvent(QPaintEvent *event)
+{
+    QPainter painter(this);
+    painter.fillRect(event->rect(), QColor("#f0f0f0"));
+
+    int first = qMax(event->rect().top() - markHeight / 2, 0);
+    int last = qMin(event->rect().bottom() + markHeight / 2, m_buckets.size() - 1);
+
+    for(int y = first; y <= last; ++y) {
+        const Bucket& bucket = m_buckets[y];
+        for(int category = categoryCount - 1; category >= 0; --category) {
+            if(bucket.counts[category] > 0 && m_visible[category]) {
+                painter.fillRect(1, y - markHeight / 2, width() - 2, markHeight, QColor::fromRgba(bucket.colors[category]));
+                break;
+            }
+        }
+    }
+}
+
+void AnnotationOverviewRuler::resizeEvent(QResizeEvent *event)
+{
+    QWidget::resizeEvent(event);
+    rebuildBuckets();
+}
+
+void AnnotationOverviewRuler::mousePressEvent(QMouseEvent *event)
+{
+    if(event->button() == Qt::LeftButton && height() > 0)
+        emit positionClicked(qBound(0.0, double(event->pos().y()) / height(), 1.0));
+}
+
+void AnnotationOverviewRuler::mouseMoveEvent(QMouseEvent *event)
+{
+    if((event->buttons() & Qt::LeftButton) && height() > 0)
+        emit positionClicked(qBound(0.0, double(event->pos().y()) / height(), 1.0));
+}
+
+} // namespace codetextedit
@@ -0,0 +1,91 @@
+/***********************************************************************
+The CodeTextEditor provides an editor showing live hints and annotations.
+
+Copyright (c) 2020 Brian Newham <seaweedsolutionsltd@gmail.com>.
+
+CodeTextEdit is free software dual licensed under the GNU LGPL or MIT License.
+***********************************************************************/
+
+#ifndef ANNOTATIONOVERVIEWRULER_H
+#define ANNOTATIONOVERVIEWRULER_H
+
+#include <QWidget>
+#include <QVector>
+#include <QMap>
+#include <QColor>
+
+#include "Annotation.h"
+
+namespace codetextedit
+{
+    ///
+    /// \brief Strip showing where the annotated lines are across the whole document.
+    ///
+    /// Lines are down-sampled into one bucket per pixel row. Each bucket counts the worst
+    /// annotation of its lines per category, so a line update touches one bucket and a
+    /// repaint costs O(height) whatever the line count.
+    ///
+    class AnnotationOverviewRuler : public QWidget
+    {
+        Q_OBJECT
+
+    public:
+        explicit AnnotationOverviewRuler(QWidget* parent = nullptr);
+
+        void setLineCount(int lineCount);
+        int lineCount() const {return m_lineCount;}
+
+        void setLine(LineNumber line, const AnnotationContainer& container);
+        void removeLine(LineNumber line);
+        /// Removes lines [first, end).
+        void removeLines(LineNumber first, LineNumber end);
+        /// Moves every line from the given one on by delta, see AnnotationIndex::shiftLines().
+        void shiftLines(LineNumber from, int delta);
+        void clear();
+
+        /// Categories which are not visible are left out when painting.
+        void setCategoryVisible(Annotation::Category category, bool visible);
+
+        QSize sizeHint() const override;
+
+    signals:
+        /// Position clicked, as a fraction of the document height.
+        void positionClicked(double ratio);
+
+    protected:
+        void paintEvent(QPaintEvent*) override;
+        void resizeEvent(QResizeEvent*) override;
+        void mousePressEvent(QMouseEvent*) override;
+        void mouseMoveEvent(QMouseEvent*) override;
+
+    private:
+        static const int categoryCount = Annotation::CATEGORY_Error + 1;
+
+        struct LineMark
+        {
+            int     category;
+            QRgb    color;
+        };
+
+        struct Bucket
+        {
+            int     counts[categoryCount];
+            QRgb    colors[categoryCount];
+        };
+
+        int bucketOf(LineNumber line) const;
+        /// Marks are removed while still in m_marks, except is the line removing one.
+        void addMark(LineNumber line, const LineMark& mark, int delta);
+        QRgb bucketColor(int bucket, int category, LineNumber except) const;
+        void rebuildBuckets();
+        void updateBucket(int bucket);
+
+        QMap<LineNumber, LineMark>  m_marks;
+        QVector<Bucket>             m_buckets;
+        int                         m_lineCount = 0;
+        bool                        m_visible[categoryCount];
+    };
+
+} // namespace codetextedit
+
+#endif // ANNOTATIONOVERVIEWRULER_H
@@ -0,0 +1,85 @@
+/***********************************************************************
+The CodeTextEditor provides an editor showing live hints and annotations.
+
+Copyright (c) 2020 Brian Newham <seaweedsolutionsltd@gmail.com>.
+
+CodeTextEdit is free software dual licensed under the GNU LGPL or MIT License.
+***********************************************************************/
+
+#include "AnnotationResult.h"
+
+#include <utility>
+
+namespace codetextedit
+{
+
+AnnotationResult::~AnnotationResult()
+{
+    clear();
+}
+
+AnnotationResult::AnnotationResult(AnnotationResult &&other) noexcept
+    : m_revision(other.m_revision)
+{
+    m_annotations.swap(other.m_annotations);
+    m_lineRanges.swap(other.m_lineRanges);
+    m_lineCosts.swap(other.m_lineCosts);
+    other.m_revision = -1;
+}
+
+AnnotationResult &AnnotationResult::operator=(AnnotationResult &&other) noexcept
+{
+    if(this != &other) {
+        clear();
+        m_annotations.swap(other.m_annotations);
+        m_lineRanges = std::move(other.m_lineRanges);
+        other.m_lineRanges.clear();
+        m_lineCosts.swap(other.m_lineCosts);
+        m_revision = other.m_revision;
+        other.m_revision = -1;
+    }
+    return *this;
+}
+
+void AnnotationResult::insert(LineNumber line, const AnnotationContainer &container)
+{
+    AnnotationContainer& target = m_annotations[line];
+    if(target.isEmpty())
+        target = container;
+    else
+        target += container;
+}
+
+void AnnotationResult::adopt(AnnotationMap &map)
+{
+    if(m_annotations.isEmpty()) {
+        m_annotations.swap(map);
+        return;
+    }
+
+    for(auto it = map.constBegin(); it != map.constEnd(); ++it)
+        insert(it.key(), it.value());
+    map.clear();
+}
+
+void AnnotationResult::addLineCost(LineNumber line, qint64 nsecs)
+{
+    m_lineCosts.append(LineCost{line, quint32(qBound<qint64>(0, nsecs, 0xFFFFFFFF))});
+}
+
+AnnotationMap AnnotationResult::release()
+{
+    AnnotationMap annotations;
+    annotations.swap(m_annotations);
+    return annotations;
+}
+
+void AnnotationResult::clear()
+{
+    for(auto it = m_annotations.constBegin(); it != m_annotations.constEnd(); ++it)
+        qDeleteAll(it.value());
+    m_annotations.clear();
+    m_lineCosts.clear();
+}
+
+} // namespace codetextedit
@@ -0,0 +1,84 @@
+/***********************************************************************
+The CodeTextEditor provides an editor showing live hints and annotations.
+
+Copyright (c) 2020 Brian Newham <seaweedsolutionsltd@gmail.com>.
+
+CodeTextEdit is free software dual licensed under the GNU LGPL or MIT License.
+***********************************************************************/
+
+#ifndef ANNOTATIONRESULT_H
+#define ANNOTATIONRESULT_H
+
+#include <QVector>
+#include <QPair>
+
+#include "Annotation.h"
+
+namespace codetextedit
+{
+    ///
+    /// \brief Time an annotator spent analyzing one line.
+    ///
+    struct LineCost
+    {
+        LineNumber  line;
+        quint32     nsecs;      // Saturates at about 4 seconds
+    };
+
+    ///
+    /// \brief Owns the annotations of one analysis run.
+    ///
+    /// Move only, so exactly one object owns the annotations at any time. They are deleted
+    /// with the result unless release() hands them on. Moving swaps the map, the QMap and
+    /// its containers are never copied.
+    ///
+    class AnnotationResult
+    {
+    public:
+        AnnotationResult() = default;
+        explicit AnnotationResult(int revision) : m_revision(revision) {}
+        ~AnnotationResult();
+
+        AnnotationResult(AnnotationResult&& other) noexcept;
+        AnnotationResult& operator=(AnnotationResult&& other) noexcept;
+        AnnotationResult(const AnnotationResult&) = delete;
+        AnnotationResult& operator=(const AnnotationResult&) = delete;
+
+        /// Document revision the annotations were computed from, -1 for none.
+        int revision() const {return m_revision;}
+        void setRevision(int revision) {m_revision = revision;}
+
+        /// Lines [first, end) the analysis covered, lines outside them were not looked at.
+        /// Empty for a result covering the whole document.
+        const QVector<QPair<LineNumber, LineNumber>>& lineRanges() const {return m_lineRanges;}
+        void setLineRanges(const QVector<QPair<LineNumber, LineNumber>>& ranges) {m_lineRanges = ranges;}
+        bool isPartial() const {return !m_lineRanges.isEmpty();}
+
+        /// Per line analysis times in line order, only filled while the worker profiles.
+        const QVector<LineCost>& lineCosts() const {return m_lineCosts;}
+        void addLineCost(LineNumber line, qint64 nsecs);
+
+        /// Takes ownership of the container's annotations.
+        void insert(LineNumber line, const AnnotationContainer& container);
+        /// Takes ownership of every annotation in map and leaves it empty.
+        void adopt(AnnotationMap& map);
+        /// Gives up ownership, the caller deletes the annotations.
+        AnnotationMap release();
+
+        /// Deletes the annotations and drops the line costs.
+        void clear();
+
+        const AnnotationMap& annotations() const {return m_annotations;}
+        AnnotationContainer line(LineNumber line) const {return m_annotations.value(line);}
+        bool isEmpty() const {return m_annotations.isEmpty();}
+
+    private:
+        AnnotationMap   m_annotations;
+        QVector<QPair<LineNumber, LineNumber>> m_lineRanges;
+        QVector<LineCost> m_lineCosts;
+        int             m_revision = -1;
+    };
+
+} // namespace codetextedit
+
+#endif // ANNOTATIONRESULT_H
@@ -0,0 +1,114 @@
+/***********************************************************************
+The CodeTextEditor provides an editor showing live hints and annotations.
+
+Copyright (c) 2020 Brian Newham <seaweedsolutionsltd@gmail.com>.
+
+CodeTextEdit is free software dual licensed under the GNU LGPL or MIT License.
+***********************************************************************/
+
+#include "AnnotationSummaryTree.h"
+
+namespace codetextedit
+{
+
+int AnnotationSummaryTree::Summary::worstCategory() const
+{
+    for(int category = categoryCount - 1; category >= 0; --category) {
+        if(counts[category] > 0)
+            return category;
+    }
+    return -1;
+}
+
+quint32 AnnotationSummaryTree::Summary::total() const
+{
+    quint32 total = 0;
+    for(int category = 0; category < categoryCount; ++category)
+        total += counts[category];
+    return total;
+}
+
+void AnnotationSummaryTree::Summary::add(const Summary &other)
+{
+    for(int category = 0; category < categoryCount; ++category)
+        counts[category] += other.counts[category];
+}
+
+void AnnotationSummaryTree::reset(int lineCount)
+{
+    m_count = qMax(lineCount, 0);
+    m_tree.fill(Summary(), 2 * m_count);
+}
+
+void AnnotationSummaryTree::replaceLines(LineNumber first, int removed, int added)
+{
+    first = qBound(0, first, m_count);
+    removed = qBound(0, removed, m_count - first);
+    added = qMax(added, 0);
+
+    // Typing within lines keeps the line count, only the replaced leaves change.
+    if(removed == added) {
+        for(LineNumber line = first; line < first + added; ++line)
+            setLeaf(line, Summary());
+        return;
+    }
+
+    QVector<Summary> leaves = m_tree.mid(m_count);
+    leaves.remove(first, removed);
+    leaves.insert(first, added, Summary());
+
+    m_count = leaves.size();
+    m_tree.fill(Summary(), m_count);
+    m_tree += leaves;
+    rebuild();
+}
+
+void AnnotationSummaryTree::setLine(LineNumber line, const AnnotationContainer &container)
+{
+    if(line < 0 || line >= m_count)
+        return;
+
+    Summary summary;
+    for(const Annotation* annotation : container)
+        ++ summary.counts[annotation->category()];
+    setLeaf(line, summary);
+}
+
+AnnotationSummaryTree::Summary AnnotationSummaryTree::summary(LineNumber first, LineNumber end) const
+{
+    Summary sum;
+    int left = qBound(0, first, m_count) + m_count;
+    int right = qBound(0, end, m_count) + m_count;
+
+    // Bottom up, adding the nodes that stick out of the range on either side.
+    for(; left < right; left /= 2, right /= 2) {
+        if(left & 1)
+            sum.add(m_tree[left++]);
+        if(right & 1)
+            sum.add(m_tree[--right]);
+    }
+    return sum;
+}
+
+void AnnotationSummaryTree::setLeaf(LineNumber line, const Summary &summary)
+{
+    int node = line + m_count;
+    m_tree[node] = summary;
+
+    for(node /= 2; node >= 1; node /= 2) {
+        Summary sum = m_tree[2 * node];
+        sum.add(m_tree[2 * node + 1]);
+        m_tree[node] = sum;
+    }
+}
+
+void AnnotationSummaryTree::rebuild()
+{
+    for(int node = m_count - 1; node >= 1; --node) {
+        Summary sum = m_tree[2 * node];
+        sum.add(m_tree[2 * node + 1]);
+        m_tree[node] = sum;
+    }
+}
+
+} // namespace codetextedit
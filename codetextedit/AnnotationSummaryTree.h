@@ -0,0 +1,59 @@
+/***********************************************************************
+The CodeTextEditor provides an editor showing live hints and annotations.
+
+Copyright (c) 2020 Brian Newham <seaweedsolutionsltd@gmail.com>.
+
+CodeTextEdit is free software dual licensed under the GNU LGPL or MIT License.
+***********************************************************************/
+
+#ifndef ANNOTATIONSUMMARYTREE_H
+#define ANNOTATIONSUMMARYTREE_H
+
+#include <QVector>
+
+#include "Annotation.h"
+
+namespace codetextedit
+{
+    ///
+    /// \brief Annotation counts per category over any range of lines.
+    ///
+    /// A segment tree over the document's lines, so changing a line and summing a range
+    /// are O(log n). Inserting or removing lines rebuilds the tree in O(n), like
+    /// BlockHeightIndex, while replacing lines one for one does not.
+    ///
+    class AnnotationSummaryTree
+    {
+    public:
+        static const int categoryCount = Annotation::CATEGORY_Error + 1;
+
+        struct Summary
+        {
+            quint32 counts[categoryCount] = {};
+
+            /// Highest category present, -1 if there are no annotations.
+            int worstCategory() const;
+            quint32 total() const;
+            void add(const Summary& other);
+        };
+
+        void reset(int lineCount);
+        /// Replaces lines [first, first + removed) by added lines without annotations.
+        void replaceLines(LineNumber first, int removed, int added);
+        void setLine(LineNumber line, const AnnotationContainer& container);
+
+        /// Sum over lines [first, end).
+        Summary summary(LineNumber first, LineNumber end) const;
+        int count() const {return m_count;}
+
+    private:
+        void setLeaf(LineNumber line, const Summary& summary);
+        void rebuild();
+
+        QVector<Summary> m_tree;    // Leaves from m_count on, m_tree[i] sums 2i and 2i + 1
+        int             m_count = 0;
+    };
+
+} // namespace codetextedit
+
+#endif // ANNOTATIONSUMMARYTREE_H
@@ -7,17 +7,122 @@ CodeTextEdit is free software dual licensed under the GNU LGPL or MIT License.
 ***********************************************************************/
 
 #include "AnnotationTextEdit.h"
+#include "LineNumberArea.h"
 #include <QMouseEvent>
 #include <QDebug>
 #include <QTextDocument>
 #include <QTextBlock>
 #include <QTextCursor>
 #include <QFontMetrics>
+#include <QAbstractTextDocumentLayout>
+#include <QScrollBar>
 
 int AnnotationTextEdit::currentBlockNumber = -1;
 
 AnnotationTextEdit::AnnotationTextEdit(QWidget *parent) : QTextEdit(parent)
 {
+    m_blockHeights.reset(document()->blockCount(), estimatedBlockHeight());
+
+    connect(document(), &QTextDocument::contentsChange, this, &AnnotationTextEdit::documentContentsChange);
+    connect(document()->documentLayout(), &QAbstractTextDocumentLayout::update, this, &AnnotationTextEdit::documentLayoutUpdated);
+
+    // Painted from the same height index as the text and the annotation rows, so scrolling
+    // keeps the three panes aligned.
+    m_lineNumberArea = new LineNumberArea(this);
+    connect(document(), &QTextDocument::blockCountChanged, m_lineNumberArea, &LineNumberArea::setLineCount);
+    connect(m_lineNumberArea, &LineNumberArea::widthChanged, this, &AnnotationTextEdit::updateLineNumberMargin);
+    connect(m_lineNumberArea, &LineNumberArea::lineClicked, this, &AnnotationTextEdit::lineNumberClicked);
+    connect(verticalScrollBar(), &QScrollBar::valueChanged, m_lineNumberArea, QOverload<>::of(&QWidget::update));
+    connect(this, &AnnotationTextEdit::blockHeightsChanged, m_lineNumberArea, QOverload<>::of(&QWidget::update));
+    updateLineNumberMargin();
+}
+
+void AnnotationTextEdit::setLineNumbersVisible(bool visible)
+{
+    m_lineNumberArea->setVisible(visible);
+    updateLineNumberMargin();
+}
+
+bool AnnotationTextEdit::lineNumbersVisible() const
+{
+    return !m_lineNumberArea->isHidden();
+}
+
+void AnnotationTextEdit::updateLineNumberMargin()
+{
+    setViewportMargins(lineNumbersVisible() ? m_lineNumberArea->areaWidth() : 0, 0, 0, 0);
+    QRect rect = contentsRect();
+    m_lineNumberArea->setGeometry(rect.left(), rect.top(), m_lineNumberArea->areaWidth(), rect.height());
+}
+
+void AnnotationTextEdit::resizeEvent(QResizeEvent *event)
+{
+    QTextEdit::resizeEvent(event);
+    QRect rect = contentsRect();
+    m_lineNumberArea->setGeometry(rect.left(), rect.top(), m_lineNumberArea->areaWidth(), rect.height());
+}
+
+qreal AnnotationTextEdit::blockTop(int blockNumber) const
+{
+    return document()->documentMargin() + m_blockHeights.top(blockNumber);
+}
+
+int AnnotationTextEdit::blockAt(qreal y) const
+{
+    return m_blockHeights.blockAt(y - document()->documentMargin());
+}
+
+qreal AnnotationTextEdit::estimatedBlockHeight() const
+{
+    return QFontMetricsF(document()->defaultFont()).height();
+}
+
+void AnnotationTextEdit::documentContentsChange(int position, int /*charsRemoved*/, int /*charsAdded*/)
+{
+    // Blocks split or merged at the edited block, the ones after it keep their heights.
+    int first = document()->findBlock(position).blockNumber();
+    int delta = document()->blockCount() - m_blockHeights.count();
+
+    m_blockHeights.setDefaultHeight(estimatedBlockHeight());
+    if (first == -1)
+        m_blockHeights.reset(document()->blockCount(), estimatedBlockHeight());
+    else if (delta > 0)
+        m_blockHeights.insertBlocks(first + 1, delta);
+    else if (delta < 0)
+        m_blockHeights.removeBlocks(first + 1, -delta);
+}
+
+void AnnotationTextEdit::documentLayoutUpdated(const QRectF &rect)
+{
+    if (m_blockHeights.count() == 0)
+        return;
+
+    // The layout only reports the area it changed, re-measure the blocks inside it.
+    int first = qMax(blockAt(rect.top()) - 1, 0);
+    int last = rect.bottom() >= blockTop(m_blockHeights.count()) ? m_blockHeights.count() - 1 : blockAt(rect.bottom()) + 1;
+    measureBlocks(first, last);
+}
+
+void AnnotationTextEdit::measureBlocks(int first, int last)
+{
+    int changedFrom = -1;
+    QTextBlock block = document()->findBlockByNumber(first);
+    for (int blockNumber = first; blockNumber <= last && block.isValid(); ++blockNumber, block = block.next())
+    {
+        qreal height = 0;
+        if (block.isVisible())
+        {
+            QTextLayout* layout = block.layout();
+            if (layout->lineCount() == 0)
+                continue;   // Not laid out yet, keeps its estimate
+            height = layout->boundingRect().height();
+        }
+        if (m_blockHeights.setHeight(blockNumber, height) && changedFrom == -1)
+            changedFrom = blockNumber;
+    }
+
+    if (changedFrom != -1)
+        emit blockHeightsChanged(changedFrom);
 }
 
 void AnnotationTextEdit::clearHighlight()
@@ -35,7 +140,7 @@ void AnnotationTextEdit::clearHighlight()
 
 void AnnotationTextEdit::highlightCurrentLine(const QTextBlock& block, bool highlight)
 {
-    QList<QTextEdit::ExtraSelection> extraSelections;
+    m_lineSelections.clear();
 
     QTextEdit::ExtraSelection selection;
 
@@ -45,32 +150,31 @@ void AnnotationTextEdit::highlightCurrentLine(const QTextBlock& block, bool high
     selection.format.setProperty(QTextFormat::FullWidthSelection, true);
     selection.cursor = QTextCursor(block);
     selection.cursor.clearSelection();
-    extraSelections.append(selection);
+    m_lineSelections.append(selection);
 
-    setExtraSelections(extraSelections);
+    setExtraSelections(m_lineSelections + m_searchSelections);
 
     if (highlight)
         currentBlockNumber = block.blockNumber();
 }
 
+void AnnotationTextEdit::setSearchSelections(const QList<QTextEdit::ExtraSelection> &selections)
+{
+    m_searchSelections = selections;
+    setExtraSelections(m_lineSelections + m_searchSelections);
+}
+
 void AnnotationTextEdit::mouseMoveEvent(QMouseEvent* event)
 {
-    int eventPtY = event->localPos().y();
-    QTextCursor firstVisibleCursor = cursorForPosition(QPoint(0,0));
-    QRect firstRect = cursorRect(firstVisibleCursor);
-    QTextBlock firstBlock = firstVisibleCursor.block();
-    int firstY = firstBlock.layout()->position().y() - firstRect.y();
+    qreal documentY = event->localPos().y() + verticalScrollBar()->value();
     bool highlighted = false;
-    for (QTextBlock block = document()->begin(); block != document()->end(); block = block.next())
+    int blockNumber = blockAt(documentY);
+    if (blockNumber != -1 && documentY >= blockTop(0) && documentY < blockTop(m_blockHeights.count()))
     {
-        int blockPtY = block.layout()->position().y() - firstY;
-        if (blockPtY <= eventPtY && blockPtY + lineSpacing() >= eventPtY)
-        {
-            highlightCurrentLine(block,true);
-            emit blockHighlighted(block.blockNumber());
-            highlighted = true;
-            break;
-        }
+        QTextBlock block = document()->findBlockByNumber(blockNumber);
+        highlightCurrentLine(block,true);
+        emit blockHighlighted(block.blockNumber());
+        highlighted = true;
     }
     if (!highlighted)
     {
@@ -15,6 +15,8 @@ CodeTextEdit is free software dual licensed under the GNU LGPL or MIT License.
 #include <QObject>
 #include <QTextLine>
 
+#include "BlockHeightIndex.h"
+
  class QPaintEvent;
  class QResizeEvent;
  class QSize;
@@ -33,13 +35,42 @@ CodeTextEdit is free software dual licensed under the GNU LGPL or MIT License.
      void highlightCurrentLine(const QTextBlock&, bool highlight);
      void setAscentDescent(int ascent, int descent) {m_ascent=ascent; m_descent=descent;}
      int lineSpacing() const {return m_ascent+m_descent;}
+     int ascent() const {return m_ascent;}
+     int descent() const {return m_descent;}
+     void setSearchSelections(const QList<QTextEdit::ExtraSelection>& selections);
+
+     /// Layout position of a block's top and the block at a layout y, without laying out
+     /// the document. Blocks not laid out yet are estimated as a single line.
+     qreal blockTop(int blockNumber) const;
+     int blockAt(qreal y) const;
+
+     /// Line numbers in a margin left of the text. On by default.
+     void setLineNumbersVisible(bool visible);
+     bool lineNumbersVisible() const;
+ protected:
+     void resizeEvent(QResizeEvent *) override;
  private slots:
      void mouseMoveEvent(QMouseEvent *) override;
+     void documentContentsChange(int position, int charsRemoved, int charsAdded);
+     void documentLayoutUpdated(const QRectF& rect);
+     void updateLineNumberMargin();
  private:
+     void measureBlocks(int first, int last);
+     qreal estimatedBlockHeight() const;
+
      static int currentBlockNumber;
-     int m_ascent, m_descent;
+     int m_ascent = 0, m_descent = 0;
+     BlockHeightIndex m_blockHeights;
+     LineNumberArea* m_lineNumberArea;
+     // Shown together, the search matches are drawn over the full width line highlight.
+     QList<QTextEdit::ExtraSelection> m_lineSelections;
+     QList<QTextEdit::ExtraSelection> m_searchSelections;
  signals:
      void blockHighlighted(int);
+     /// Heights from this block on changed, so everything below it moved.
+     void blockHeightsChanged(int firstBlock);
+     /// A line number was clicked.
+     void lineNumberClicked(int blockNumber);
  };
 
 #endif // ANNOTATIONTEXTEDIT_H
@@ -9,25 +9,28 @@ CodeTextEdit is free software dual licensed under the GNU LGPL or MIT License.
 #include <QTextDocument>
 #include <QTextBlock>
 #include <QDebug>
+#include <QElapsedTimer>
 
 #include "AnnotationWorker.h"
 
+#include <utility>
+
 namespace codetextedit {
 
+// Batches are sized so one takes about this long, which is how late a restart is noticed.
+static const qint64 batchTargetNsecs = 2000000;
+static const int    minBatchSize = 1;
+static const int    maxBatchSize = 8192;
+
 AnnotationWorker::AnnotationWorker(Annotator *annotator, QObject *parent)
     : QThread(parent)
     , annotator(annotator)
 {
-    qRegisterMetaType<AnnotationMap>("AnnotationMap");
 }
 
 AnnotationWorker::~AnnotationWorker()
 {
-    mutex.lock();
-    abort = true;
-    condition.wakeOne();
-    mutex.unlock();
-
+    kill();
     wait();
 }
 
@@ -35,62 +38,171 @@ void AnnotationWorker::kill()
 {
     mutex.lock();
     killLoop = true;
+    // Also cancels a run in progress, whose end would otherwise wait for a wake already sent.
+    restart.storeRelease(1);
     condition.wakeOne();
     mutex.unlock();
 }
 
-void AnnotationWorker::analyze(QStringList lines)
+void AnnotationWorker::analyze(QStringList lines, int revision, const QVector<QPair<LineNumber, LineNumber>>& ranges,
+                               const LineTokens& tokens)
 {
     QMutexLocker locker(&mutex);
 
     this->lines = lines;
+    this->tokens = tokens;
+    this->revision = revision;
+    this->ranges = ranges;
 
     if (!isRunning()) {
         start(LowPriority);
     }
     else {
-        restart = true;
+        restart.storeRelease(1);
         condition.wakeOne();
     }
 
 }
 
+void AnnotationWorker::setProfilingEnabled(bool enabled)
+{
+    QMutexLocker locker(&mutex);
+    profiling = enabled;
+}
+
 void AnnotationWorker::run()
 {
     forever {
         mutex.lock();
         QStringList lines = this->lines;
+        LineTokens tokens = this->tokens;
+        int revision = this->revision;
+        QVector<QPair<LineNumber, LineNumber>> ranges = this->ranges;
+        bool profile = profiling;
         mutex.unlock();
 
         if(lines.size() > 0) {
 
-            annotator->prepareAnalysis(lines);
-            while(annotator->analyzeStep()) {
-                if(restart) {
-                    break;
-                }
+            annotator->prepareAnalysis(lines, tokens);
+
+            AnnotationResult result(revision);
+            BatchStatus status = analyzeBatched(ranges.isEmpty() ? QVector<QPair<LineNumber, LineNumber>>{qMakePair(0, lines.size())} : ranges, result, profile);
+
+            if(status == BATCH_Completed) {
+                result.setLineRanges(ranges);
+                publish(std::move(result));
             }
+            else if(status == BATCH_Unsupported) {
+                // Every line is analyzed then, the result covers the whole document.
+                while(annotator->analyzeStep()) {
+                    if(restart.loadAcquire()) {
+                        break;
+                    }
+                }
 
-            if(! restart) {
-                emit analyzed(annotator->analysisResult());
+                // Taken even when cancelled, so partial annotations are deleted here and
+                // do not leak into the next run.
+                AnnotationMap annotations = annotator->analysisResult();
+                result.adopt(annotations);
+                if(! restart.loadAcquire()) {
+                    publish(std::move(result));
+                }
             }
         }
 
         mutex.lock();
-        if (!restart)
+        if (!restart.loadAcquire())
             condition.wait(&mutex);
 
         if(killLoop) {
             mutex.unlock();
 
+            annotator->analysisThreadFinished();
+
             exit();
             return;
         }
 
-        restart = false;
+        restart.storeRelease(0);
         mutex.unlock();
     }
 }
 
+AnnotationResult AnnotationWorker::takeResult()
+{
+    QMutexLocker locker(&mutex);
+    return std::move(pending);
+}
+
+void AnnotationWorker::publish(AnnotationResult &&result)
+{
+    mutex.lock();
+    pending = std::move(result);
+    mutex.unlock();
+
+    emit resultReady();
+}
+
+AnnotationWorker::BatchStatus AnnotationWorker::analyzeBatched(const QVector<QPair<LineNumber, LineNumber>>& ranges, AnnotationResult& result, bool profile)
+{
+    QElapsedTimer timer;
+    bool firstBatch = true;
+
+    for(const QPair<LineNumber, LineNumber>& range : ranges) {
+        int first = range.first;
+
+        while(first < range.second) {
+            int count = qMin(batchSize, range.second - first);
+            if(batchBuffer.size() < count)
+                batchBuffer.resize(count);
+
+            timer.start();
+            bool supported = profile ? analyzeProfiled(first, count, result)
+                                     : annotator->analyzeRange(first, count, batchBuffer.data());
+            if(! supported) {
+                // An annotator supports batches for the whole run or not at all.
+                Q_ASSERT(firstBatch);
+                return BATCH_Unsupported;
+            }
+            qint64 elapsed = timer.nsecsElapsed();
+            firstBatch = false;
+
+            for(int i = 0; i < count; ++i) {
+                if(! batchBuffer[i].isEmpty()) {
+                    result.insert(first + i, batchBuffer[i]);
+                    batchBuffer[i].clear();
+                }
+            }
+            first += count;
+
+            // Grow while batches are cheap, shrink when one would delay a restart noticeably.
+            if(elapsed < batchTargetNsecs / 2 && count == batchSize)
+                batchSize = qMin(batchSize * 2, maxBatchSize);
+            else if(elapsed > batchTargetNsecs * 2)
+                batchSize = qMax(batchSize / 2, minBatchSize);
+
+            if(restart.loadAcquire()) {
+                result.clear();
+                return BATCH_Cancelled;
+            }
+        }
+    }
+
+    return BATCH_Completed;
+}
+
+bool AnnotationWorker::analyzeProfiled(int first, int count, AnnotationResult &result)
+{
+    // One line per call, so each line's time is its own and not an average over the batch.
+    QElapsedTimer timer;
+    for(int i = 0; i < count; ++i) {
+        timer.start();
+        if(! annotator->analyzeRange(first + i, 1, batchBuffer.data() + i))
+            return false;
+        result.addLineCost(first + i, timer.nsecsElapsed());
+    }
+    return true;
+}
+
 
 } // namespace codetextedit
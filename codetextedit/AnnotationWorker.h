@@ -9,12 +9,15 @@ CodeTextEdit is free software dual licensed under the GNU LGPL or MIT License.
 #ifndef ANNOTATIONWORKER_H
 #define ANNOTATIONWORKER_H
 
+#include <QAtomicInt>
 #include <QObject>
 #include <QThread>
 #include <QMutex>
 #include <QWaitCondition>
+#include <QVector>
 
 #include "Annotation.h"
+#include "AnnotationResult.h"
 
 
 namespace codetextedit {
@@ -31,25 +34,52 @@ public:
     ~AnnotationWorker() override;
 
     void kill();
-    void analyze(QStringList lines);
+    /// Analyzes the lines of the given document revision, which the result carries. With
+    /// ranges only lines [first, end) of them are analyzed, the others only give context.
+    /// An annotator without analyzeRange() always analyzes all of them. Tokens, if given,
+    /// hold the lexer's tokens of every line and go to the annotator with the lines.
+    void analyze(QStringList lines, int revision, const QVector<QPair<LineNumber, LineNumber>>& ranges = {},
+                 const LineTokens& tokens = LineTokens());
+
+    /// Moves out the latest finished result, an empty one with revision -1 if there is none.
+    /// A result not taken before the next one finishes is deleted.
+    AnnotationResult takeResult();
+
+    /// Times every line the annotator analyzes, see AnnotationResult::lineCosts(). Lines are
+    /// then analyzed one at a time, which is slower, and only annotators with analyzeRange()
+    /// can be timed per line. Applies from the next run.
+    void setProfilingEnabled(bool enabled);
 
 signals:
-    void analyzed(AnnotationMap annotations);
+    /// A result is waiting in takeResult().
+    void resultReady();
 
 protected:
     void run() override;
 
 private:
+    enum BatchStatus {BATCH_Unsupported, BATCH_Completed, BATCH_Cancelled};
+
+    BatchStatus analyzeBatched(const QVector<QPair<LineNumber, LineNumber>>& ranges, AnnotationResult& result, bool profile);
+    bool analyzeProfiled(int first, int count, AnnotationResult& result);
+    void publish(AnnotationResult&& result);
+
     Annotator*      annotator;
 
     QMutex          mutex;
     QWaitCondition  condition;
-    bool            restart = false;
-    bool            abort = false;
+    QAtomicInt      restart;            // Set under mutex, polled without it between batches
     bool            killLoop = false;
+    bool            profiling = false;
 
     QStringList     lines;
-    AnnotationMap   result;
+    LineTokens      tokens;
+    int             revision = 0;
+    QVector<QPair<LineNumber, LineNumber>> ranges;
+    AnnotationResult pending;           // Guarded by mutex
+
+    QVector<AnnotationContainer> batchBuffer;
+    int             batchSize = 16;     // Adapted to the annotator's speed across runs
 };
 
 } // namespace codetextedit
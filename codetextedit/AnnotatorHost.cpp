@@ -0,0 +1,190 @@
+/***********************************************************************
+The CodeTextEditor provides an editor showing live hints and annotations.
+
+Copyright (c) 2020 Brian Newham <seaweedsolutionsltd@gmail.com>.
+
+CodeTextEdit is free software dual licensed under the GNU LGPL or MIT License.
+***********************************************************************/
+
+#include "AnnotatorHost.h"
+
+#include <QLocalSocket>
+#include <QSharedMemory>
+#include <QElapsedTimer>
+#include <QDebug>
+
+namespace codetextedit
+{
+
+// How often a running analysis looks for a cancellation from the editor.
+static const int cancelPollInterval = 10;
+
+AnnotatorHost::AnnotatorHost(Annotator *annotator, QObject *parent)
+    : QObject(parent)
+    , m_annotator(annotator)
+{
+}
+
+AnnotatorHost::~AnnotatorHost()
+{
+    delete m_output;
+}
+
+bool AnnotatorHost::connectToEditor(const QString &serverName, int msecs)
+{
+    m_serverName = serverName;
+
+    m_socket = new QLocalSocket(this);
+    connect(m_socket, &QLocalSocket::readyRead, this, &AnnotatorHost::readMessages);
+    connect(m_socket, &QLocalSocket::disconnected, this, &AnnotatorHost::finished);
+
+    m_socket->connectToServer(serverName);
+    if(! m_socket->waitForConnected(msecs)) {
+        qWarning() << "Annotator host: cannot connect to" << serverName << m_socket->errorString();
+        return false;
+    }
+
+    return true;
+}
+
+QString AnnotatorHost::serverName(const QStringList &arguments)
+{
+    int index = arguments.indexOf("--server");
+    if(index == -1 || index + 1 >= arguments.size())
+        return QString();
+
+    return arguments[index + 1];
+}
+
+void AnnotatorHost::readMessages()
+{
+    // A running analysis drains the socket itself between steps.
+    if(m_busy)
+        return;
+
+    takeMessages();
+
+    while(! m_queue.isEmpty()) {
+        ipc::Message message = m_queue.takeFirst();
+
+        if(message.type == ipc::MESSAGE_Request)
+            analyze(message);
+        else if(message.type == ipc::MESSAGE_Cancel)
+            reply(ipc::MESSAGE_Cancelled, message.requestId);
+    }
+}
+
+void AnnotatorHost::takeMessages()
+{
+    ipc::Message message;
+    while(ipc::readMessage(m_socket, message))
+        m_queue.append(message);
+}
+
+void AnnotatorHost::analyze(const ipc::Message &request)
+{
+    QStringList lines;
+    {
+        QSharedMemory input(request.memoryKey);
+        if(! input.attach(QSharedMemory::ReadOnly)) {
+            qWarning() << "Annotator host: cannot read snapshot" << input.errorString();
+            reply(ipc::MESSAGE_Failed, request.requestId);
+            return;
+        }
+
+        input.lock();
+        bool ok = ipc::readLines(input.constData(), qMin(int(request.size), input.size()), lines);
+        input.unlock();
+        input.detach();
+
+        if(! ok) {
+            reply(ipc::MESSAGE_Failed, request.requestId);
+            return;
+        }
+    }
+
+    m_busy = true;
+
+    bool cancelled = false;
+    QElapsedTimer sincePoll;
+    sincePoll.start();
+
+    if(! lines.isEmpty()) {
+        m_annotator->prepareAnalysis(lines);
+        while(m_annotator->analyzeStep()) {
+            if(sincePoll.hasExpired(cancelPollInterval)) {
+                if(isCancelled(request.requestId)) {
+                    cancelled = true;
+                    break;
+                }
+                sincePoll.restart();
+            }
+        }
+    }
+
+    AnnotationMap result = m_annotator->analysisResult();
+    m_busy = false;
+
+    if(cancelled) {
+        for(auto container : result)
+            qDeleteAll(container);
+        reply(ipc::MESSAGE_Cancelled, request.requestId);
+        return;
+    }
+
+    // The previous result is released here, the editor has copied it out by now.
+    ipc::AnnotationWriter writer(result);
+    int size = writer.size();
+
+    delete m_output;
+    m_output = new QSharedMemory(QString("%1-out-%2").arg(m_serverName).arg(request.requestId));
+
+    if(m_output->create(size)) {
+        m_output->lock();
+        writer.write(m_output->data());
+        m_output->unlock();
+        reply(ipc::MESSAGE_Result, request.requestId, m_output->key(), quint32(size));
+    }
+    else {
+        qWarning() << "Annotator host: cannot create shared memory" << m_output->errorString();
+        reply(ipc::MESSAGE_Failed, request.requestId);
+    }
+
+    for(auto container : result)
+        qDeleteAll(container);
+}
+
+bool AnnotatorHost::isCancelled(quint32 requestId)
+{
+    if(m_socket->bytesAvailable() > 0 || m_socket->waitForReadyRead(0))
+        takeMessages();
+
+    bool cancelled = false;
+    for(int i = m_queue.size() - 1; i >= 0; --i) {
+        const ipc::Message& message = m_queue[i];
+
+        if(message.type == ipc::MESSAGE_Cancel && message.requestId == requestId) {
+            m_queue.removeAt(i);
+            cancelled = true;
+        }
+        else if(message.type == ipc::MESSAGE_Request) {
+            cancelled = true;   // A newer snapshot supersedes this one
+        }
+    }
+
+    return cancelled || m_socket->state() != QLocalSocket::ConnectedState;
+}
+
+void AnnotatorHost::reply(ipc::MessageType type, quint32 requestId, const QString &memoryKey, quint32 size)
+{
+    ipc::Message message;
+    message.type = type;
+    message.requestId = requestId;
+    message.memoryKey = memoryKey;
+    message.size = size;
+
+    ipc::writeMessage(m_socket, message);
+    m_socket->flush();
+}
+
+} // namespace codetextedit
@@ -0,0 +1,66 @@
+/***********************************************************************
+The CodeTextEditor provides an editor showing live hints and annotations.
+
+Copyright (c) 2020 Brian Newham <seaweedsolutionsltd@gmail.com>.
+
+CodeTextEdit is free software dual licensed under the GNU LGPL or MIT License.
+***********************************************************************/
+
+#ifndef ANNOTATORHOST_H
+#define ANNOTATORHOST_H
+
+#include <QObject>
+#include <QString>
+#include <QList>
+
+#include "Annotation.h"
+#include "AnnotatorIpc.h"
+
+class QLocalSocket;
+class QSharedMemory;
+
+namespace codetextedit
+{
+    ///
+    /// \brief Serves an Annotator to a RemoteAnnotator from inside a helper process.
+    ///
+    /// A helper program creates one host around its annotator, connects it to the server
+    /// name it was given with "--server" and runs the event loop until finished() is emitted.
+    ///
+    class AnnotatorHost : public QObject
+    {
+        Q_OBJECT
+
+    public:
+        explicit AnnotatorHost(Annotator* annotator, QObject* parent = nullptr);
+        ~AnnotatorHost() override;
+
+        bool connectToEditor(const QString& serverName, int msecs = 30000);
+
+        /// Reads the server name from "--server <name>" in the arguments.
+        static QString serverName(const QStringList& arguments);
+
+    signals:
+        /// The editor went away.
+        void finished();
+
+    private slots:
+        void readMessages();
+
+    private:
+        void takeMessages();
+        void analyze(const ipc::Message& request);
+        bool isCancelled(quint32 requestId);
+        void reply(ipc::MessageType type, quint32 requestId, const QString& memoryKey = QString(), quint32 size = 0);
+
+        Annotator*          m_annotator;
+        QLocalSocket*       m_socket = nullptr;
+        QSharedMemory*      m_output = nullptr;
+        QString             m_serverName;
+        QList<ipc::Message> m_queue;
+        bool                m_busy = false;
+    };
+
+} // namespace codetextedit
+
+#endif // ANNOTATORHOST_H
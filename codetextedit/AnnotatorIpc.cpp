@@ -0,0 +1,203 @@
+/***********************************************************************
+The CodeTextEditor provides an editor showing live hints and annotations.
+
+Copyright (c) 2020 Brian Newham <seaweedsolutionsltd@gmail.com>.
+
+CodeTextEdit is free software dual licensed under the GNU LGPL or MIT License.
+***********************************************************************/
+
+#include "AnnotatorIpc.h"
+
+#include <QDataStream>
+
+#include <cstring>
+
+namespace codetextedit { namespace ipc {
+
+// Lines segment:        quint32 count, quint32 offsets[count + 1], ushort data[]
+// Annotations segment:  quint32 recordCount, quint32 stringCount, quint32 stringDataSize,
+//                       Record records[recordCount], quint32 offsets[stringCount + 1], ushort data[]
+
+static const QDataStream::Version streamVersion = QDataStream::Qt_5_0;
+
+void writeMessage(QIODevice *device, const Message &message)
+{
+    QDataStream out(device);
+    out.setVersion(streamVersion);
+    out << quint8(message.type) << message.requestId << message.memoryKey << message.size << message.lineCount;
+}
+
+bool readMessage(QIODevice *device, Message &message)
+{
+    QDataStream in(device);
+    in.setVersion(streamVersion);
+    in.startTransaction();
+
+    quint8 type = 0;
+    in >> type >> message.requestId >> message.memoryKey >> message.size >> message.lineCount;
+    if(! in.commitTransaction())
+        return false;
+
+    message.type = MessageType(type);
+    return true;
+}
+
+int linesSize(const QStringList &lines, int first, int count)
+{
+    int characters = 0;
+    for(int i = first; i < first + count; ++i)
+        characters += lines[i].size();
+
+    return int(sizeof(quint32)) * (count + 2) + characters * int(sizeof(ushort));
+}
+
+void writeLines(void *destination, const QStringList &lines, int first, int count)
+{
+    quint32* header = static_cast<quint32*>(destination);
+    quint32* offsets = header + 1;
+    ushort* data = reinterpret_cast<ushort*>(offsets + count + 1);
+
+    header[0] = quint32(count);
+
+    quint32 offset = 0;
+    for(int i = 0; i < count; ++i) {
+        const QString& line = lines[first + i];
+        offsets[i] = offset;
+        std::memcpy(data + offset, line.utf16(), size_t(line.size()) * sizeof(ushort));
+        offset += quint32(line.size());
+    }
+    offsets[count] = offset;
+}
+
+bool readLines(const void *source, int size, QStringList &lines)
+{
+    if(size < int(sizeof(quint32)))
+        return false;
+
+    const quint32* header = static_cast<const quint32*>(source);
+    quint32 count = header[0];
+    const quint32* offsets = header + 1;
+    const ushort* data = reinterpret_cast<const ushort*>(offsets + count + 1);
+
+    qint64 dataStart = qint64(sizeof(quint32)) * (qint64(count) + 2);
+    if(dataStart > size || qint64(offsets[count]) * qint64(sizeof(ushort)) > size - dataStart)
+        return false;
+
+    lines.clear();
+    lines.reserve(int(count));
+    for(quint32 i = 0; i < count; ++i) {
+        if(offsets[i] > offsets[i + 1])
+            return false;
+        lines.append(QString(reinterpret_cast<const QChar*>(data + offsets[i]), int(offsets[i + 1] - offsets[i])));
+    }
+
+    return true;
+}
+
+AnnotationWriter::AnnotationWriter(const AnnotationMap &annotations)
+{
+    for(auto it = annotations.constBegin(); it != annotations.constEnd(); ++it) {
+        for(const Annotation* annotation : it.value()) {
+            Record record;
+            record.line = it.key();
+            record.rgba = annotation->alertColor().rgba();
+            record.message = addString(annotation->message());
+            record.solutionHelp = addString(annotation->solutionHelp());
+            record.helpKey = addString(annotation->helpKey());
+            record.category = quint32(annotation->category());
+            m_records.append(record);
+        }
+    }
+}
+
+quint32 AnnotationWriter::addString(const QString &string)
+{
+    auto it = m_indexes.constFind(string);
+    if(it != m_indexes.constEnd())
+        return it.value();
+
+    quint32 index = quint32(m_offsets.size());
+    m_indexes.insert(string, index);
+    m_offsets.append(quint32(m_strings.size()));
+    m_strings.append(string);
+    return index;
+}
+
+int AnnotationWriter::size() const
+{
+    return int(sizeof(quint32)) * 3
+         + m_records.size() * int(sizeof(Record))
+         + (m_offsets.size() + 1) * int(sizeof(quint32))
+         + m_strings.size() * int(sizeof(ushort));
+}
+
+void AnnotationWriter::write(void *destination) const
+{
+    quint32* header = static_cast<quint32*>(destination);
+    header[0] = quint32(m_records.size());
+    header[1] = quint32(m_offsets.size());
+    header[2] = quint32(m_strings.size());
+
+    Record* records = reinterpret_cast<Record*>(header + 3);
+    std::memcpy(records, m_records.constData(), size_t(m_records.size()) * sizeof(Record));
+
+    quint32* offsets = reinterpret_cast<quint32*>(records + m_records.size());
+    std::memcpy(offsets, m_offsets.constData(), size_t(m_offsets.size()) * sizeof(quint32));
+    offsets[m_offsets.size()] = quint32(m_strings.size());
+
+    ushort* data = reinterpret_cast<ushort*>(offsets + m_offsets.size() + 1);
+    std::memcpy(data, m_strings.utf16(), size_t(m_strings.size()) * sizeof(ushort));
+}
+
+bool readAnnotations(const void *source, int size, int lineOffset, AnnotationMap &annotations)
+{
+    using Record = AnnotationWriter::Record;
+
+    if(size < int(sizeof(quint32)) * 3)
+        return false;
+
+    const quint32* header = static_cast<const quint32*>(source);
+    quint32 recordCount = header[0];
+    quint32 stringCount = header[1];
+    quint32 stringDataSize = header[2];
+
+    qint64 expected = qint64(sizeof(quint32)) * 3
+                    + qint64(recordCount) * qint64(sizeof(Record))
+                    + (qint64(stringCount) + 1) * qint64(sizeof(quint32))
+                    + qint64(stringDataSize) * qint64(sizeof(ushort));
+    if(expected > size)
+        return false;
+
+    const Record* records = reinterpret_cast<const Record*>(header + 3);
+    const quint32* offsets = reinterpret_cast<const quint32*>(records + recordCount);
+    const ushort* data = reinterpret_cast<const ushort*>(offsets + stringCount + 1);
+
+    if(offsets[stringCount] > stringDataSize)
+        return false;
+
+    QVector<QString> strings(int(stringCount));
+    for(quint32 i = 0; i < stringCount; ++i) {
+        if(offsets[i] > offsets[i + 1])
+            return false;
+        strings[int(i)] = QString(reinterpret_cast<const QChar*>(data + offsets[i]), int(offsets[i + 1] - offsets[i]));
+    }
+
+    for(quint32 i = 0; i < recordCount; ++i) {
+        const Record& record = records[i];
+        if(record.message >= stringCount || record.solutionHelp >= stringCount || record.helpKey >= stringCount
+                || record.category > Annotation::CATEGORY_Error)
+            continue;
+
+        Annotation* annotation = new Annotation;
+        annotation->setCategory(Annotation::Category(record.category));
+        annotation->setAlertColor(QColor::fromRgba(record.rgba));
+        annotation->setMessage(strings[int(record.message)]);
+        annotation->setSolutionHelp(strings[int(record.solutionHelp)]);
+        annotation->setHelpKey(strings[int(record.helpKey)]);
+        annotations[record.line + lineOffset].append(annotation);
+    }
+
+    return true;
+}
+
+}} // namespace codetextedit::ipc
@@ -0,0 +1,93 @@
+/***********************************************************************
+The CodeTextEditor provides an editor showing live hints and annotations.
+
+Copyright (c) 2020 Brian Newham <seaweedsolutionsltd@gmail.com>.
+
+CodeTextEdit is free software dual licensed under the GNU LGPL or MIT License.
+***********************************************************************/
+
+#ifndef ANNOTATORIPC_H
+#define ANNOTATORIPC_H
+
+#include <QString>
+#include <QStringList>
+#include <QVector>
+#include <QHash>
+#include <QIODevice>
+
+#include "Annotation.h"
+
+///
+/// Wire format shared by RemoteAnnotator and AnnotatorHost.
+///
+/// Only small control messages go over the local socket. The document snapshot and the
+/// analysis result are written straight into shared memory segments named in the messages.
+///
+namespace codetextedit { namespace ipc {
+
+    enum MessageType : quint8
+    {
+        MESSAGE_Request     = 1,    // Editor -> host: analyze the lines in memoryKey
+        MESSAGE_Cancel      = 2,    // Editor -> host: abandon requestId
+        MESSAGE_Result      = 3,    // Host -> editor: annotations are in memoryKey
+        MESSAGE_Cancelled   = 4,    // Host -> editor: requestId was abandoned
+        MESSAGE_Failed      = 5,    // Host -> editor: requestId could not be analyzed
+    };
+
+    struct Message
+    {
+        MessageType type = MESSAGE_Request;
+        quint32     requestId = 0;
+        QString     memoryKey;
+        quint32     size = 0;
+        qint32      lineCount = 0;
+    };
+
+    void writeMessage(QIODevice* device, const Message& message);
+
+    /// Reads one complete message, false if it has not fully arrived yet.
+    bool readMessage(QIODevice* device, Message& message);
+
+    /// Bytes needed for lines [first, first + count).
+    int linesSize(const QStringList& lines, int first, int count);
+    void writeLines(void* destination, const QStringList& lines, int first, int count);
+    bool readLines(const void* source, int size, QStringList& lines);
+
+    ///
+    /// \brief Lays out an AnnotationMap so it can be written in place into shared memory.
+    ///
+    class AnnotationWriter
+    {
+    public:
+        explicit AnnotationWriter(const AnnotationMap& annotations);
+
+        int size() const;
+        void write(void* destination) const;
+
+    private:
+        struct Record
+        {
+            qint32  line;
+            quint32 rgba;
+            quint32 message;
+            quint32 solutionHelp;
+            quint32 helpKey;
+            quint32 category;
+        };
+
+        quint32 addString(const QString& string);
+
+        QVector<Record>         m_records;
+        QVector<quint32>        m_offsets;
+        QString                 m_strings;
+        QHash<QString, quint32> m_indexes;
+
+        friend bool readAnnotations(const void*, int, int, AnnotationMap&);
+    };
+
+    /// Appends the annotations in source to annotations, shifting each line by lineOffset.
+    bool readAnnotations(const void* source, int size, int lineOffset, AnnotationMap& annotations);
+
+}} // namespace codetextedit::ipc
+
+#endif // ANNOTATORIPC_H
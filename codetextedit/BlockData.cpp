@@ -0,0 +1,63 @@
+/***********************************************************************
+The CodeTextEditor provides an editor showing live hints and annotations.
+
+Copyright (c) 2020 Brian Newham <seaweedsolutionsltd@gmail.com>.
+
+CodeTextEdit is free software dual licensed under the GNU LGPL or MIT License.
+***********************************************************************/
+
+#include "BlockData.h"
+
+namespace codetextedit
+{
+
+BlockData::BlockData(const QTextBlock &block, Observer *observer)
+    : m_block(block)
+    , m_observer(observer)
+{
+}
+
+BlockData::~BlockData()
+{
+    if(m_observer != nullptr)
+        m_observer->blockDataDeleted(this);
+    qDeleteAll(m_annotations);
+}
+
+const AnnotationContainer &BlockData::sourceAnnotations(int source) const
+{
+    static const AnnotationContainer none;
+    return source < m_sources.size() ? m_sources[source] : none;
+}
+
+void BlockData::setAnnotations(int source, const AnnotationContainer &annotations)
+{
+    Q_ASSERT(source >= 0 && source < maxSources);
+    if(source >= m_sources.size())
+        m_sources.resize(source + 1);
+
+    qDeleteAll(m_sources[source]);
+    m_sources[source] = annotations;
+
+    m_annotations.clear();
+    for(const AnnotationContainer& container : m_sources)
+        m_annotations += container;
+}
+
+void BlockData::setCost(int source, quint32 nsecs)
+{
+    Q_ASSERT(source >= 0 && source < maxSources);
+    if(source >= m_costs.size())
+        m_costs.resize(source + 1);
+    m_costs[source] = nsecs;
+}
+
+quint64 BlockData::totalCost() const
+{
+    quint64 total = 0;
+    for(quint32 cost : m_costs)
+        total += cost;
+    return total;
+}
+
+} // namespace codetextedit
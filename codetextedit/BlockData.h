@@ -0,0 +1,104 @@
+/***********************************************************************
+The CodeTextEditor provides an editor showing live hints and annotations.
+
+Copyright (c) 2020 Brian Newham <seaweedsolutionsltd@gmail.com>.
+
+CodeTextEdit is free software dual licensed under the GNU LGPL or MIT License.
+***********************************************************************/
+
+#ifndef BLOCKDATA_H
+#define BLOCKDATA_H
+
+#include <QTextBlock>
+#include <QTextBlockUserData>
+
+#include "Annotation.h"
+#include "KeywordScanner.h"
+
+namespace codetextedit
+{
+    class GraphicsAnnotationItem;
+
+    ///
+    /// \brief State the editor keeps with a text block.
+    ///
+    /// Attached as the block's user data, so it moves with the block when lines are inserted
+    /// or removed above it and is deleted with the block. Owns the block's annotations, kept
+    /// apart per source annotator, and keeps the tokens the highlighter lexed it into, so
+    /// nothing lexes the line again.
+    ///
+    class BlockData : public QTextBlockUserData
+    {
+    public:
+        ///
+        /// \brief Told when a block and its data are deleted by an edit.
+        ///
+        class Observer
+        {
+        public:
+            virtual ~Observer() {}
+            virtual void blockDataDeleted(BlockData* data) = 0;
+        };
+
+        BlockData(const QTextBlock& block, Observer* observer);
+        ~BlockData() override;
+
+        /// The block's data, nullptr if it has none.
+        static BlockData* of(const QTextBlock& block) {return static_cast<BlockData*>(block.userData());}
+
+        QTextBlock block() const {return m_block;}
+
+        /// Sources a block can have, one dirty bit each.
+        static const int maxSources = 32;
+
+        /// The annotations of every source, in source order.
+        const AnnotationContainer& annotations() const {return m_annotations;}
+        const AnnotationContainer& sourceAnnotations(int source) const;
+        /// Takes ownership of the source's annotations and deletes its previous ones.
+        void setAnnotations(int source, const AnnotationContainer& annotations);
+
+        /// Gutter row of the block, owned by the scene.
+        GraphicsAnnotationItem* item() const {return m_item;}
+        void setItem(GraphicsAnnotationItem* item) {m_item = item;}
+
+        /// Edited since the source computed its annotations.
+        bool isDirty(int source) const {return m_dirtySources & (1u << source);}
+        void setDirty(int source, bool dirty) {m_dirtySources = dirty ? m_dirtySources | (1u << source) : m_dirtySources & ~(1u << source);}
+        /// Dirty for every source.
+        void markDirty() {m_dirtySources = ~0u;}
+
+        /// Nanoseconds the source last spent analyzing the block, kept while profiling only.
+        quint32 cost(int source) const {return source < m_costs.size() ? m_costs[source] : 0;}
+        void setCost(int source, quint32 nsecs);
+        quint64 totalCost() const;
+        void clearCosts() {m_costs = QVector<quint32>();}
+
+        /// The tokens of the block's text, valid while hasTokens().
+        const QVector<KeywordSpan>& tokens() const {return m_tokens;}
+        bool hasTokens() const {return m_tokensValid;}
+        /// Clears the tokens for the lexer to fill, keeping their storage, and marks them valid.
+        QVector<KeywordSpan>& resetTokens() {m_tokens.clear(); m_tokensValid = true; return m_tokens;}
+        /// For a block whose text changed without being lexed.
+        void invalidateTokens() {m_tokensValid = false;}
+
+        /// Data made before the observer knew of the block, e.g. by the highlighter.
+        Observer* observer() const {return m_observer;}
+        void attach(Observer* observer) {m_observer = observer;}
+        /// Stops notifying, for when the observer goes before the document.
+        void detach() {m_observer = nullptr;}
+
+    private:
+        QTextBlock              m_block;
+        Observer*               m_observer;
+        QVector<AnnotationContainer> m_sources; // Owning
+        AnnotationContainer     m_annotations;      // All of m_sources, in order
+        GraphicsAnnotationItem* m_item = nullptr;
+        quint32                 m_dirtySources = ~0u;
+        QVector<quint32>        m_costs;            // Per source, empty unless profiled
+        QVector<KeywordSpan>    m_tokens;
+        bool                    m_tokensValid = false;
+    };
+
+} // namespace codetextedit
+
+#endif // BLOCKDATA_H
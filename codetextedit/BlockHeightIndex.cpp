@@ -0,0 +1,100 @@
+/***********************************************************************
+The CodeTextEditor provides an editor showing live hints and annotations.
+
+Copyright (c) 2020 Brian Newham <seaweedsolutionsltd@gmail.com>.
+
+CodeTextEdit is free software dual licensed under the GNU LGPL or MIT License.
+***********************************************************************/
+
+#include "BlockHeightIndex.h"
+
+#include <QtGlobal>
+
+namespace codetextedit
+{
+
+void BlockHeightIndex::reset(int blockCount, qreal defaultHeight)
+{
+    m_defaultHeight = defaultHeight;
+    m_heights.fill(defaultHeight, qMax(blockCount, 0));
+    rebuild();
+}
+
+void BlockHeightIndex::insertBlocks(int at, int count)
+{
+    if(count <= 0)
+        return;
+
+    at = qBound(0, at, m_heights.size());
+    m_heights.insert(at, count, m_defaultHeight);
+    rebuild();
+}
+
+void BlockHeightIndex::removeBlocks(int at, int count)
+{
+    at = qBound(0, at, m_heights.size());
+    count = qMin(count, m_heights.size() - at);
+    if(count <= 0)
+        return;
+
+    m_heights.remove(at, count);
+    rebuild();
+}
+
+bool BlockHeightIndex::setHeight(int block, qreal height)
+{
+    if(block < 0 || block >= m_heights.size() || qFuzzyCompare(1 + m_heights[block], 1 + height))
+        return false;
+
+    qreal delta = height - m_heights[block];
+    m_heights[block] = height;
+
+    for(int i = block + 1; i < m_tree.size(); i += i & -i)
+        m_tree[i] += delta;
+    return true;
+}
+
+qreal BlockHeightIndex::top(int block) const
+{
+    qreal sum = 0;
+    for(int i = qMin(block, m_heights.size()); i > 0; i -= i & -i)
+        sum += m_tree[i];
+    return sum;
+}
+
+int BlockHeightIndex::blockAt(qreal y) const
+{
+    int count = m_heights.size();
+    if(count == 0)
+        return -1;
+
+    int step = 1;
+    while(step * 2 <= count)
+        step *= 2;
+
+    // Descends to the number of blocks which end at or above y. Blocks of no height, such
+    // as hidden ones, are skipped over.
+    int blocks = 0;
+    for(; step > 0; step /= 2) {
+        if(blocks + step <= count && m_tree[blocks + step] <= y) {
+            blocks += step;
+            y -= m_tree[blocks];
+        }
+    }
+    return qMin(blocks, count - 1);
+}
+
+void BlockHeightIndex::rebuild()
+{
+    int count = m_heights.size();
+    m_tree.fill(0, count + 1);
+
+    for(int i = 1; i <= count; ++i) {
+        m_tree[i] += m_heights[i - 1];
+        int parent = i + (i & -i);
+        if(parent <= count)
+            m_tree[parent] += m_tree[i];
+    }
+}
+
+} // namespace codetextedit
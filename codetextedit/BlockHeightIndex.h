@@ -0,0 +1,52 @@
+/***********************************************************************
+The CodeTextEditor provides an editor showing live hints and annotations.
+
+Copyright (c) 2020 Brian Newham <seaweedsolutionsltd@gmail.com>.
+
+CodeTextEdit is free software dual licensed under the GNU LGPL or MIT License.
+***********************************************************************/
+
+#ifndef BLOCKHEIGHTINDEX_H
+#define BLOCKHEIGHTINDEX_H
+
+#include <QVector>
+
+namespace codetextedit
+{
+    ///
+    /// \brief Prefix sums over the heights of a document's blocks.
+    ///
+    /// A Fenwick tree, so changing a height and mapping between a block and its y position
+    /// are O(log n). Inserting or removing blocks rebuilds the tree in O(n). Blocks which
+    /// have not been measured yet count with the default height.
+    ///
+    class BlockHeightIndex
+    {
+    public:
+        void reset(int blockCount, qreal defaultHeight);
+        void setDefaultHeight(qreal height) {m_defaultHeight = height;}
+        void insertBlocks(int at, int count);
+        void removeBlocks(int at, int count);
+
+        /// Returns false when the block already had this height.
+        bool setHeight(int block, qreal height);
+        qreal height(int block) const {return m_heights[block];}
+
+        /// Sum of the heights of the blocks before the given one.
+        qreal top(int block) const;
+        /// Block covering y, clamped to the first and last block. -1 when empty.
+        int blockAt(qreal y) const;
+        qreal totalHeight() const {return top(m_heights.size());}
+        int count() const {return m_heights.size();}
+
+    private:
+        void rebuild();
+
+        QVector<qreal>  m_heights;
+        QVector<qreal>  m_tree;         // 1-based, m_tree[i] sums the heights of (i - lowbit(i), i]
+        qreal           m_defaultHeight = 0;
+    };
+
+} // namespace codetextedit
+
+#endif // BLOCKHEIGHTINDEX_H
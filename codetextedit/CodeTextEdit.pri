@@ -1,20 +1,57 @@
+QT += network
+
+include($$PWD/CodeTextLint.pri)
+
 RESOURCES += $$PWD/resources/qte_resources.qrc
 
 HEADERS += \
-    $$PWD/Annotation.h \
+    $$PWD/AnnotationCache.h \
     $$PWD/AnnotationEdit.h \
     $$PWD/AnnotationGraphicsView.h \
+    $$PWD/AnnotationIndex.h \
+    $$PWD/AnnotationOverviewRuler.h \
+    $$PWD/AnnotationResult.h \
+    $$PWD/AnnotationSummaryTree.h \
     $$PWD/AnnotationTextEdit.h \
     $$PWD/AnnotationWorker.h \
+    $$PWD/AnnotatorHost.h \
+    $$PWD/AnnotatorIpc.h \
+    $$PWD/BlockData.h \
+    $$PWD/BlockHeightIndex.h \
     $$PWD/CodeTextHighlighter.h \
+    $$PWD/DocumentSaver.h \
+    $$PWD/FileChangeWorker.h \
     $$PWD/GraphicsAnnotationItem.h \
+    $$PWD/LineDiff.h \
+    $$PWD/LineNumberArea.h \
+    $$PWD/RemoteAnnotator.h \
+    $$PWD/SearchWorker.h \
+    $$PWD/SubstringSearch.h \
+    $$PWD/SymbolIndex.h \
 
 
 SOURCES += \
+    $$PWD/AnnotationCache.cpp \
     $$PWD/AnnotationEdit.cpp \
     $$PWD/AnnotationGraphicsView.cpp \
+    $$PWD/AnnotationIndex.cpp \
+    $$PWD/AnnotationOverviewRuler.cpp \
+    $$PWD/AnnotationResult.cpp \
+    $$PWD/AnnotationSummaryTree.cpp \
     $$PWD/AnnotationTextEdit.cpp \
     $$PWD/AnnotationWorker.cpp \
+    $$PWD/AnnotatorHost.cpp \
+    $$PWD/AnnotatorIpc.cpp \
+    $$PWD/BlockData.cpp \
+    $$PWD/BlockHeightIndex.cpp \
     $$PWD/CodeTextHighlighter.cpp \
+    $$PWD/DocumentSaver.cpp \
+    $$PWD/FileChangeWorker.cpp \
     $$PWD/GraphicsAnnotationItem.cpp \
+    $$PWD/LineDiff.cpp \
+    $$PWD/LineNumberArea.cpp \
+    $$PWD/RemoteAnnotator.cpp \
+    $$PWD/SearchWorker.cpp \
+    $$PWD/SubstringSearch.cpp \
+    $$PWD/SymbolIndex.cpp \
 
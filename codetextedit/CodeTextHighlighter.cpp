@@ -7,6 +7,7 @@ CodeTextEdit is free software dual licensed under the GNU LGPL or MIT License.
 ***********************************************************************/
 
 #include "CodeTextHighlighter.h"
+#include "BlockData.h"
 
 #include <QDebug>
 
@@ -37,242 +38,109 @@ CodeTextHighlighter::CodeTextHighlighter(QTextDocument *parent)
     formatLabelTag.setFontWeight(QFont::Bold);
     formatLabelTag.setForeground(QColor(0xC67BD6));
     formatLabelTag.setBackground(QColor(0xC67BD6).lighter());
+
+    // The index of each format is its id in cached format runs.
+    formatTable = {
+        formatBad,
+        formatDeclarationKey,
+        formatDeclarationValue,
+        formatControlCommandOk,
+        formatControlParams,
+        formatDeviceCommandOk,
+        formatDeviceParams,
+        formatLabelTag,
+    };
 }
 
 void CodeTextHighlighter::setKeywords(Keywords *keywords)
 {
     languageKeywords = keywords;
+    scanner.setKeywords(keywords);
 }
 
-void CodeTextHighlighter::highlightBlock(const QString &line)
-{
-    if(matchLabelTag(line)) return;
-    if(matchCommandFullMulti(line)) return;
-    if(matchCommandFull(line)) return;
-    if(matchCommandPartial(line)) return;
-    if(matchDeclaration(line)) return;
-}
-
-void CodeTextHighlighter::highlightPart(const QRegularExpressionMatch &match, int cap, QTextCharFormat format)
-{
-    setFormat(match.capturedStart(cap),
-              match.capturedLength(cap),
-              format);
-}
-
-void CodeTextHighlighter::highlightControlCommand(const QString &line, int start, int length)
-{
-    if(length == 0)
-        return;
-
-    auto controlCmd = line.mid(start, length);
-    bool goodCommand = languageKeywords && languageKeywords->controlCommands.contains(controlCmd);
-
-    setFormat(start,
-              length,
-              goodCommand  ?  formatControlCommandOk : formatBad);
-}
-
-void CodeTextHighlighter::highlightControlCommand(const QRegularExpressionMatch &match, int cap)
-{
-    if(match.capturedLength(cap) == 0)
-        return;
-
-    auto controlCmd = match.captured(cap);
-    bool goodCommand = languageKeywords && languageKeywords->controlCommands.contains(controlCmd);
-
-    setFormat(match.capturedStart(cap),
-              match.capturedLength(cap),
-              goodCommand  ?  formatControlCommandOk : formatBad);
-}
-
-void CodeTextHighlighter::highlightControlParams(const QString &line, int start, int length)
-{
-    setFormat(start,
-              length,
-              formatControlParams);
-}
-
-void CodeTextHighlighter::highlightControlParams(const QRegularExpressionMatch &match, int cap)
-{
-    setFormat(match.capturedStart(cap),
-              match.capturedLength(cap),
-              formatControlParams);
-
-}
-
-void CodeTextHighlighter::highlightDeviceCommand(const QString &line, int start, int length)
+FormatRunList CodeTextHighlighter::formatRuns(const QTextBlock &block) const
 {
-    if(length == 0)
-        return;
+    FormatRunList runs;
+    if(! block.isValid() || block.layout() == nullptr)
+        return runs;
 
-    auto controlCmd = line.mid(start, length);
-    bool goodCommand = languageKeywords && languageKeywords->deviceCommands.contains(controlCmd);
+    for(const QTextLayout::FormatRange& range : block.layout()->formats()) {
+        int id = formatTable.indexOf(range.format);
+        if(id == -1)
+            continue;
 
-    setFormat(start,
-              length,
-              goodCommand  ?  formatDeviceCommandOk : formatBad);
-}
-
-void CodeTextHighlighter::highlightDeviceCommand(const QRegularExpressionMatch &match, int cap)
-{
-    if(match.capturedLength(cap) == 0)
-        return;
-
-    auto deviceCmd = match.captured(cap);
-    bool goodCommand = languageKeywords && languageKeywords->deviceCommands.contains(deviceCmd);
-
-    setFormat(match.capturedStart(cap),
-              match.capturedLength(cap),
-              goodCommand  ?  formatDeviceCommandOk : formatBad);
-}
+        FormatRun run;
+        run.start = range.start;
+        run.length = range.length;
+        run.formatId = id;
+        runs.append(run);
+    }
 
-void CodeTextHighlighter::highlightDeviceParams(const QString &, int start, int length)
-{
-    setFormat(start,
-              length,
-              formatDeviceParams);
+    return runs;
 }
 
-void CodeTextHighlighter::highlightDeviceParams(const QRegularExpressionMatch &match, int cap)
+void CodeTextHighlighter::setCachedFormats(const FormatRunMap &formats)
 {
-    setFormat(match.capturedStart(cap),
-              match.capturedLength(cap),
-              formatDeviceParams);
+    cachedFormats = formats;
+    useCachedFormats = true;
 }
 
-void CodeTextHighlighter::highlightLabelTag(const QRegularExpressionMatch &match, int cap)
+void CodeTextHighlighter::clearCachedFormats()
 {
-    auto labelName = match.captured(cap);
-
-    setFormat(match.capturedStart(cap),
-              match.capturedLength(cap),
-              formatLabelTag);
+    cachedFormats.clear();
+    useCachedFormats = false;
 }
 
-bool CodeTextHighlighter::matchCommandFullMulti(const QString &line)
+void CodeTextHighlighter::applyCachedFormats(int blockNumber)
 {
-    // Matches a control code plus an sequence of device commands separated by a separator...
-
-    auto pattern = QRegularExpression(R"____(^(\w+)(,\d+)?\s+([\w,;0-9]+)?(\s+//.+)?)____", QRegularExpression::CaseInsensitiveOption);
-    auto match = pattern.match(line);
-
-    if(match.hasMatch() && match.capturedStart() == 0) {
-
-        highlightControlCommand(match, 1);
-        highlightControlParams(match, 2);
-
-        auto cpbRow = match.captured(3);
-        if(! cpbRow.contains(';'))
-            return false;
-
-        int cpbStart = match.capturedStart(3);
-        int lastEnd = 0;
-
-        auto reCPB = QRegularExpression(R"____((\w+)([,0-9MPX]+)?)____", QRegularExpression::CaseInsensitiveOption);
-
-        QRegularExpressionMatchIterator i = reCPB.globalMatch(cpbRow);
-        while (i.hasNext()) {
-            QRegularExpressionMatch match = i.next();
-
-            int pos = match.capturedStart();
-            int len = match.capturedLength();
-            int cmdPos = match.capturedStart(1);
-            int cmdLen = match.capturedLength(1);
-            int paramPos = match.capturedStart(2);
-            int paramLen = match.capturedLength(2);
-
-            if(match.capturedStart() > 0) {
-
-                if(lastEnd + 1  !=  pos) { } // Syntax error: Separator is not a ;
-                if(cpbRow[pos - 1] != ';') { } // Syntax error: Separator is not ;
-            }
-
-            highlightDeviceCommand(line, cpbStart + cmdPos, cmdLen);
-            highlightDeviceParams(line, cpbStart + paramPos, paramLen);
-
-            lastEnd = pos + len;
-        }
-
-        return true;
+    for(const FormatRun& run : cachedFormats.value(blockNumber)) {
+        if(run.formatId >= 0 && run.formatId < formatTable.size())
+            setFormat(run.start, run.length, formatTable[run.formatId]);
     }
-
-    return false;
 }
 
-bool CodeTextHighlighter::matchCommandFull(const QString &line)
+void CodeTextHighlighter::highlightBlock(const QString &line)
 {
-    // Matches a control code plus an optional device code ...
+    // The block's tokens are kept with it for the annotations, see BlockData::tokens().
+    BlockData *data = BlockData::of(currentBlock());
 
-    auto pattern = QRegularExpression(R"____(^(\w+)(,\d+)?\s+(\w+)([,0-9MPX]+)?(\s+//.+)?)____", QRegularExpression::CaseInsensitiveOption);
-    auto match = pattern.match(line);
-    if(match.hasMatch() && match.capturedStart() == 0) {
-
-        highlightControlCommand(match, 1);
-        highlightControlParams(match, 2);
-        highlightDeviceCommand(match, 3);
-        highlightDeviceParams(match, 4);
-
-        return true;
-    }
-    else {
-        return false;
+    if(suspended || useCachedFormats) {
+        if(data != nullptr)
+            data->invalidateTokens();
+        if(useCachedFormats && ! suspended)
+            applyCachedFormats(currentBlock().blockNumber());
+        return;
     }
-}
-
-bool CodeTextHighlighter::matchCommandPartial(const QString &line)
-{
-    // Matches a control code only ...
-
-    auto pattern = QRegularExpression(R"____((\w+)(,\d+)?)____", QRegularExpression::CaseInsensitiveOption);
-    auto match = pattern.match(line);
-    if(match.hasMatch() && match.capturedStart() == 0) {
-
-        highlightControlCommand(match, 1);
-        highlightControlParams(match, 2);
 
-        return true;
+    if(data == nullptr) {
+        data = new BlockData(currentBlock(), nullptr);
+        setCurrentBlockUserData(data);
     }
-    else {
-        return false;
-    }
-}
-
-bool CodeTextHighlighter::matchDeclaration(const QString &line)
-{
-    auto pattern = QRegularExpression(R"____(#\s*(\w+)(\s*=\s*(\w+))?)____", QRegularExpression::CaseInsensitiveOption);
-    auto match = pattern.match(line);
-    if(match.hasMatch() && match.capturedStart() == 0) {
 
-        highlightPart(match, 1, formatDeclarationKey);
-        highlightPart(match, 3, formatDeclarationValue);
-
-        return true;
-    }
-    else {
-        return false;
+    QVector<KeywordSpan>& tokens = data->resetTokens();
+    scanner.scan(line, tokens);
+    for(const KeywordSpan& span : tokens) {
+        if(! span.isError())
+            setFormat(span.start, span.length, formatOf(span.kind));
     }
 }
 
-bool CodeTextHighlighter::matchLabelTag(const QString &line)
-{
-    // Matches a label,number ...
-
-    auto pattern = QRegularExpression(R"____((\w+),\d+)____", QRegularExpression::CaseInsensitiveOption);
-    auto match = pattern.match(line);
-    if(match.hasMatch() && match.capturedStart() == 0) {
-
-        if(languageKeywords && ! languageKeywords->goodLabelNames.contains(match.captured(1)))
-            return false;
-
-        highlightLabelTag(match, 0);
-
-        return true;
-    }
-    else {
-        return false;
+const QTextCharFormat &CodeTextHighlighter::formatOf(KeywordSpan::Kind kind) const
+{
+    switch(kind) {
+    case KeywordSpan::SPAN_DeclarationKey:          return formatDeclarationKey;
+    case KeywordSpan::SPAN_DeclarationValue:        return formatDeclarationValue;
+    case KeywordSpan::SPAN_ControlCommand:          return formatControlCommandOk;
+    case KeywordSpan::SPAN_ControlParams:           return formatControlParams;
+    case KeywordSpan::SPAN_DeviceCommand:           return formatDeviceCommandOk;
+    case KeywordSpan::SPAN_DeviceParams:            return formatDeviceParams;
+    case KeywordSpan::SPAN_LabelTag:                return formatLabelTag;
+    case KeywordSpan::SPAN_UnknownControlCommand:
+    case KeywordSpan::SPAN_UnknownDeviceCommand:
+    case KeywordSpan::SPAN_MissingSeparator:
+    case KeywordSpan::SPAN_BadSeparator:            break;
     }
+    return formatBad;
 }
 
 } // namespace codetextedit
-
@@ -13,16 +13,13 @@ CodeTextEdit is free software dual licensed under the GNU LGPL or MIT License.
 #include <QRegularExpression>
 #include <QTextCharFormat>
 #include <QTextDocument>
+#include <QTextBlock>
 
-namespace codetextedit {
+#include "AnnotationCache.h"
+#include "Keywords.h"
+#include "KeywordScanner.h"
 
-struct Keywords
-{
-    QString version;
-    QStringList controlCommands;
-    QStringList deviceCommands;
-    QStringList goodLabelNames;
-};
+namespace codetextedit {
 
 class CodeTextHighlighter : public QSyntaxHighlighter
 {
@@ -32,27 +29,29 @@ public:
     CodeTextHighlighter(QTextDocument *parent = nullptr);
 
     void setKeywords(Keywords* keywords);
+    Keywords* keywords() const {return languageKeywords;}
+
+    /// The lexer behind the formats, for blocks it has not tokenized yet.
+    const KeywordScanner& keywordScanner() const {return scanner;}
+
+    /// Formats of a highlighted block, as indexes into the highlighter's format table.
+    FormatRunList formatRuns(const QTextBlock& block) const;
+
+    /// While set, blocks take their formats from the given runs instead of being matched.
+    void setCachedFormats(const FormatRunMap& formats);
+    void clearCachedFormats();
+
+    /// While suspended, blocks touched by edits are left without formats and are not matched.
+    /// rehighlightBlock() restores them once the suspension ends.
+    void setSuspended(bool enable) {suspended = enable;}
+    bool isSuspended() const {return suspended;}
 
 protected:
     void highlightBlock(const QString &line) override;
 
-    void highlightPart(const QRegularExpressionMatch& match, int cap, QTextCharFormat format);
-
-    void highlightControlCommand(const QString& line, int start, int length);
-    void highlightControlCommand(const QRegularExpressionMatch& match, int cap);
-    void highlightControlParams(const QString& line, int start, int length);
-    void highlightControlParams(const QRegularExpressionMatch& match, int cap);
-    void highlightDeviceCommand(const QString& line, int start, int length);
-    void highlightDeviceCommand(const QRegularExpressionMatch& match, int cap);
-    void highlightDeviceParams(const QString& line, int start, int length);
-    void highlightDeviceParams(const QRegularExpressionMatch& match, int cap);
-    void highlightLabelTag(const QRegularExpressionMatch& match, int cap);
+    const QTextCharFormat& formatOf(KeywordSpan::Kind kind) const;
 
-    bool matchCommandFullMulti(const QString& line);
-    bool matchCommandFull(const QString& line);
-    bool matchCommandPartial(const QString& line);
-    bool matchDeclaration(const QString& line);
-    bool matchLabelTag(const QString& line);
+    void applyCachedFormats(int blockNumber);
 
 private:
     QTextCharFormat formatBad;
@@ -67,6 +66,13 @@ private:
 
     QTextCharFormat formatLabelTag;
 
+    QVector<QTextCharFormat> formatTable;
+    FormatRunMap cachedFormats;
+    bool useCachedFormats = false;
+    bool suspended = false;
+
+    KeywordScanner scanner;
+
 protected:
     Keywords* languageKeywords = nullptr;
 };
@@ -0,0 +1,24 @@
+# The parts of CodeTextEdit which run without widgets, see lint/.
+QT += gui
+
+HEADERS += \
+    $$PWD/Annotation.h \
+    $$PWD/Keywords.h \
+    $$PWD/KeywordScanner.h \
+    $$PWD/KeywordSpan.h \
+    $$PWD/LineIndex.h \
+    $$PWD/LintEngine.h \
+    $$PWD/PatternAutomaton.h \
+    $$PWD/RuleAnnotator.h \
+    $$PWD/RuleSet.h \
+
+
+SOURCES += \
+    $$PWD/Keywords.cpp \
+    $$PWD/KeywordScanner.cpp \
+    $$PWD/LineIndex.cpp \
+    $$PWD/LintEngine.cpp \
+    $$PWD/PatternAutomaton.cpp \
+    $$PWD/RuleAnnotator.cpp \
+    $$PWD/RuleSet.cpp \
+
@@ -0,0 +1,110 @@
+/***********************************************************************
+The CodeTextEditor provides an editor showing live hints and annotations.
+
+Copyright (c) 2020 Brian Newham <seaweedsolutionsltd@gmail.com>.
+
+CodeTextEdit is free software dual licensed under the GNU LGPL or MIT License.
+***********************************************************************/
+
+#include <QSaveFile>
+#include <QDebug>
+
+#include "DocumentSaver.h"
+
+namespace codetextedit {
+
+DocumentSaver::DocumentSaver(const QString &filePath, QObject *parent)
+    : QThread(parent)
+    , m_filePath(filePath)
+{
+}
+
+DocumentSaver::~DocumentSaver()
+{
+    abort();
+    wait();
+}
+
+bool DocumentSaver::hasSpace() const
+{
+    QMutexLocker locker(&mutex);
+    return queuedChars < maxQueuedChars;
+}
+
+void DocumentSaver::append(const QString &text)
+{
+    QMutexLocker locker(&mutex);
+    queue.enqueue(text);
+    queuedChars += text.size();
+    condition.wakeOne();
+}
+
+void DocumentSaver::finish()
+{
+    QMutexLocker locker(&mutex);
+    finished = true;
+    condition.wakeOne();
+}
+
+void DocumentSaver::abort()
+{
+    QMutexLocker locker(&mutex);
+    aborted = true;
+    queue.clear();
+    queuedChars = 0;
+    condition.wakeOne();
+}
+
+void DocumentSaver::run()
+{
+    QSaveFile file(m_filePath);
+    if(! file.open(QIODevice::WriteOnly)) {
+        emit failed(m_filePath, file.errorString());
+        return;
+    }
+
+    forever {
+        mutex.lock();
+        while(queue.isEmpty() && ! finished && ! aborted)
+            condition.wait(&mutex);
+
+        if(aborted) {
+            mutex.unlock();
+            file.cancelWriting();
+            return;
+        }
+        if(queue.isEmpty()) {
+            // Finished and everything is written.
+            mutex.unlock();
+            break;
+        }
+
+        QString text = queue.dequeue();
+        bool wasFull = queuedChars >= maxQueuedChars;
+        queuedChars -= text.size();
+        bool hasSpace = queuedChars < maxQueuedChars;
+        mutex.unlock();
+
+        if(wasFull && hasSpace)
+            emit spaceAvailable();
+
+        // Encoded a chunk at a time, the whole document is never held twice.
+        QByteArray bytes = text.toUtf8();
+        text.clear();
+        if(file.write(bytes) != bytes.size()) {
+            QString error = file.errorString();
+            file.cancelWriting();
+            emit failed(m_filePath, error);
+            return;
+        }
+    }
+
+    if(! file.commit()) {
+        emit failed(m_filePath, file.errorString());
+        return;
+    }
+
+    emit saved(m_filePath);
+}
+
+} // namespace codetextedit
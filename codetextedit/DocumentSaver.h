@@ -0,0 +1,68 @@
+/***********************************************************************
+The CodeTextEditor provides an editor showing live hints and annotations.
+
+Copyright (c) 2020 Brian Newham <seaweedsolutionsltd@gmail.com>.
+
+CodeTextEdit is free software dual licensed under the GNU LGPL or MIT License.
+***********************************************************************/
+
+#ifndef DOCUMENTSAVER_H
+#define DOCUMENTSAVER_H
+
+#include <QThread>
+#include <QMutex>
+#include <QWaitCondition>
+#include <QQueue>
+#include <QString>
+
+namespace codetextedit {
+
+///
+/// \brief Writes text handed over in chunks to a file on its own thread.
+///
+/// The text is encoded as UTF-8 and written to a temporary file, which replaces the target
+/// only once everything was written. At most maxQueuedChars of text wait in the queue, the
+/// producer appends again after spaceAvailable().
+///
+class DocumentSaver : public QThread
+{
+    Q_OBJECT
+
+public:
+    static const int maxQueuedChars = 4 << 20;
+
+    DocumentSaver(const QString& filePath, QObject *parent = nullptr);
+    ~DocumentSaver() override;
+
+    QString filePath() const {return m_filePath;}
+
+    /// False while the queue is full.
+    bool hasSpace() const;
+    void append(const QString& text);
+    /// No more text follows, the file is committed once the queue is written.
+    void finish();
+    /// Abandons the save, the target is left untouched.
+    void abort();
+
+signals:
+    void spaceAvailable();
+    void saved(QString filePath);
+    void failed(QString filePath, QString error);
+
+protected:
+    void run() override;
+
+private:
+    QString             m_filePath;
+
+    mutable QMutex      mutex;
+    QWaitCondition      condition;
+    QQueue<QString>     queue;
+    int                 queuedChars = 0;
+    bool                finished = false;
+    bool                aborted = false;
+};
+
+} // namespace codetextedit
+
+#endif // DOCUMENTSAVER_H
@@ -0,0 +1,109 @@
+/***********************************************************************
+The CodeTextEditor provides an editor showing live hints and annotations.
+
+Copyright (c) 2020 Brian Newham <seaweedsolutionsltd@gmail.com>.
+
+CodeTextEdit is free software dual licensed under the GNU LGPL or MIT License.
+***********************************************************************/
+
+#include <QFile>
+#include <QDebug>
+
+#include <utility>
+
+#include "FileChangeWorker.h"
+#include "LineIndex.h"
+
+namespace codetextedit {
+
+FileChangeWorker::FileChangeWorker(QObject *parent)
+    : QThread(parent)
+{
+}
+
+FileChangeWorker::~FileChangeWorker()
+{
+    kill();
+    wait();
+}
+
+void FileChangeWorker::kill()
+{
+    QMutexLocker locker(&mutex);
+    killLoop = true;
+    restart = true;
+    condition.wakeOne();
+}
+
+void FileChangeWorker::compare(const QString &filePath, const QStringList &lines, int revision)
+{
+    QMutexLocker locker(&mutex);
+
+    this->filePath = filePath;
+    this->lines = lines;
+    this->revision = revision;
+
+    if (!isRunning()) {
+        start(LowPriority);
+    }
+    else {
+        restart = true;
+        condition.wakeOne();
+    }
+}
+
+FileChangeWorker::Result FileChangeWorker::takeResult()
+{
+    QMutexLocker locker(&mutex);
+    Result result = std::move(pending);
+    pending = Result();
+    return result;
+}
+
+void FileChangeWorker::run()
+{
+    forever {
+        mutex.lock();
+        Result result;
+        result.filePath = this->filePath;
+        result.revision = this->revision;
+        QStringList lines = this->lines;
+        this->lines.clear();
+        this->revision = -1;
+        restart = false;
+        mutex.unlock();
+
+        if(! result.filePath.isEmpty() && result.revision != -1) {
+            // Read the way loadFile() reads, as UTF-8 split into lines.
+            QFile file(result.filePath);
+            if(file.open(QFile::ReadOnly | QFile::Text)) {
+                QString text = QString::fromUtf8(file.readAll());
+                LineIndex index;
+                index.build(text.constData(), text.size());
+                QStringList fileLines = index.lines(text);
+                result.readOk = true;
+                if(! restart)
+                    result.hunks = diffLines(lines, fileLines);
+            }
+
+            if(! restart) {
+                mutex.lock();
+                pending = std::move(result);
+                mutex.unlock();
+                emit compared();
+            }
+        }
+
+        mutex.lock();
+        if (!restart)
+            condition.wait(&mutex);
+
+        if(killLoop) {
+            mutex.unlock();
+            return;
+        }
+        mutex.unlock();
+    }
+}
+
+} // namespace codetextedit
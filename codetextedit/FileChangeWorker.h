@@ -0,0 +1,67 @@
+/***********************************************************************
+The CodeTextEditor provides an editor showing live hints and annotations.
+
+Copyright (c) 2020 Brian Newham <seaweedsolutionsltd@gmail.com>.
+
+CodeTextEdit is free software dual licensed under the GNU LGPL or MIT License.
+***********************************************************************/
+
+#ifndef FILECHANGEWORKER_H
+#define FILECHANGEWORKER_H
+
+#include <QObject>
+#include <QThread>
+#include <QMutex>
+#include <QWaitCondition>
+#include <QStringList>
+
+#include "LineDiff.h"
+
+namespace codetextedit {
+
+///
+/// \brief Worker class which diffs a file on disk against a snapshot of the buffer
+///
+class FileChangeWorker : public QThread
+{
+    Q_OBJECT
+
+public:
+    struct Result
+    {
+        QString             filePath;
+        int                 revision = -1;      // Of the buffer snapshot, -1 for no result
+        bool                readOk = false;
+        QVector<LineHunk>   hunks;              // Turn the snapshot into the file
+    };
+
+    FileChangeWorker(QObject *parent = nullptr);
+    ~FileChangeWorker() override;
+
+    void kill();
+    void compare(const QString& filePath, const QStringList& lines, int revision);
+
+    /// Moves out the latest result, like AnnotationWorker::takeResult().
+    Result takeResult();
+
+signals:
+    void compared();
+
+protected:
+    void run() override;
+
+private:
+    QMutex          mutex;
+    QWaitCondition  condition;
+    bool            restart = false;
+    bool            killLoop = false;
+
+    QString         filePath;
+    QStringList     lines;
+    int             revision = -1;
+    Result          pending;            // Guarded by mutex
+};
+
+} // namespace codetextedit
+
+#endif // FILECHANGEWORKER_H
@@ -81,7 +81,7 @@ QRectF AnnotationButton::boundingRect() const
     int diameter = paintingStyle.diameter;
     int radius = diameter / 2;
     int lineheight = m_item->m_ascent + m_item->m_descent;
-    int x = m_item->buttonTab() + m_index * (diameter + m_item->buttonGap);
+    int x = m_item->buttonTab() + m_slot * (diameter + m_item->buttonGap);
     int y = -m_item->m_ascent + lineheight/2;
     return QRectF(x - radius, y - radius, diameter, diameter);
 }
@@ -105,10 +105,19 @@ GraphicsAnnotationItem::GraphicsAnnotationItem
             m_buttonList.append(button);
             m_messageList.append(container[i]->message());
         }
+        m_visibleButtons = m_buttonList.count();
     }
     setAcceptHoverEvents(true);
 }
 
+GraphicsAnnotationItem::~GraphicsAnnotationItem()
+{
+    // Rows are deleted one at a time as their lines go.
+    if (currentHighlight == this)
+        currentHighlight = nullptr;
+    qDeleteAll(m_buttonList);
+}
+
 void GraphicsAnnotationItem::paint(QPainter *painter, const QStyleOptionGraphicsItem*,  QWidget*)
 {
     painter->save();
@@ -116,6 +125,13 @@ void GraphicsAnnotationItem::paint(QPainter *painter, const QStyleOptionGraphics
     QBrush brush(QColor("white"),Qt::SolidPattern);
     painter->setPen(Qt::NoPen);
     painter->drawRect(rect);
+    if (m_heat > 0)
+    {
+        QColor heatColor(0xE0, 0x40, 0x20);
+        heatColor.setAlphaF(0.1 + 0.7 * qMin(m_heat, qreal(1)));
+        painter->setBrush(QBrush(heatColor, Qt::SolidPattern));
+        painter->drawRect(rect);
+    }
     if (m_highlight)
     {
         QBrush brush(QColor(0xD8,0xD8,0xD8),Qt::SolidPattern);
@@ -132,14 +148,17 @@ void GraphicsAnnotationItem::paint(QPainter *painter, const QStyleOptionGraphics
     if (m_buttonTab != -1)
     {
         for (int i=0; i<m_buttonList.count(); i++)
-            m_buttonList[i]->paint(painter);
+        {
+            if (!m_buttonList[i]->isHidden())
+                m_buttonList[i]->paint(painter);
+        }
     }
     painter->restore();
 }
 
 QRectF GraphicsAnnotationItem::boundingRect() const
 {
-    int width = m_buttonTab + m_buttonList.count()*(buttonGap + AnnotationButton::style().diameter);
+    int width = m_buttonTab + m_visibleButtons*(buttonGap + AnnotationButton::style().diameter);
     //qDebug() << QRectF(0, -m_ascent, width, m_ascent + m_descent);
     return QRectF(0, -m_ascent, width, m_ascent + m_descent);
 }
@@ -154,6 +173,8 @@ int GraphicsAnnotationItem::capture(QPointF pt)
     {
         for (int i=0; i < m_buttonList.count(); i++)
         {
+            if (m_buttonList[i]->isHidden())
+                continue;
             QRectF rect = m_buttonList[i]->boundingRect();
             //qDebug() << i << rect << buttonGap << pt.x() << (pt.x() >= rect.x()-buttonGap/2 && pt.x() <= rect.right()+buttonGap/2);
             if (pt.x() >= rect.x()-buttonGap/2 && pt.x() <= rect.right()+buttonGap/2)
@@ -175,6 +196,32 @@ int GraphicsAnnotationItem::capture(QPointF pt)
     return index;
 }
 
+void GraphicsAnnotationItem::setVisibleAnnotations(const QVector<int>& indexes, int defaultButton)
+{
+    // A single visible annotation needs no buttons, just like a single annotation.
+    bool showButtons = indexes.count() > 1;
+
+    prepareGeometryChange();
+    for (AnnotationButton* button : m_buttonList)
+        button->setHidden(true);
+
+    m_visibleButtons = 0;
+    if (showButtons)
+    {
+        for (int index : indexes)
+        {
+            if (index < 0 || index >= m_buttonList.count())
+                continue;
+            m_buttonList[index]->setHidden(false);
+            m_buttonList[index]->setSlot(m_visibleButtons++);
+        }
+    }
+
+    m_defaultButton = showButtons ? defaultButton : -1;
+    reset();
+    update();
+}
+
 void GraphicsAnnotationItem::setChecked(int index)
 {
     for (int i=0; i< m_buttonList.count(); i++)
@@ -14,6 +14,7 @@ CodeTextEdit is free software dual licensed under the GNU LGPL or MIT License.
 #include <QPaintEvent>
 #include <QPointF>
 #include <QObject>
+#include <QVector>
 #include "Annotation.h"
 
 namespace codetextedit
@@ -33,7 +34,7 @@ namespace codetextedit
 
         };
         AnnotationButton(GraphicsAnnotationItem* item, int index, const QColor& color)
-          : m_item(item), m_index(index), m_color(color) {}
+          : m_item(item), m_index(index), m_slot(index), m_color(color) {}
         virtual ~AnnotationButton() = default;
         void paint(QPainter* painter);
 
@@ -41,14 +42,19 @@ namespace codetextedit
         GraphicsAnnotationItem* item() {return m_item;}
         void setChecked(bool checked) {m_checked = checked;}
         bool isChecked() const {return m_checked;}
+        void setSlot(int slot) {m_slot = slot;}
+        void setHidden(bool hidden) {m_hidden = hidden;}
+        bool isHidden() const {return m_hidden;}
         QRectF boundingRect() const;
         static void setStyle(PaintingStyle style) {paintingStyle = style;}
         static PaintingStyle style() {return paintingStyle;}
     private:
         GraphicsAnnotationItem* m_item;
         int m_index;
+        int m_slot;             // Position among the visible buttons
         QColor m_color;
         bool m_checked = false;
+        bool m_hidden = false;
         static PaintingStyle paintingStyle;
 
         void paintStyle1(QPainter*);
@@ -60,13 +66,16 @@ namespace codetextedit
     public:
         GraphicsAnnotationItem(QGraphicsItem* parent = nullptr);
         GraphicsAnnotationItem(const QString&, const AnnotationContainer&, int, QGraphicsItem* parent = nullptr);
+        ~GraphicsAnnotationItem() override;
         void paint(QPainter*, const QStyleOptionGraphicsItem* =nullptr,  QWidget* =nullptr) override;
-        void setButtonTab(int tab) {m_buttonTab = tab;}
+        void setButtonTab(int tab) {if (tab != m_buttonTab) {prepareGeometryChange(); m_buttonTab = tab;}}
         void setLineAscentDescent(int ascent, int descent) {m_ascent=ascent; m_descent=descent;}
         void setFont(QFont font) {m_font = font;}
         void setPlainText(QString text) {m_message = text;}
         void setDefaultTextColor(QColor color) {m_color=color;}
         int buttonTab() {return m_buttonTab;}
+        void setMessageWidth(int width) {m_messageWidth = width;}
+        int messageWidth() const {return m_messageWidth;}
         int capture(QPointF);
         bool isCaptured() const {return m_captured;}
         void setChecked(int);
@@ -74,9 +83,14 @@ namespace codetextedit
         QRectF boundingRect() const override;
         void reset();
         int buttonsCount() {return m_buttonList.count();}
+        int visibleButtonsCount() const {return m_visibleButtons;}
+        void setVisibleAnnotations(const QVector<int>& indexes, int defaultButton);
         static void setHighlight(GraphicsAnnotationItem* item);
         void hover();
         QString message() const {return m_message;}
+        /// Shades the row by its share of the slowest line's analysis time, 0 for none.
+        void setHeat(qreal heat) {if (heat != m_heat) {m_heat = heat; update();}}
+        qreal heat() const {return m_heat;}
 
         static const int buttonGap = 16;
     private:
@@ -88,9 +102,12 @@ namespace codetextedit
         int m_ascent = 0;
         int m_descent = 0;
         int m_buttonTab = -1;
+        int m_messageWidth = 0;     // Room the message needs before the buttons
         int m_defaultButton=-1;
+        int m_visibleButtons=0;
         bool m_captured=false;
         bool m_highlight = false;
+        qreal m_heat = 0;
         static GraphicsAnnotationItem *currentHighlight;
 
         friend class AnnotationButton;
@@ -0,0 +1,247 @@
+/***********************************************************************
+The CodeTextEditor provides an editor showing live hints and annotations.
+
+Copyright (c) 2020 Brian Newham <seaweedsolutionsltd@gmail.com>.
+
+CodeTextEdit is free software dual licensed under the GNU LGPL or MIT License.
+***********************************************************************/
+
+#include "KeywordScanner.h"
+
+namespace codetextedit {
+
+KeywordScanner::KeywordScanner()
+    : patternCommandFullMulti(R"____(^(\w+)(,\d+)?\s+([\w,;0-9]+)?(\s+//.+)?)____", QRegularExpression::CaseInsensitiveOption)
+    , patternDeviceCommand(R"____((\w+)([,0-9MPX]+)?)____", QRegularExpression::CaseInsensitiveOption)
+    , patternCommandFull(R"____(^(\w+)(,\d+)?\s+(\w+)([,0-9MPX]+)?(\s+//.+)?)____", QRegularExpression::CaseInsensitiveOption)
+    , patternCommandPartial(R"____((\w+)(,\d+)?)____", QRegularExpression::CaseInsensitiveOption)
+    , patternDeclaration(R"____(#\s*(\w+)(\s*=\s*(\w+))?)____", QRegularExpression::CaseInsensitiveOption)
+    , patternLabelTag(R"____((\w+),\d+)____", QRegularExpression::CaseInsensitiveOption)
+{
+}
+
+void KeywordScanner::scan(const QString &line, QVector<KeywordSpan> &spans) const
+{
+    if(matchLabelTag(line, spans)) return;
+    if(matchCommandFullMulti(line, spans)) return;
+    if(matchCommandFull(line, spans)) return;
+    if(matchCommandPartial(line, spans)) return;
+    if(matchDeclaration(line, spans)) return;
+}
+
+void KeywordScanner::addSpan(QVector<KeywordSpan> &spans, int start, int length, KeywordSpan::Kind kind) const
+{
+    if(length <= 0)
+        return;
+
+    KeywordSpan span;
+    span.start = start;
+    span.length = length;
+    span.kind = kind;
+    spans.append(span);
+}
+
+void KeywordScanner::addError(QVector<KeywordSpan> &spans, int start, int length, KeywordSpan::Kind kind) const
+{
+    KeywordSpan span;
+    span.start = start;
+    span.length = length;
+    span.kind = kind;
+    spans.append(span);
+}
+
+QString KeywordScanner::errorMessage(const QString &line, const KeywordSpan &span)
+{
+    switch(span.kind) {
+    case KeywordSpan::SPAN_MissingSeparator:
+        return QString("Missing ';' before device command");
+    case KeywordSpan::SPAN_BadSeparator:
+        return QString("Expected ';' between device commands, found '%1'").arg(line.mid(span.start, span.length));
+    default:
+        break;
+    }
+    return QString();
+}
+
+QStringRef KeywordScanner::firstCommand(const QString &line, const QVector<KeywordSpan> &spans)
+{
+    for(const KeywordSpan& span : spans) {
+        if(span.start != 0)
+            continue;
+
+        int length;
+        if(span.kind == KeywordSpan::SPAN_ControlCommand || span.kind == KeywordSpan::SPAN_UnknownControlCommand)
+            length = span.length;
+        else if(span.kind == KeywordSpan::SPAN_LabelTag)
+            length = line.indexOf(',');
+        else
+            continue;
+
+        if(length == line.size() || line.at(length) == ',')
+            return line.leftRef(length);
+        return QStringRef();
+    }
+    return QStringRef();
+}
+
+void KeywordScanner::labelSymbols(const QString &line, const QVector<KeywordSpan> &spans,
+                                  QStringList &definitions, QStringList &references) const
+{
+    if(languageKeywords == nullptr)
+        return;
+
+    for(int i = 0; i < spans.size(); ++i) {
+        const KeywordSpan& span = spans[i];
+        if(span.kind == KeywordSpan::SPAN_LabelTag && span.start == 0) {
+            definitions.append(line.left(span.length));
+            continue;
+        }
+
+        if(span.kind != KeywordSpan::SPAN_DeviceCommand && span.kind != KeywordSpan::SPAN_UnknownDeviceCommand)
+            continue;
+        if(i + 1 == spans.size() || spans[i + 1].kind != KeywordSpan::SPAN_DeviceParams || spans[i + 1].start != span.start + span.length)
+            continue;
+
+        // A single number, ",3".
+        const KeywordSpan& params = spans[i + 1];
+        bool number = params.length > 1 && line.at(params.start) == ',';
+        for(int c = params.start + 1; number && c < params.start + params.length; ++c)
+            number = line.at(c).isDigit();
+
+        if(number && languageKeywords->goodLabelNames.contains(line.mid(span.start, span.length)))
+            references.append(line.mid(span.start, span.length + params.length));
+    }
+}
+
+void KeywordScanner::addControlCommand(QVector<KeywordSpan> &spans, const QString &command, int start) const
+{
+    bool goodCommand = languageKeywords && languageKeywords->controlCommands.contains(command);
+    addSpan(spans, start, command.length(), goodCommand ? KeywordSpan::SPAN_ControlCommand : KeywordSpan::SPAN_UnknownControlCommand);
+}
+
+void KeywordScanner::addDeviceCommand(QVector<KeywordSpan> &spans, const QString &command, int start) const
+{
+    bool goodCommand = languageKeywords && languageKeywords->deviceCommands.contains(command);
+    addSpan(spans, start, command.length(), goodCommand ? KeywordSpan::SPAN_DeviceCommand : KeywordSpan::SPAN_UnknownDeviceCommand);
+}
+
+bool KeywordScanner::matchCommandFullMulti(const QString &line, QVector<KeywordSpan> &spans) const
+{
+    // Matches a control code plus an sequence of device commands separated by a separator...
+
+    auto match = patternCommandFullMulti.match(line);
+
+    if(match.hasMatch() && match.capturedStart() == 0) {
+
+        addControlCommand(spans, match.captured(1), match.capturedStart(1));
+        addSpan(spans, match.capturedStart(2), match.capturedLength(2), KeywordSpan::SPAN_ControlParams);
+
+        auto cpbRow = match.captured(3);
+        if(! cpbRow.contains(';'))
+            return false;
+
+        int cpbStart = match.capturedStart(3);
+        int lastEnd = 0;
+
+        QRegularExpressionMatchIterator i = patternDeviceCommand.globalMatch(cpbRow);
+        while (i.hasNext()) {
+            QRegularExpressionMatch match = i.next();
+
+            int pos = match.capturedStart();
+            int len = match.capturedLength();
+            int cmdPos = match.capturedStart(1);
+            int paramPos = match.capturedStart(2);
+            int paramLen = match.capturedLength(2);
+
+            if(match.capturedStart() > 0) {
+
+                // One error per gap, covering whatever stands in place of the ';'.
+                if(lastEnd == pos)
+                    addError(spans, cpbStart + pos, 0, KeywordSpan::SPAN_MissingSeparator);
+                else if(lastEnd + 1 != pos || cpbRow[pos - 1] != ';')
+                    addError(spans, cpbStart + lastEnd, pos - lastEnd, KeywordSpan::SPAN_BadSeparator);
+            }
+
+            addDeviceCommand(spans, match.captured(1), cpbStart + cmdPos);
+            addSpan(spans, cpbStart + paramPos, paramLen, KeywordSpan::SPAN_DeviceParams);
+
+            lastEnd = pos + len;
+        }
+
+        return true;
+    }
+
+    return false;
+}
+
+bool KeywordScanner::matchCommandFull(const QString &line, QVector<KeywordSpan> &spans) const
+{
+    // Matches a control code plus an optional device code ...
+
+    auto match = patternCommandFull.match(line);
+    if(match.hasMatch() && match.capturedStart() == 0) {
+
+        addControlCommand(spans, match.captured(1), match.capturedStart(1));
+        addSpan(spans, match.capturedStart(2), match.capturedLength(2), KeywordSpan::SPAN_ControlParams);
+        addDeviceCommand(spans, match.captured(3), match.capturedStart(3));
+        addSpan(spans, match.capturedStart(4), match.capturedLength(4), KeywordSpan::SPAN_DeviceParams);
+
+        return true;
+    }
+    else {
+        return false;
+    }
+}
+
+bool KeywordScanner::matchCommandPartial(const QString &line, QVector<KeywordSpan> &spans) const
+{
+    // Matches a control code only ...
+
+    auto match = patternCommandPartial.match(line);
+    if(match.hasMatch() && match.capturedStart() == 0) {
+
+        addControlCommand(spans, match.captured(1), match.capturedStart(1));
+        addSpan(spans, match.capturedStart(2), match.capturedLength(2), KeywordSpan::SPAN_ControlParams);
+
+        return true;
+    }
+    else {
+        return false;
+    }
+}
+
+bool KeywordScanner::matchDeclaration(const QString &line, QVector<KeywordSpan> &spans) const
+{
+    auto match = patternDeclaration.match(line);
+    if(match.hasMatch() && match.capturedStart() == 0) {
+
+        addSpan(spans, match.capturedStart(1), match.capturedLength(1), KeywordSpan::SPAN_DeclarationKey);
+        addSpan(spans, match.capturedStart(3), match.capturedLength(3), KeywordSpan::SPAN_DeclarationValue);
+
+        return true;
+    }
+    else {
+        return false;
+    }
+}
+
+bool KeywordScanner::matchLabelTag(const QString &line, QVector<KeywordSpan> &spans) const
+{
+    // Matches a label,number ...
+
+    auto match = patternLabelTag.match(line);
+    if(match.hasMatch() && match.capturedStart() == 0) {
+
+        if(languageKeywords && ! languageKeywords->goodLabelNames.contains(match.captured(1)))
+            return false;
+
+        addSpan(spans, match.capturedStart(0), match.capturedLength(0), KeywordSpan::SPAN_LabelTag);
+
+        return true;
+    }
+    else {
+        return false;
+    }
+}
+
+} // namespace codetextedit
@@ -0,0 +1,80 @@
+/***********************************************************************
+The CodeTextEditor provides an editor showing live hints and annotations.
+
+Copyright (c) 2020 Brian Newham <seaweedsolutionsltd@gmail.com>.
+
+CodeTextEdit is free software dual licensed under the GNU LGPL or MIT License.
+***********************************************************************/
+
+#ifndef KEYWORDSCANNER_H
+#define KEYWORDSCANNER_H
+
+#include <QString>
+#include <QVector>
+#include <QRegularExpression>
+
+#include "Keywords.h"
+#include "KeywordSpan.h"
+
+namespace codetextedit {
+
+///
+/// \brief Classifies the commands, parameters, declarations and labels of a line.
+///
+/// The rules the highlighter colours by, without a document or any widgets, so the same
+/// keyword checks can run headless. Later spans win where they overlap earlier ones. Syntax
+/// errors found on the way come back as error spans, see KeywordSpan::isError(). Not thread
+/// safe, use one scanner per thread.
+///
+class KeywordScanner
+{
+public:
+    KeywordScanner();
+
+    /// Without keywords every command is unknown and every label is accepted.
+    void setKeywords(const Keywords* keywords) {languageKeywords = keywords;}
+    const Keywords* keywords() const {return languageKeywords;}
+
+    /// Appends the spans of line to spans.
+    void scan(const QString& line, QVector<KeywordSpan>& spans) const;
+
+    /// Describes an error span of line.
+    static QString errorMessage(const QString& line, const KeywordSpan& span);
+
+    /// The line's first comma separated field if its spans make it a command, else an empty
+    /// view. "XX,1" gives "XX" whether XX lexed as a control command or a label tag, "XX 1"
+    /// gives nothing as its first field is all of it.
+    static QStringRef firstCommand(const QString& line, const QVector<KeywordSpan>& spans);
+
+    /// Appends the labels line defines and refers to, found in its spans. A label tag which
+    /// starts the line defines it, a label name used as a device command with one number
+    /// refers to it, e.g. "XX,1   LABEL,3". Without keywords nothing is a label.
+    void labelSymbols(const QString& line, const QVector<KeywordSpan>& spans,
+                      QStringList& definitions, QStringList& references) const;
+
+private:
+    void addSpan(QVector<KeywordSpan>& spans, int start, int length, KeywordSpan::Kind kind) const;
+    void addError(QVector<KeywordSpan>& spans, int start, int length, KeywordSpan::Kind kind) const;
+    void addControlCommand(QVector<KeywordSpan>& spans, const QString& command, int start) const;
+    void addDeviceCommand(QVector<KeywordSpan>& spans, const QString& command, int start) const;
+
+    bool matchCommandFullMulti(const QString& line, QVector<KeywordSpan>& spans) const;
+    bool matchCommandFull(const QString& line, QVector<KeywordSpan>& spans) const;
+    bool matchCommandPartial(const QString& line, QVector<KeywordSpan>& spans) const;
+    bool matchDeclaration(const QString& line, QVector<KeywordSpan>& spans) const;
+    bool matchLabelTag(const QString& line, QVector<KeywordSpan>& spans) const;
+
+    // Compiled once instead of for every line.
+    QRegularExpression patternCommandFullMulti;
+    QRegularExpression patternDeviceCommand;
+    QRegularExpression patternCommandFull;
+    QRegularExpression patternCommandPartial;
+    QRegularExpression patternDeclaration;
+    QRegularExpression patternLabelTag;
+
+    const Keywords* languageKeywords = nullptr;
+};
+
+} // namespace codetextedit
+
+#endif // KEYWORDSCANNER_H
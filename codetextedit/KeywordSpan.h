@@ -0,0 +1,51 @@
+/***********************************************************************
+The CodeTextEditor provides an editor showing live hints and annotations.
+
+Copyright (c) 2020 Brian Newham <seaweedsolutionsltd@gmail.com>.
+
+CodeTextEdit is free software dual licensed under the GNU LGPL or MIT License.
+***********************************************************************/
+
+#ifndef KEYWORDSPAN_H
+#define KEYWORDSPAN_H
+
+#include <QVector>
+
+namespace codetextedit {
+
+///
+/// \brief A classified part of a line, the lexer's token.
+///
+struct KeywordSpan
+{
+    enum Kind
+    {
+        SPAN_DeclarationKey,
+        SPAN_DeclarationValue,
+        SPAN_ControlCommand,
+        SPAN_UnknownControlCommand,
+        SPAN_ControlParams,
+        SPAN_DeviceCommand,
+        SPAN_UnknownDeviceCommand,
+        SPAN_DeviceParams,
+        SPAN_LabelTag,
+
+        // Syntax errors, reported instead of formatted.
+        SPAN_MissingSeparator,      // Empty, where a separator belongs
+        SPAN_BadSeparator,          // What stands in place of a single ';'
+    };
+
+    int start = 0;
+    int length = 0;
+    Kind kind = SPAN_ControlParams;
+
+    bool isError() const {return kind >= SPAN_MissingSeparator;}
+};
+
+/// The tokens of a document's lines, one vector per line. Implicitly shared, so an analysis
+/// thread can keep the editor's tokens without copying them.
+using LineTokens = QVector<QVector<KeywordSpan>>;
+
+} // namespace codetextedit
+
+#endif // KEYWORDSPAN_H
@@ -0,0 +1,51 @@
+/***********************************************************************
+The CodeTextEditor provides an editor showing live hints and annotations.
+
+Copyright (c) 2020 Brian Newham <seaweedsolutionsltd@gmail.com>.
+
+CodeTextEdit is free software dual licensed under the GNU LGPL or MIT License.
+***********************************************************************/
+
+#include "Keywords.h"
+
+#include <QFile>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QJsonArray>
+
+namespace codetextedit {
+
+static QStringList stringList(const QJsonValue& value)
+{
+    QStringList list;
+    for(const QJsonValue& item : value.toArray())
+        list.append(item.toString());
+    return list;
+}
+
+bool loadKeywords(const QString &filePath, Keywords &keywords, QString *error)
+{
+    QFile file(filePath);
+    if(! file.open(QFile::ReadOnly)) {
+        if(error)
+            *error = file.errorString();
+        return false;
+    }
+
+    QJsonParseError parseError;
+    QJsonDocument document = QJsonDocument::fromJson(file.readAll(), &parseError);
+    if(! document.isObject()) {
+        if(error)
+            *error = parseError.error != QJsonParseError::NoError ? parseError.errorString() : QString("Not a JSON object");
+        return false;
+    }
+
+    QJsonObject object = document.object();
+    keywords.version = object.value("version").toString();
+    keywords.controlCommands = stringList(object.value("controlCommands"));
+    keywords.deviceCommands = stringList(object.value("deviceCommands"));
+    keywords.goodLabelNames = stringList(object.value("goodLabelNames"));
+    return true;
+}
+
+} // namespace codetextedit
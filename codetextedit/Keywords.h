@@ -0,0 +1,31 @@
+/***********************************************************************
+The CodeTextEditor provides an editor showing live hints and annotations.
+
+Copyright (c) 2020 Brian Newham <seaweedsolutionsltd@gmail.com>.
+
+CodeTextEdit is free software dual licensed under the GNU LGPL or MIT License.
+***********************************************************************/
+
+#ifndef KEYWORDS_H
+#define KEYWORDS_H
+
+#include <QString>
+#include <QStringList>
+
+namespace codetextedit {
+
+struct Keywords
+{
+    QString version;
+    QStringList controlCommands;
+    QStringList deviceCommands;
+    QStringList goodLabelNames;
+};
+
+/// Reads keywords from a JSON object with the members "version", "controlCommands",
+/// "deviceCommands" and "goodLabelNames". Returns false and sets error if it cannot.
+bool loadKeywords(const QString& filePath, Keywords& keywords, QString* error = nullptr);
+
+} // namespace codetextedit
+
+#endif // KEYWORDS_H
@@ -0,0 +1,131 @@
+/***********************************************************************
+The CodeTextEditor provides an editor showing live hints and annotations.
+
+Copyright (c) 2020 Brian Newham <seaweedsolutionsltd@gmail.com>.
+
+CodeTextEdit is free software dual licensed under the GNU LGPL or MIT License.
+***********************************************************************/
+
+#include "LineDiff.h"
+
+namespace codetextedit
+{
+
+static LineHunk replaceHunk(const QStringList& newLines, int oldStart, int oldCount, int newStart, int newCount)
+{
+    LineHunk hunk;
+    hunk.oldStart = oldStart;
+    hunk.oldCount = oldCount;
+    hunk.newStart = newStart;
+    hunk.lines = newLines.mid(newStart, newCount);
+    return hunk;
+}
+
+QVector<LineHunk> diffLines(const QStringList &oldLines, const QStringList &newLines, int maxEdits)
+{
+    QVector<LineHunk> hunks;
+
+    int prefix = 0;
+    int oldEnd = oldLines.size();
+    int newEnd = newLines.size();
+    while(prefix < oldEnd && prefix < newEnd && oldLines[prefix] == newLines[prefix])
+        ++ prefix;
+    while(oldEnd > prefix && newEnd > prefix && oldLines[oldEnd - 1] == newLines[newEnd - 1]) {
+        -- oldEnd;
+        -- newEnd;
+    }
+
+    const int n = oldEnd - prefix;
+    const int m = newEnd - prefix;
+    if(n == 0 && m == 0)
+        return hunks;
+    if(n == 0 || m == 0) {
+        hunks.append(replaceHunk(newLines, prefix, n, prefix, m));
+        return hunks;
+    }
+
+    auto a = [&](int i) -> const QString& {return oldLines[prefix + i];};
+    auto b = [&](int j) -> const QString& {return newLines[prefix + j];};
+
+    // trace[d] holds the furthest x on each diagonal k in [-d, d] after d edits, which
+    // keeps the memory at O(D^2).
+    const int limit = qMin(n + m, maxEdits);
+    QVector<QVector<int>> trace;
+    QVector<int> v(2 * limit + 3, 0);
+    const int offset = limit + 1;
+    int edits = -1;
+
+    for(int d = 0; d <= limit && edits == -1; ++d) {
+        for(int k = -d; k <= d; k += 2) {
+            int x;
+            if(k == -d || (k != d && v[offset + k - 1] < v[offset + k + 1]))
+                x = v[offset + k + 1];
+            else
+                x = v[offset + k - 1] + 1;
+            int y = x - k;
+            while(x < n && y < m && a(x) == b(y)) {
+                ++ x;
+                ++ y;
+            }
+            v[offset + k] = x;
+            if(x >= n && y >= m) {
+                edits = d;
+                break;
+            }
+        }
+        trace.append(v.mid(offset - d, 2 * d + 1));
+    }
+
+    if(edits == -1) {
+        hunks.append(replaceHunk(newLines, prefix, n, prefix, m));
+        return hunks;
+    }
+
+    // Walks back through the trace marking the lines that were deleted or inserted.
+    QVector<bool> deleted(n, false);
+    QVector<bool> inserted(m, false);
+    int x = n, y = m;
+    for(int d = edits; d > 0; --d) {
+        const QVector<int>& previous = trace[d - 1];
+        auto at = [&](int k) {return previous[k + d - 1];};
+
+        int k = x - y;
+        int previousK = (k == -d || (k != d && at(k - 1) < at(k + 1))) ? k + 1 : k - 1;
+        int previousX = at(previousK);
+        int previousY = previousX - previousK;
+
+        while(x > previousX && y > previousY) {
+            -- x;
+            -- y;
+        }
+        if(previousK == k + 1)
+            inserted[previousY] = true;
+        else
+            deleted[previousX] = true;
+        x = previousX;
+        y = previousY;
+    }
+
+    // Matched lines pair up in order, everything between two matches is one hunk.
+    int i = 0, j = 0;
+    while(i < n || j < m) {
+        if(i < n && j < m && ! deleted[i] && ! inserted[j]) {
+            ++ i;
+            ++ j;
+            continue;
+        }
+
+        int startI = i, startJ = j;
+        while((i < n && deleted[i]) || (j < m && inserted[j])) {
+            while(i < n && deleted[i])
+                ++ i;
+            while(j < m && inserted[j])
+                ++ j;
+        }
+        hunks.append(replaceHunk(newLines, prefix + startI, i - startI, prefix + startJ, j - startJ));
+    }
+
+    return hunks;
+}
+
+} // namespace codetextedit
@@ -0,0 +1,41 @@
+/***********************************************************************
+The CodeTextEditor provides an editor showing live hints and annotations.
+
+Copyright (c) 2020 Brian Newham <seaweedsolutionsltd@gmail.com>.
+
+CodeTextEdit is free software dual licensed under the GNU LGPL or MIT License.
+***********************************************************************/
+
+#ifndef LINEDIFF_H
+#define LINEDIFF_H
+
+#include <QStringList>
+#include <QVector>
+
+namespace codetextedit
+{
+    ///
+    /// \brief Replaces oldCount lines from oldStart with lines, which start at newStart in
+    /// the new text.
+    ///
+    struct LineHunk
+    {
+        int         oldStart = 0;
+        int         oldCount = 0;
+        int         newStart = 0;
+        QStringList lines;
+    };
+
+    ///
+    /// \brief Hunks turning oldLines into newLines, in ascending order.
+    ///
+    /// Common leading and trailing lines are skipped, the rest is diffed with Myers' O(ND)
+    /// algorithm. Its trace takes O(maxEdits^2) memory, so the limit stays small: past
+    /// maxEdits insertions and deletions the differing lines are replaced as one hunk,
+    /// which amounts to reloading them.
+    ///
+    QVector<LineHunk> diffLines(const QStringList& oldLines, const QStringList& newLines, int maxEdits = 500);
+
+} // namespace codetextedit
+
+#endif // LINEDIFF_H
@@ -0,0 +1,172 @@
+/***********************************************************************
+The CodeTextEditor provides an editor showing live hints and annotations.
+
+Copyright (c) 2020 Brian Newham <seaweedsolutionsltd@gmail.com>.
+
+CodeTextEdit is free software dual licensed under the GNU LGPL or MIT License.
+***********************************************************************/
+
+#include "LineIndex.h"
+
+#include <QtAlgorithms>
+
+#if defined(__AVX2__)
+#  include <immintrin.h>
+#  define CODETEXTEDIT_AVX2
+#endif
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#  include <emmintrin.h>
+#  define CODETEXTEDIT_SSE2
+#endif
+
+namespace codetextedit
+{
+
+// Calls found(offset) for each code unit equal to c in text[from, length), in order, and
+// stops early when it returns false. Returns where it stopped.
+template<typename Found>
+static qint64 scanUtf16(const ushort* text, qint64 length, qint64 from, ushort c, Found found)
+{
+    qint64 pos = from;
+
+#if defined(CODETEXTEDIT_AVX2)
+    const __m256i wanted = _mm256_set1_epi16(short(c));
+    for(; pos + 16 <= length; pos += 16) {
+        __m256i block = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(text + pos));
+        // Two mask bits per UTF-16 code unit.
+        uint mask = uint(_mm256_movemask_epi8(_mm256_cmpeq_epi16(block, wanted)));
+        while(mask != 0) {
+            int bit = int(qCountTrailingZeroBits(mask));
+            if(! found(pos + bit / 2))
+                return pos + bit / 2;
+            mask &= ~(3u << bit);
+        }
+    }
+#elif defined(CODETEXTEDIT_SSE2)
+    const __m128i wanted = _mm_set1_epi16(short(c));
+    for(; pos + 8 <= length; pos += 8) {
+        __m128i block = _mm_loadu_si128(reinterpret_cast<const __m128i*>(text + pos));
+        uint mask = uint(_mm_movemask_epi8(_mm_cmpeq_epi16(block, wanted)));
+        while(mask != 0) {
+            int bit = int(qCountTrailingZeroBits(mask));
+            if(! found(pos + bit / 2))
+                return pos + bit / 2;
+            mask &= ~(3u << bit);
+        }
+    }
+#endif
+
+    for(; pos < length; ++pos) {
+        if(text[pos] == c && ! found(pos))
+            return pos;
+    }
+    return length;
+}
+
+template<typename Found>
+static qint64 scanBytes(const uchar* data, qint64 length, qint64 from, uchar c, Found found)
+{
+    qint64 pos = from;
+
+#if defined(CODETEXTEDIT_AVX2)
+    const __m256i wanted = _mm256_set1_epi8(char(c));
+    for(; pos + 32 <= length; pos += 32) {
+        __m256i block = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + pos));
+        uint mask = uint(_mm256_movemask_epi8(_mm256_cmpeq_epi8(block, wanted)));
+        while(mask != 0) {
+            int bit = int(qCountTrailingZeroBits(mask));
+            if(! found(pos + bit))
+                return pos + bit;
+            mask &= mask - 1;
+        }
+    }
+#elif defined(CODETEXTEDIT_SSE2)
+    const __m128i wanted = _mm_set1_epi8(char(c));
+    for(; pos + 16 <= length; pos += 16) {
+        __m128i block = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + pos));
+        uint mask = uint(_mm_movemask_epi8(_mm_cmpeq_epi8(block, wanted)));
+        while(mask != 0) {
+            int bit = int(qCountTrailingZeroBits(mask));
+            if(! found(pos + bit))
+                return pos + bit;
+            mask &= mask - 1;
+        }
+    }
+#endif
+
+    for(; pos < length; ++pos) {
+        if(data[pos] == c && ! found(pos))
+            return pos;
+    }
+    return length;
+}
+
+int indexOfChar(const QChar *text, int length, int from, QChar c)
+{
+    if(from < 0 || from >= length)
+        return -1;
+
+    qint64 pos = scanUtf16(reinterpret_cast<const ushort*>(text), length, from, c.unicode(), [](qint64) {return false;});
+    return pos < length ? int(pos) : -1;
+}
+
+QStringRef firstField(const QString &line, QChar separator)
+{
+    int end = indexOfChar(line.constData(), line.size(), 0, separator);
+    return line.leftRef(end);
+}
+
+void splitFields(const QString &line, QChar separator, QVector<QStringRef> &fields)
+{
+    fields.resize(0);
+
+    int start = 0;
+    scanUtf16(reinterpret_cast<const ushort*>(line.constData()), line.size(), 0, separator.unicode(), [&](qint64 pos) {
+        fields.append(line.midRef(start, int(pos) - start));
+        start = int(pos) + 1;
+        return true;
+    });
+    fields.append(line.midRef(start));
+}
+
+void LineIndex::build(const QChar *text, qint64 length)
+{
+    m_starts.resize(0);
+    m_starts.append(0);
+    scanUtf16(reinterpret_cast<const ushort*>(text), length, 0, '\n', [this](qint64 pos) {
+        m_starts.append(pos + 1);
+        return true;
+    });
+    m_starts.append(length + 1);
+}
+
+void LineIndex::build(const char *data, qint64 length)
+{
+    m_starts.resize(0);
+    m_starts.append(0);
+    scanBytes(reinterpret_cast<const uchar*>(data), length, 0, '\n', [this](qint64 pos) {
+        m_starts.append(pos + 1);
+        return true;
+    });
+    m_starts.append(length + 1);
+}
+
+QStringRef LineIndex::line(const QString &text, int line) const
+{
+    int start = int(lineStart(line));
+    int end = int(lineEnd(line));
+    if(end > start && text.at(end - 1) == '\r')
+        -- end;
+    return text.midRef(start, end - start);
+}
+
+QStringList LineIndex::lines(const QString &text) const
+{
+    QStringList result;
+    result.reserve(lineCount());
+    for(int i = 0; i < lineCount(); ++i)
+        result.append(line(text, i).toString());
+    return result;
+}
+
+} // namespace codetextedit
@@ -0,0 +1,67 @@
+/***********************************************************************
+The CodeTextEditor provides an editor showing live hints and annotations.
+
+Copyright (c) 2020 Brian Newham <seaweedsolutionsltd@gmail.com>.
+
+CodeTextEdit is free software dual licensed under the GNU LGPL or MIT License.
+***********************************************************************/
+
+#ifndef LINEINDEX_H
+#define LINEINDEX_H
+
+#include <QChar>
+#include <QString>
+#include <QStringList>
+#include <QStringRef>
+#include <QVector>
+
+namespace codetextedit
+{
+    /// Position of the first c in text[from, length), -1 if none.
+    int indexOfChar(const QChar* text, int length, int from, QChar c);
+
+    /// The text of line before the first separator, all of it if there is none.
+    QStringRef firstField(const QString& line, QChar separator);
+
+    /// Splits line at every separator like QString::split(), into views of line. Reuses the
+    /// storage of fields, so a caller keeping the vector allocates nothing per line.
+    void splitFields(const QString& line, QChar separator, QVector<QStringRef>& fields);
+
+    ///
+    /// \brief Start offsets of the lines of a UTF-16 or UTF-8 buffer.
+    ///
+    /// Lines are separated by '\n' as QString::split('\n') separates them, a '\r' before the
+    /// '\n' is left to the views. Newlines are found 16 or 32 code units at a time with SSE2 or
+    /// AVX2, whichever the build targets, other targets use the scalar loop. UTF-8 needs no
+    /// decoding for it: a '\n' byte is never part of a multi-byte sequence. Offsets are 64 bit,
+    /// so a memory mapped file of several GB can be indexed without copying it.
+    ///
+    class LineIndex
+    {
+    public:
+        LineIndex() {}
+
+        /// Indexes UTF-16 text, e.g. a QString's data.
+        void build(const QChar* text, qint64 length);
+        /// Indexes UTF-8 or ASCII bytes, e.g. a mapped file.
+        void build(const char* data, qint64 length);
+
+        /// Never 0 once built: text without a newline is one line.
+        int lineCount() const {return m_starts.size() - 1;}
+        qint64 lineStart(int line) const {return m_starts[line];}
+        /// Offset just after the line's text, where its '\n' is if it has one.
+        qint64 lineEnd(int line) const {return m_starts[line + 1] - 1;}
+
+        /// A view of the line in the indexed text, without a trailing '\r'.
+        QStringRef line(const QString& text, int line) const;
+        /// Copies of every line, without trailing '\r's, for an Annotator.
+        QStringList lines(const QString& text) const;
+
+    private:
+        // One entry per line plus one past the end, so every line has a next start.
+        QVector<qint64>     m_starts;
+    };
+
+} // namespace codetextedit
+
+#endif // LINEINDEX_H
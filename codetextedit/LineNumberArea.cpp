@@ -0,0 +1,145 @@
+/***********************************************************************
+The CodeTextEditor provides an editor showing live hints and annotations.
+
+Copyright (c) 2020 Brian Newham <seaweedsolutionsltd@gmail.com>.
+
+CodeTextEdit is free software dual licensed under the GNU LGPL or MIT License.
+***********************************************************************/
+
+#include "LineNumberArea.h"
+#include "AnnotationTextEdit.h"
+
+#include <QPainter>
+#include <QPaintEvent>
+#include <QMouseEvent>
+#include <QPolygonF>
+#include <QScrollBar>
+#include <QFontMetrics>
+#include <QTextDocument>
+#include <QTextBlock>
+
+LineNumberArea::LineNumberArea(AnnotationTextEdit *edit)
+    : QWidget(edit)
+    , m_edit(edit)
+{
+    updateMetrics();
+    setLineCount(edit->document()->blockCount());
+}
+
+int LineNumberArea::areaWidth() const
+{
+    return 2 * padding + m_markerWidth + m_digits * m_digitWidth;
+}
+
+void LineNumberArea::setLineCount(int count)
+{
+    // Only a new digit changes the width, so most line count changes are a repaint.
+    int digits = minDigits;
+    for (qint64 limit = 100; count >= limit; limit *= 10)
+        ++ digits;
+
+    if (digits != m_digits)
+    {
+        m_digits = digits;
+        emit widthChanged(areaWidth());
+    }
+    update();
+}
+
+void LineNumberArea::changeEvent(QEvent *event)
+{
+    // The font comes from the editor.
+    if (event->type() == QEvent::FontChange)
+    {
+        updateMetrics();
+        emit widthChanged(areaWidth());
+        update();
+    }
+    QWidget::changeEvent(event);
+}
+
+void LineNumberArea::updateMetrics()
+{
+    QFontMetrics metrics(font());
+    m_digitWidth = 0;
+    for (char digit = '0'; digit <= '9'; ++digit)
+        m_digitWidth = qMax(m_digitWidth, metrics.horizontalAdvance(QLatin1Char(digit)));
+    m_digitHeight = metrics.height();
+    m_digitAscent = metrics.ascent();
+    m_markerWidth = metrics.ascent() / 2 + padding;
+    m_atlas = QPixmap();
+}
+
+void LineNumberArea::buildAtlas()
+{
+    m_atlasRatio = devicePixelRatioF();
+    m_atlas = QPixmap(QSize(10 * m_digitWidth, m_digitHeight) * m_atlasRatio);
+    m_atlas.setDevicePixelRatio(m_atlasRatio);
+    m_atlas.fill(Qt::transparent);
+
+    QPainter painter(&m_atlas);
+    painter.setFont(font());
+    painter.setPen(m_color);
+    for (int digit = 0; digit < 10; ++digit)
+        painter.drawText(QPointF(digit * m_digitWidth, m_digitAscent), QString(QChar('0' + digit)));
+}
+
+void LineNumberArea::mousePressEvent(QMouseEvent *event)
+{
+    int block = m_edit->blockAt(event->pos().y() + m_edit->verticalScrollBar()->value());
+    if (block != -1)
+        emit lineClicked(block);
+    QWidget::mousePressEvent(event);
+}
+
+void LineNumberArea::paintEvent(QPaintEvent *event)
+{
+    QPainter painter(this);
+    painter.fillRect(event->rect(), m_background);
+
+    if (m_atlas.isNull() || !qFuzzyCompare(m_atlasRatio, devicePixelRatioF()))
+        buildAtlas();
+
+    // Rows are found in the editor's height index, hidden blocks have no height and are
+    // skipped by blockAt(), so only the rows repainted are visited.
+    int scroll = m_edit->verticalScrollBar()->value();
+    qreal y = event->rect().top() + scroll;
+    qreal bottom = event->rect().bottom() + 1 + scroll;
+    int ascent = m_edit->ascent() > 0 ? m_edit->ascent() : m_digitAscent;
+    QTextDocument* document = m_edit->document();
+    painter.setRenderHint(QPainter::Antialiasing, true);
+
+    while (y < bottom)
+    {
+        int block = m_edit->blockAt(y);
+        qreal end = m_edit->blockTop(block + 1);
+        if (block < 0 || end <= y)
+            break;
+
+        // On the baseline of the block's first line, right aligned.
+        qreal glyphTop = m_edit->blockTop(block) - scroll + ascent - m_digitAscent;
+
+        // A block followed by hidden ones heads a fold.
+        QTextBlock next = document->findBlockByNumber(block + 1);
+        if (next.isValid() && !next.isVisible())
+        {
+            qreal size = m_markerWidth - padding;
+            qreal top = glyphTop + (m_digitHeight - size) / 2;
+            QPolygonF marker;
+            marker << QPointF(padding, top) << QPointF(padding + size, top + size / 2) << QPointF(padding, top + size);
+            painter.setPen(Qt::NoPen);
+            painter.setBrush(m_color);
+            painter.drawPolygon(marker);
+        }
+
+        int x = width() - padding;
+        for (int number = block + 1; number > 0; number /= 10)
+        {
+            x -= m_digitWidth;
+            int digit = number % 10;
+            painter.drawPixmap(QRectF(x, glyphTop, m_digitWidth, m_digitHeight), m_atlas,
+                               QRectF(digit * m_digitWidth * m_atlasRatio, 0, m_digitWidth * m_atlasRatio, m_digitHeight * m_atlasRatio));
+        }
+        y = end;
+    }
+}
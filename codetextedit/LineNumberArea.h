@@ -0,0 +1,68 @@
+/***********************************************************************
+The CodeTextEditor provides an editor showing live hints and annotations.
+
+Copyright (c) 2020 Brian Newham <seaweedsolutionsltd@gmail.com>.
+
+CodeTextEdit is free software dual licensed under the GNU LGPL or MIT License.
+***********************************************************************/
+
+#ifndef LINENUMBERAREA_H
+#define LINENUMBERAREA_H
+
+#include <QWidget>
+#include <QPixmap>
+#include <QColor>
+
+class AnnotationTextEdit;
+
+///
+/// \brief Margin left of an AnnotationTextEdit showing the line numbers.
+///
+/// Only the lines on screen are painted, each found from the editor's block height index,
+/// so a repaint costs the same for any document size. Digits are drawn from a pixmap
+/// rendered once per font, not shaped as text every time. Folded lines get a marker,
+/// clicking a line number reports the line, e.g. to fold it.
+///
+class LineNumberArea : public QWidget
+{
+    Q_OBJECT
+
+public:
+    LineNumberArea(AnnotationTextEdit* edit);
+
+    /// Width for the current line count, changes only when it gains or loses a digit.
+    int areaWidth() const;
+    QSize sizeHint() const override {return QSize(areaWidth(), 0);}
+
+public slots:
+    void setLineCount(int count);
+
+signals:
+    void widthChanged(int width);
+    void lineClicked(int blockNumber);
+
+protected:
+    void paintEvent(QPaintEvent* event) override;
+    void changeEvent(QEvent* event) override;
+    void mousePressEvent(QMouseEvent* event) override;
+
+private:
+    void updateMetrics();
+    void buildAtlas();
+
+    AnnotationTextEdit* m_edit;
+    int         m_digits = 1;
+    QPixmap     m_atlas;            // '0' to '9' side by side, m_digitWidth apart
+    qreal       m_atlasRatio = 0;   // Device pixel ratio the atlas was rendered for
+    int         m_digitWidth = 0;
+    int         m_digitHeight = 0;
+    int         m_digitAscent = 0;
+    int         m_markerWidth = 0;     // Column left of the digits for fold markers
+    QColor      m_color = QColor(0x80, 0x80, 0x80);
+    QColor      m_background = QColor(0xF0, 0xF0, 0xF0);
+
+    static const int padding = 4;
+    static const int minDigits = 2;
+};
+
+#endif // LINENUMBERAREA_H
@@ -0,0 +1,272 @@
+/***********************************************************************
+The CodeTextEditor provides an editor showing live hints and annotations.
+
+Copyright (c) 2020 Brian Newham <seaweedsolutionsltd@gmail.com>.
+
+CodeTextEdit is free software dual licensed under the GNU LGPL or MIT License.
+***********************************************************************/
+
+#include "LintEngine.h"
+#include "KeywordScanner.h"
+#include "LineIndex.h"
+
+#include <QFile>
+#include <QRunnable>
+#include <QMetaObject>
+#include <QHash>
+
+#include <algorithm>
+
+namespace codetextedit
+{
+
+///
+/// \brief Lints one file on a pool thread and hands the result to the engine's thread.
+///
+class LintTask : public QRunnable
+{
+public:
+    LintTask(LintEngine* engine, const QString& filePath)
+        : m_engine(engine), m_filePath(filePath) {}
+
+    void run() override
+    {
+        LintFileResult result;
+        result.filePath = m_filePath;
+
+        // Files still queued when the run is cancelled only report back.
+        bool skipped = m_engine->m_cancelled.loadAcquire() != 0;
+        if(! skipped) {
+            Annotator* annotator = m_engine->m_factory->createAnnotator();
+            result = LintEngine::lintFile(m_filePath, annotator, m_engine->m_keywords);
+            if(annotator != nullptr) {
+                annotator->analysisThreadFinished();
+                delete annotator;
+            }
+        }
+
+        LintEngine* engine = m_engine;
+        QMetaObject::invokeMethod(engine, [engine, result, skipped]() {
+            engine->fileFinished(result, skipped);
+        }, Qt::QueuedConnection);
+    }
+
+private:
+    LintEngine* m_engine;
+    QString     m_filePath;
+};
+
+LintEngine::LintEngine(AnnotatorFactory *factory, QObject *parent)
+    : QObject(parent)
+    , m_factory(factory)
+{
+}
+
+LintEngine::~LintEngine()
+{
+    m_cancelled.storeRelease(1);
+    m_pool.clear();
+    m_pool.waitForDone();
+}
+
+void LintEngine::setJobs(int jobs)
+{
+    m_pool.setMaxThreadCount(qMax(jobs, 1));
+}
+
+bool LintEngine::lint(const QStringList &filePaths)
+{
+    if(m_pending > 0)
+        return false;
+
+    m_summary = LintSummary();
+    m_cancelled.storeRelease(0);
+    m_pending = filePaths.size();
+    m_timer.start();
+
+    if(filePaths.isEmpty()) {
+        QMetaObject::invokeMethod(this, [this]() {emit finished(m_summary);}, Qt::QueuedConnection);
+        return true;
+    }
+
+    for(const QString& filePath : filePaths)
+        m_pool.start(new LintTask(this, filePath));
+    return true;
+}
+
+void LintEngine::cancel()
+{
+    m_cancelled.storeRelease(1);
+}
+
+void LintEngine::fileFinished(const LintFileResult &result, bool skipped)
+{
+    if(! skipped) {
+        ++ m_summary.files;
+        if(! result.readOk)
+            ++ m_summary.failedFiles;
+        m_summary.lines += result.lineCount;
+        m_summary.bytes += result.bytes;
+        m_summary.cpuNsecs += result.nsecs;
+        for(const LintDiagnostic& diagnostic : result.diagnostics)
+            ++ m_summary.diagnostics[diagnostic.category];
+
+        emit fileLinted(result);
+    }
+
+    if(-- m_pending == 0) {
+        m_summary.wallNsecs = m_timer.nsecsElapsed();
+        emit finished(m_summary);
+    }
+}
+
+static void addKeywordDiagnostics(const KeywordScanner& scanner, const QString& line, LineNumber lineNumber,
+                                  const QVector<KeywordSpan>& spans, QVector<LintDiagnostic>& diagnostics)
+{
+    // Later spans overwrite earlier ones in the highlighter, so only the last one at a position counts.
+    // Unknown commands are only reported against a keywords file, syntax errors always.
+    for(int i = 0; i < spans.size(); ++i) {
+        const KeywordSpan& span = spans[i];
+        if(span.isError()) {
+            LintDiagnostic diagnostic;
+            diagnostic.line = lineNumber;
+            diagnostic.column = span.start;
+            diagnostic.category = Annotation::CATEGORY_Error;
+            diagnostic.message = KeywordScanner::errorMessage(line, span);
+            diagnostics.append(diagnostic);
+            continue;
+        }
+
+        if(scanner.keywords() == nullptr)
+            continue;
+        if(span.kind != KeywordSpan::SPAN_UnknownControlCommand && span.kind != KeywordSpan::SPAN_UnknownDeviceCommand)
+            continue;
+
+        bool overwritten = false;
+        for(int j = i + 1; j < spans.size() && ! overwritten; ++j)
+            overwritten = spans[j].start == span.start;
+        if(overwritten)
+            continue;
+
+        LintDiagnostic diagnostic;
+        diagnostic.line = lineNumber;
+        diagnostic.column = span.start;
+        diagnostic.category = Annotation::CATEGORY_Error;
+        diagnostic.message = QString(span.kind == KeywordSpan::SPAN_UnknownControlCommand ? "Unknown control command '%1'" : "Unknown device command '%1'")
+                .arg(line.mid(span.start, span.length));
+        diagnostics.append(diagnostic);
+    }
+}
+
+LintFileResult LintEngine::lintFile(const QString &filePath, Annotator *annotator, const Keywords *keywords)
+{
+    QElapsedTimer timer;
+    timer.start();
+
+    LintFileResult result;
+    result.filePath = filePath;
+
+    QFile file(filePath);
+    if(! file.open(QFile::ReadOnly)) {
+        result.error = file.errorString();
+        result.nsecs = timer.nsecsElapsed();
+        return result;
+    }
+
+    QByteArray content = file.readAll();
+    result.readOk = true;
+    result.bytes = content.size();
+
+    // Split like the editor splits a loaded file into blocks.
+    QString text = QString::fromUtf8(content);
+    LineIndex index;
+    index.build(text.constData(), text.size());
+    QStringList lines = index.lines(text);
+    result.lineCount = lines.size();
+
+    // Lexed once, for the keyword checks and the annotator.
+    KeywordScanner scanner;
+    scanner.setKeywords(keywords);
+    LineTokens tokens(lines.size());
+    for(LineNumber lineNumber = 0; lineNumber < lines.size(); ++lineNumber)
+        scanner.scan(lines[lineNumber], tokens[lineNumber]);
+
+    AnnotationMap annotations;
+    if(annotator != nullptr) {
+        annotator->prepareAnalysis(lines, tokens);
+
+        QVector<AnnotationContainer> batch(lines.size());
+        if(annotator->analyzeRange(0, lines.size(), batch.data())) {
+            for(int i = 0; i < batch.size(); ++i) {
+                if(! batch[i].isEmpty())
+                    annotations.insert(i, batch[i]);
+            }
+        }
+        else {
+            while(annotator->analyzeStep()) {}
+            annotations = annotator->analysisResult();
+        }
+    }
+
+    // Labels are checked against the whole file once every line has been seen.
+    QVector<QPair<LineNumber, QString>> definitions, references;
+    QHash<QString, int> definitionCounts;
+    QStringList lineDefinitions, lineReferences;
+
+    for(LineNumber lineNumber = 0; lineNumber < lines.size(); ++lineNumber) {
+        addKeywordDiagnostics(scanner, lines[lineNumber], lineNumber, tokens[lineNumber], result.diagnostics);
+
+        lineDefinitions.clear();
+        lineReferences.clear();
+        scanner.labelSymbols(lines[lineNumber], tokens[lineNumber], lineDefinitions, lineReferences);
+        lineDefinitions.removeDuplicates();
+        lineReferences.removeDuplicates();
+        for(const QString& label : lineDefinitions) {
+            definitions.append(qMakePair(lineNumber, label));
+            ++ definitionCounts[label];
+        }
+        for(const QString& label : lineReferences)
+            references.append(qMakePair(lineNumber, label));
+
+        auto it = annotations.constFind(lineNumber);
+        if(it == annotations.constEnd())
+            continue;
+
+        for(const Annotation* annotation : it.value()) {
+            LintDiagnostic diagnostic;
+            diagnostic.line = lineNumber;
+            diagnostic.category = annotation->category();
+            diagnostic.message = annotation->message();
+            diagnostic.helpKey = annotation->helpKey();
+            result.diagnostics.append(diagnostic);
+        }
+    }
+
+    for(auto it = annotations.constBegin(); it != annotations.constEnd(); ++it)
+        qDeleteAll(it.value());
+
+    auto addLabelDiagnostic = [&result, &lines](LineNumber line, const QString& label, const QString& message) {
+        LintDiagnostic diagnostic;
+        diagnostic.line = line;
+        diagnostic.column = qMax(0, lines[line].indexOf(label));
+        diagnostic.category = Annotation::CATEGORY_Error;
+        diagnostic.message = message;
+        result.diagnostics.append(diagnostic);
+    };
+    for(const auto& definition : definitions) {
+        int count = definitionCounts.value(definition.second);
+        if(count > 1)
+            addLabelDiagnostic(definition.first, definition.second, QString("Label '%1' is defined %2 times").arg(definition.second).arg(count));
+    }
+    for(const auto& reference : references) {
+        if(! definitionCounts.contains(reference.second))
+            addLabelDiagnostic(reference.first, reference.second, QString("Label '%1' is not defined").arg(reference.second));
+    }
+    std::stable_sort(result.diagnostics.begin(), result.diagnostics.end(),
+                     [](const LintDiagnostic& a, const LintDiagnostic& b) {return a.line < b.line;});
+
+    result.nsecs = timer.nsecsElapsed();
+    return result;
+}
+
+} // namespace codetextedit
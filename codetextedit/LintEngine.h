@@ -0,0 +1,125 @@
+/***********************************************************************
+The CodeTextEditor provides an editor showing live hints and annotations.
+
+Copyright (c) 2020 Brian Newham <seaweedsolutionsltd@gmail.com>.
+
+CodeTextEdit is free software dual licensed under the GNU LGPL or MIT License.
+***********************************************************************/
+
+#ifndef LINTENGINE_H
+#define LINTENGINE_H
+
+#include <QObject>
+#include <QString>
+#include <QStringList>
+#include <QVector>
+#include <QThreadPool>
+#include <QElapsedTimer>
+#include <QAtomicInt>
+
+#include "Annotation.h"
+#include "Keywords.h"
+
+namespace codetextedit
+{
+    ///
+    /// \brief Creates the annotators a LintEngine runs, one per file.
+    ///
+    /// Called from the engine's pool threads, so it must be thread safe.
+    ///
+    class AnnotatorFactory
+    {
+    public:
+        virtual ~AnnotatorFactory() {}
+
+        /// The caller owns the annotator.
+        virtual Annotator* createAnnotator() = 0;
+    };
+
+    struct LintDiagnostic
+    {
+        LineNumber              line = 0;       // From 0
+        int                     column = 0;     // From 0
+        Annotation::Category    category = Annotation::CATEGORY_Unspecified;
+        QString                 message;
+        QString                 helpKey;
+    };
+
+    struct LintFileResult
+    {
+        QString                 filePath;
+        bool                    readOk = false;
+        QString                 error;
+        int                     lineCount = 0;
+        qint64                  bytes = 0;
+        qint64                  nsecs = 0;      // Reading and analyzing the file
+        QVector<LintDiagnostic> diagnostics;    // In line order
+    };
+
+    struct LintSummary
+    {
+        static const int categoryCount = Annotation::CATEGORY_Error + 1;
+
+        int                     files = 0;
+        int                     failedFiles = 0;
+        qint64                  lines = 0;
+        qint64                  bytes = 0;
+        int                     diagnostics[categoryCount] = {};
+        qint64                  wallNsecs = 0;
+        qint64                  cpuNsecs = 0;   // Sum over the files
+    };
+
+    ///
+    /// \brief Runs an annotator and the keyword checks over files, without any widgets.
+    ///
+    /// Files are spread over a thread pool, each one read and analyzed by a single job with
+    /// its own annotator. Results are reported on the engine's thread as each file finishes,
+    /// so the order follows completion, not the input.
+    ///
+    class LintEngine : public QObject
+    {
+        Q_OBJECT
+
+    public:
+        LintEngine(AnnotatorFactory* factory, QObject* parent = nullptr);
+        ~LintEngine() override;
+
+        /// Unknown commands are reported as errors. Without keywords they are not checked,
+        /// separator errors are reported either way. With keywords, label definitions and
+        /// references are checked across the file: duplicates and undefined labels are errors.
+        void setKeywords(const Keywords* keywords) {m_keywords = keywords;}
+
+        /// Files analyzed at the same time, the number of cores by default.
+        void setJobs(int jobs);
+        int jobs() const {return m_pool.maxThreadCount();}
+
+        /// Queues the files. Does nothing while a run is in progress, returns false then.
+        bool lint(const QStringList& filePaths);
+        /// Drops the files not started yet, finished() follows once the running ones end.
+        void cancel();
+        bool isRunning() const {return m_pending > 0;}
+
+        /// Reads and analyzes one file on the calling thread.
+        static LintFileResult lintFile(const QString& filePath, Annotator* annotator, const Keywords* keywords);
+
+    signals:
+        void fileLinted(const codetextedit::LintFileResult& result);
+        void finished(const codetextedit::LintSummary& summary);
+
+    private:
+        void fileFinished(const LintFileResult& result, bool skipped);
+
+        AnnotatorFactory*   m_factory;
+        const Keywords*     m_keywords = nullptr;
+        QThreadPool         m_pool;
+        int                 m_pending = 0;      // Files queued or running
+        QAtomicInt          m_cancelled;
+        LintSummary         m_summary;
+        QElapsedTimer       m_timer;
+
+        friend class LintTask;
+    };
+
+} // namespace codetextedit
+
+#endif // LINTENGINE_H
@@ -0,0 +1,124 @@
+/***********************************************************************
+The CodeTextEditor provides an editor showing live hints and annotations.
+
+Copyright (c) 2020 Brian Newham <seaweedsolutionsltd@gmail.com>.
+
+CodeTextEdit is free software dual licensed under the GNU LGPL or MIT License.
+***********************************************************************/
+
+#include "PatternAutomaton.h"
+
+#include <QByteArray>
+
+#include <cstring>
+
+namespace codetextedit
+{
+
+PatternAutomaton::PatternAutomaton(Qt::CaseSensitivity cs)
+    : m_cs(cs)
+{
+    std::memset(m_classes, 0, sizeof(m_classes));
+    build();
+}
+
+int PatternAutomaton::addPattern(const QString &pattern)
+{
+    if(pattern.isEmpty())
+        return -1;
+
+    QByteArray bytes;
+    bytes.reserve(pattern.size());
+    for(QChar c : pattern) {
+        if(c.unicode() >= 128)
+            return -1;
+        bytes.append(char(c.unicode()));
+    }
+
+    m_patterns.append(bytes);
+    return m_patterns.size() - 1;
+}
+
+void PatternAutomaton::build()
+{
+    // Both cases of a letter share a class when matching is case insensitive.
+    std::memset(m_classes, 0, sizeof(m_classes));
+    m_classCount = 1;
+    for(const QByteArray& pattern : m_patterns) {
+        for(char c : pattern) {
+            uchar u = uchar(c);
+            if(m_classes[u] != 0)
+                continue;
+            m_classes[u] = quint8(m_classCount);
+            if(m_cs == Qt::CaseInsensitive && QChar::isLetter(u)) {
+                m_classes[uchar(QChar::toLower(uint(u)))] = quint8(m_classCount);
+                m_classes[uchar(QChar::toUpper(uint(u)))] = quint8(m_classCount);
+            }
+            ++ m_classCount;
+        }
+    }
+
+    // The trie, with -1 for a missing edge.
+    m_next.fill(-1, m_classCount);
+    QVector<QVector<int>> ownOutputs(1);
+    for(int id = 0; id < m_patterns.size(); ++id) {
+        int state = 0;
+        for(char c : m_patterns[id]) {
+            int& edge = m_next[state * m_classCount + m_classes[uchar(c)]];
+            if(edge == -1) {
+                edge = ownOutputs.size();
+                ownOutputs.append(QVector<int>());
+                m_next.insert(m_next.size(), m_classCount, -1);
+            }
+            state = m_next[state * m_classCount + m_classes[uchar(c)]];
+        }
+        ownOutputs[state].append(id);
+    }
+
+    // Breadth first, a state's failure state is complete before the state is. Missing edges
+    // take the failure state's edge, which turns the trie into the full automaton.
+    int stateCount = ownOutputs.size();
+    QVector<int> fail(stateCount, 0);
+    QVector<QVector<int>> outputs(stateCount);
+    QVector<int> queue;
+    queue.reserve(stateCount);
+
+    outputs[0] = ownOutputs[0];
+    for(int cls = 0; cls < m_classCount; ++cls) {
+        int& edge = m_next[cls];
+        if(edge == -1) {
+            edge = 0;
+        }
+        else {
+            fail[edge] = 0;
+            queue.append(edge);
+        }
+    }
+
+    for(int head = 0; head < queue.size(); ++head) {
+        int state = queue[head];
+        outputs[state] = ownOutputs[state] + outputs[fail[state]];
+
+        for(int cls = 0; cls < m_classCount; ++cls) {
+            int& edge = m_next[state * m_classCount + cls];
+            int fallback = m_next[fail[state] * m_classCount + cls];
+            if(edge == -1) {
+                edge = fallback;
+            }
+            else {
+                fail[edge] = fallback;
+                queue.append(edge);
+            }
+        }
+    }
+
+    m_outputStart.resize(stateCount + 1);
+    m_outputs.clear();
+    for(int state = 0; state < stateCount; ++state) {
+        m_outputStart[state] = m_outputs.size();
+        m_outputs += outputs[state];
+    }
+    m_outputStart[stateCount] = m_outputs.size();
+}
+
+} // namespace codetextedit
@@ -0,0 +1,68 @@
+/***********************************************************************
+The CodeTextEditor provides an editor showing live hints and annotations.
+
+Copyright (c) 2020 Brian Newham <seaweedsolutionsltd@gmail.com>.
+
+CodeTextEdit is free software dual licensed under the GNU LGPL or MIT License.
+***********************************************************************/
+
+#ifndef PATTERNAUTOMATON_H
+#define PATTERNAUTOMATON_H
+
+#include <QChar>
+#include <QString>
+#include <QVector>
+
+namespace codetextedit
+{
+    ///
+    /// \brief Finds every occurrence of many ASCII patterns in one pass.
+    ///
+    /// An Aho-Corasick automaton compiled to a full transition table. Characters are mapped
+    /// to classes first, one per character used by the patterns, so the table stays small and
+    /// a step is two lookups whatever the number of patterns. Scanning allocates nothing.
+    ///
+    class PatternAutomaton
+    {
+    public:
+        explicit PatternAutomaton(Qt::CaseSensitivity cs = Qt::CaseSensitive);
+
+        /// Id of the added pattern, -1 if it is empty or not ASCII. Patterns added after
+        /// build() need another build().
+        int addPattern(const QString& pattern);
+        void build();
+
+        int patternCount() const {return m_patterns.size();}
+        int patternLength(int id) const {return m_patterns[id].size();}
+        int stateCount() const {return m_outputStart.size() - 1;}
+
+        /// Calls found(id, end) for every occurrence, in order of its end, one past its
+        /// last character.
+        template<typename Found>
+        void scan(const QChar* text, int length, Found found) const
+        {
+            const int* next = m_next.constData();
+            const int* outputStart = m_outputStart.constData();
+            int state = 0;
+            for(int i = 0; i < length; ++i) {
+                ushort c = text[i].unicode();
+                state = next[state * m_classCount + (c < 128 ? m_classes[c] : 0)];
+                for(int o = outputStart[state]; o < outputStart[state + 1]; ++o)
+                    found(m_outputs[o], i + 1);
+            }
+        }
+
+    private:
+        Qt::CaseSensitivity m_cs;
+        QVector<QByteArray> m_patterns;
+
+        quint8          m_classes[128];     // Class 0 is every character no pattern uses
+        int             m_classCount = 1;
+        QVector<int>    m_next;             // state * m_classCount + class
+        QVector<int>    m_outputStart;      // Outputs of a state are [start[state], start[state + 1])
+        QVector<int>    m_outputs;          // Pattern ids
+    };
+
+} // namespace codetextedit
+
+#endif // PATTERNAUTOMATON_H
@@ -0,0 +1,312 @@
+/***********************************************************************
+The CodeTextEditor provides an editor showing live hints and annotations.
+
+Copyright (c) 2020 Brian Newham <seaweedsolutionsltd@gmail.com>.
+
+CodeTextEdit is free software dual licensed under the GNU LGPL or MIT License.
+***********************************************************************/
+
+#include "RemoteAnnotator.h"
+#include "AnnotatorIpc.h"
+
+#include <QCoreApplication>
+#include <QElapsedTimer>
+#include <QLocalServer>
+#include <QLocalSocket>
+#include <QSharedMemory>
+#include <QProcess>
+#include <QDebug>
+
+namespace codetextedit
+{
+
+// How long one analyzeStep() may block, which bounds the worker's cancellation latency.
+static const int pollInterval = 20;
+
+struct RemoteAnnotator::Helper
+{
+    int             index = 0;
+    QString         name;
+    QProcess*       process = nullptr;
+    QLocalServer*   server = nullptr;
+    QLocalSocket*   socket = nullptr;
+    QSharedMemory*  input = nullptr;
+    int             inputGeneration = 0;
+
+    int             firstLine = 0;
+    int             lineCount = 0;
+    quint32         requestId = 0;
+    bool            pending = false;
+    int             restarts = 0;
+    QElapsedTimer   elapsed;
+};
+
+RemoteAnnotator::RemoteAnnotator(const QString &program, const QStringList &arguments)
+    : m_program(program)
+    , m_arguments(arguments)
+{
+}
+
+RemoteAnnotator::~RemoteAnnotator()
+{
+    analysisThreadFinished();
+    clearResult();
+}
+
+void RemoteAnnotator::setInstanceCount(int count)
+{
+    m_instanceCount = qMax(1, count);
+}
+
+void RemoteAnnotator::prepareAnalysis(QStringList lines)
+{
+    for(Helper* helper : m_helpers)
+        cancelRequest(*helper);
+
+    clearResult();
+    m_lines = lines;
+
+    while(m_helpers.size() > m_instanceCount) {
+        stopHelper(*m_helpers.last());
+        delete m_helpers.takeLast();
+    }
+    while(m_helpers.size() < m_instanceCount) {
+        Helper* helper = new Helper;
+        helper->index = m_helpers.size();
+        helper->name = QString("codetextedit-%1-%2-%3")
+                .arg(QCoreApplication::applicationPid())
+                .arg(quintptr(this), 0, 16)
+                .arg(helper->index);
+        m_helpers.append(helper);
+    }
+
+    int sliceSize = (m_lines.size() + m_instanceCount - 1) / m_instanceCount;
+    int firstLine = 0;
+
+    for(Helper* helper : m_helpers) {
+        helper->firstLine = firstLine;
+        helper->lineCount = qMin(sliceSize, m_lines.size() - firstLine);
+        helper->restarts = 0;
+        firstLine += helper->lineCount;
+
+        if(helper->lineCount <= 0)
+            continue;
+
+        bool connected = helper->socket && helper->socket->state() == QLocalSocket::ConnectedState;
+        if(! connected && ! startHelper(*helper))
+            continue;
+
+        if(! sendRequest(*helper))
+            restartHelper(*helper);
+    }
+}
+
+bool RemoteAnnotator::analyzeStep()
+{
+    int pendingCount = 0;
+    for(Helper* helper : m_helpers) {
+        if(helper->pending)
+            ++ pendingCount;
+    }
+    if(pendingCount == 0)
+        return false;
+
+    int slice = qMax(1, pollInterval / pendingCount);
+    bool hasMore = false;
+
+    for(Helper* helper : m_helpers) {
+        if(! helper->pending)
+            continue;
+
+        if(! pollHelper(*helper, slice) || helper->elapsed.hasExpired(m_timeout))
+            restartHelper(*helper);
+
+        hasMore = hasMore || helper->pending;
+    }
+
+    return hasMore;
+}
+
+AnnotationMap RemoteAnnotator::analysisResult()
+{
+    AnnotationMap result;
+    result.swap(m_result);
+    return result;
+}
+
+void RemoteAnnotator::analysisThreadFinished()
+{
+    // The helpers' sockets and processes belong to the analysis thread, so they go with it.
+    for(Helper* helper : m_helpers) {
+        stopHelper(*helper);
+        delete helper;
+    }
+    m_helpers.clear();
+}
+
+bool RemoteAnnotator::startHelper(Helper &helper)
+{
+    stopHelper(helper);
+
+    helper.server = new QLocalServer;
+    QLocalServer::removeServer(helper.name);
+    if(! helper.server->listen(helper.name)) {
+        qWarning() << "Annotator helper: cannot listen on" << helper.name << helper.server->errorString();
+        stopHelper(helper);
+        return false;
+    }
+
+    helper.process = new QProcess;
+    helper.process->setProcessChannelMode(QProcess::ForwardedChannels);
+    helper.process->start(m_program, m_arguments + QStringList{"--server", helper.name});
+
+    if(! helper.process->waitForStarted(m_timeout)) {
+        qWarning() << "Annotator helper: cannot start" << m_program << helper.process->errorString();
+        stopHelper(helper);
+        return false;
+    }
+
+    if(! helper.server->waitForNewConnection(m_timeout)) {
+        qWarning() << "Annotator helper: no connection from" << m_program;
+        stopHelper(helper);
+        return false;
+    }
+
+    helper.socket = helper.server->nextPendingConnection();
+    return helper.socket != nullptr;
+}
+
+void RemoteAnnotator::stopHelper(Helper &helper)
+{
+    if(helper.process) {
+        helper.process->kill();
+        helper.process->waitForFinished(1000);
+    }
+
+    delete helper.process;
+    delete helper.server;   // Owns the socket
+    delete helper.input;
+
+    helper.process = nullptr;
+    helper.server = nullptr;
+    helper.socket = nullptr;
+    helper.input = nullptr;
+    helper.pending = false;
+}
+
+bool RemoteAnnotator::sendRequest(Helper &helper)
+{
+    if(! helper.socket)
+        return false;
+
+    int size = ipc::linesSize(m_lines, helper.firstLine, helper.lineCount);
+
+    // The helper copies the snapshot out before it answers, so an idle segment can be reused.
+    if(! helper.input || helper.input->size() < size) {
+        delete helper.input;
+        helper.input = new QSharedMemory(QString("%1-in-%2").arg(helper.name).arg(++ helper.inputGeneration));
+
+        if(! helper.input->create(size + size / 2)) {
+            qWarning() << "Annotator helper: cannot create shared memory" << helper.input->errorString();
+            delete helper.input;
+            helper.input = nullptr;
+            return false;
+        }
+    }
+
+    helper.input->lock();
+    ipc::writeLines(helper.input->data(), m_lines, helper.firstLine, helper.lineCount);
+    helper.input->unlock();
+
+    ipc::Message message;
+    message.type = ipc::MESSAGE_Request;
+    message.requestId = ++ helper.requestId;
+    message.memoryKey = helper.input->key();
+    message.size = quint32(size);
+    message.lineCount = helper.lineCount;
+
+    ipc::writeMessage(helper.socket, message);
+    helper.socket->flush();
+
+    helper.pending = true;
+    helper.elapsed.start();
+    return true;
+}
+
+void RemoteAnnotator::cancelRequest(Helper &helper)
+{
+    if(! helper.pending)
+        return;
+
+    ipc::Message message;
+    message.type = ipc::MESSAGE_Cancel;
+    message.requestId = helper.requestId;
+    ipc::writeMessage(helper.socket, message);
+    helper.socket->flush();
+
+    // The helper checks for cancellation between steps, so the answer is quick. The snapshot
+    // segment must not be rewritten before it arrives.
+    QElapsedTimer timer;
+    timer.start();
+    while(helper.pending) {
+        if(! pollHelper(helper, pollInterval) || timer.hasExpired(m_timeout)) {
+            stopHelper(helper);
+            break;
+        }
+    }
+}
+
+bool RemoteAnnotator::pollHelper(Helper &helper, int msecs)
+{
+    if(! helper.socket)
+        return false;
+
+    if(helper.socket->bytesAvailable() == 0 && ! helper.socket->waitForReadyRead(msecs))
+        return helper.socket->state() == QLocalSocket::ConnectedState;
+
+    ipc::Message message;
+    while(ipc::readMessage(helper.socket, message)) {
+        if(message.requestId != helper.requestId)
+            continue;
+
+        if(message.type == ipc::MESSAGE_Result) {
+            QSharedMemory output(message.memoryKey);
+            if(output.attach(QSharedMemory::ReadOnly)) {
+                output.lock();
+                ipc::readAnnotations(output.constData(), int(message.size), helper.firstLine, m_result);
+                output.unlock();
+                output.detach();
+            }
+            else {
+                qWarning() << "Annotator helper: cannot read result" << output.errorString();
+            }
+            helper.pending = false;
+        }
+        else if(message.type == ipc::MESSAGE_Cancelled || message.type == ipc::MESSAGE_Failed) {
+            helper.pending = false;
+        }
+    }
+
+    return true;
+}
+
+void RemoteAnnotator::restartHelper(Helper &helper)
+{
+    qWarning() << "Annotator helper" << helper.index << "stopped responding, restarting.";
+
+    if(helper.restarts ++ < m_maxRestarts && startHelper(helper) && sendRequest(helper))
+        return;
+
+    qWarning() << "Annotator helper" << helper.index << "gave up on lines"
+               << helper.firstLine << "to" << helper.firstLine + helper.lineCount - 1;
+    stopHelper(helper);
+}
+
+void RemoteAnnotator::clearResult()
+{
+    for(auto container : m_result)
+        qDeleteAll(container);
+    m_result.clear();
+}
+
+} // namespace codetextedit
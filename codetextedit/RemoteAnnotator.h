@@ -0,0 +1,83 @@
+/***********************************************************************
+The CodeTextEditor provides an editor showing live hints and annotations.
+
+Copyright (c) 2020 Brian Newham <seaweedsolutionsltd@gmail.com>.
+
+CodeTextEdit is free software dual licensed under the GNU LGPL or MIT License.
+***********************************************************************/
+
+#ifndef REMOTEANNOTATOR_H
+#define REMOTEANNOTATOR_H
+
+#include <QString>
+#include <QStringList>
+#include <QVector>
+
+#include "Annotation.h"
+
+namespace codetextedit
+{
+    ///
+    /// \brief Annotator adapter which runs the real analysis in helper processes.
+    ///
+    /// The helper is any program that hosts an Annotator with AnnotatorHost. It is started
+    /// on first use with "--server <name>" appended to its arguments and connects back over
+    /// a QLocalSocket. Snapshots and results are exchanged through shared memory.
+    ///
+    /// A helper which crashes, disconnects or exceeds the timeout is restarted and its part
+    /// of the document resubmitted. With several instances the document is split into
+    /// contiguous slices analyzed in parallel, so it only suits line local annotators.
+    ///
+    /// All analysis calls, like for any Annotator, come from the AnnotationWorker thread.
+    ///
+    class RemoteAnnotator : public Annotator
+    {
+    public:
+        explicit RemoteAnnotator(const QString& program, const QStringList& arguments = QStringList());
+        ~RemoteAnnotator() override;
+
+        /// Takes effect from the next analysis.
+        void setInstanceCount(int count);
+        int instanceCount() const {return m_instanceCount;}
+
+        /// Milliseconds allowed for startup and for a single analysis.
+        void setTimeout(int msecs) {m_timeout = msecs;}
+        int timeout() const {return m_timeout;}
+
+        /// Restarts allowed per analysis before the helper's slice is given up.
+        void setMaxRestarts(int restarts) {m_maxRestarts = restarts;}
+
+        void setVersion(const QString& version) {m_version = version;}
+        QString version() const override {return m_version;}
+
+        void prepareAnalysis(QStringList lines) override;
+        bool analyzeStep() override;
+        AnnotationMap analysisResult() override;
+        void analysisThreadFinished() override;
+
+    private:
+        struct Helper;
+
+        bool startHelper(Helper& helper);
+        void stopHelper(Helper& helper);
+        bool sendRequest(Helper& helper);
+        void cancelRequest(Helper& helper);
+        bool pollHelper(Helper& helper, int msecs);
+        void restartHelper(Helper& helper);
+        void clearResult();
+
+        QString             m_program;
+        QStringList         m_arguments;
+        QString             m_version;
+        int                 m_instanceCount = 1;
+        int                 m_timeout = 30000;
+        int                 m_maxRestarts = 3;
+
+        QVector<Helper*>    m_helpers;
+        QStringList         m_lines;
+        AnnotationMap       m_result;
+    };
+
+} // namespace codetextedit
+
+#endif // REMOTEANNOTATOR_H
@@ -0,0 +1,69 @@
+/***********************************************************************
+The CodeTextEditor provides an editor showing live hints and annotations.
+
+Copyright (c) 2020 Brian Newham <seaweedsolutionsltd@gmail.com>.
+
+CodeTextEdit is free software dual licensed under the GNU LGPL or MIT License.
+***********************************************************************/
+
+#include "RuleAnnotator.h"
+
+namespace codetextedit
+{
+
+RuleAnnotator::RuleAnnotator(QSharedPointer<const RuleSet> rules)
+    : m_rules(rules)
+{
+}
+
+void RuleAnnotator::prepareAnalysis(QStringList lines)
+{
+    prepareAnalysis(lines, LineTokens());
+}
+
+void RuleAnnotator::prepareAnalysis(QStringList lines, LineTokens tokens)
+{
+    m_lines = lines;
+    m_tokens = tokens;
+    m_currentLine = 0;
+    m_annotationMap.clear();
+}
+
+bool RuleAnnotator::analyzeStep()
+{
+    if(m_currentLine >= m_lines.size())
+        return false;
+
+    AnnotationContainer container;
+    scanLine(m_currentLine, container);
+    if(! container.isEmpty())
+        m_annotationMap[m_currentLine] = container;
+
+    ++ m_currentLine;
+    return m_currentLine < m_lines.size();
+}
+
+bool RuleAnnotator::analyzeRange(int first, int count, AnnotationContainer *results)
+{
+    for(int i = 0; i < count; ++i)
+        scanLine(first + i, results[i]);
+
+    return true;
+}
+
+void RuleAnnotator::scanLine(int line, AnnotationContainer &container) const
+{
+    if(m_tokens.isEmpty())
+        m_rules->scanLine(m_lines[line], container);
+    else
+        m_rules->scanLine(m_lines[line], m_tokens[line], container);
+}
+
+AnnotationMap RuleAnnotator::analysisResult()
+{
+    AnnotationMap result;
+    result.swap(m_annotationMap);
+    return result;
+}
+
+} // namespace codetextedit
@@ -0,0 +1,50 @@
+/***********************************************************************
+The CodeTextEditor provides an editor showing live hints and annotations.
+
+Copyright (c) 2020 Brian Newham <seaweedsolutionsltd@gmail.com>.
+
+CodeTextEdit is free software dual licensed under the GNU LGPL or MIT License.
+***********************************************************************/
+
+#ifndef RULEANNOTATOR_H
+#define RULEANNOTATOR_H
+
+#include <QSharedPointer>
+#include <QStringList>
+
+#include "Annotation.h"
+#include "RuleSet.h"
+
+namespace codetextedit
+{
+    ///
+    /// \brief Annotator driven by a RuleSet instead of code.
+    ///
+    /// Annotators sharing one rule set can run on different threads.
+    ///
+    class RuleAnnotator : public Annotator, public SolutionHelpProvider
+    {
+    public:
+        explicit RuleAnnotator(QSharedPointer<const RuleSet> rules);
+
+        void prepareAnalysis(QStringList lines) override;
+        void prepareAnalysis(QStringList lines, LineTokens tokens) override;
+        bool analyzeStep() override;
+        bool analyzeRange(int first, int count, AnnotationContainer* results) override;
+        AnnotationMap analysisResult() override;
+        QString version() const override {return m_rules->version();}
+        QString solutionHelp(const QString& helpKey) const override {return m_rules->solutionHelp(helpKey);}
+
+    private:
+        void scanLine(int line, AnnotationContainer& container) const;
+
+        QSharedPointer<const RuleSet>   m_rules;
+        QStringList                     m_lines;
+        LineTokens                      m_tokens;       // Empty if the lines were not lexed
+        int                             m_currentLine = 0;
+        AnnotationMap                   m_annotationMap;
+    };
+
+} // namespace codetextedit
+
+#endif // RULEANNOTATOR_H
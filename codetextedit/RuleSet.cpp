@@ -0,0 +1,236 @@
+/***********************************************************************
+The CodeTextEditor provides an editor showing live hints and annotations.
+
+Copyright (c) 2020 Brian Newham <seaweedsolutionsltd@gmail.com>.
+
+CodeTextEdit is free software dual licensed under the GNU LGPL or MIT License.
+***********************************************************************/
+
+#include "RuleSet.h"
+#include "KeywordScanner.h"
+
+#include <QFile>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QJsonArray>
+#include <QCryptographicHash>
+
+#include <algorithm>
+
+namespace codetextedit
+{
+
+static bool isWordChar(QChar c)
+{
+    return c.isLetterOrNumber() || c == '_';
+}
+
+static bool parseCategory(const QString& name, Annotation::Category& category)
+{
+    static const char* names[] = {"unspecified", "hint", "warning", "error"};
+    for(int i = 0; i <= Annotation::CATEGORY_Error; ++i) {
+        if(name == QLatin1String(names[i])) {
+            category = Annotation::Category(i);
+            return true;
+        }
+    }
+    return false;
+}
+
+static bool parseRange(const QJsonValue& value, qint64& min, qint64& max)
+{
+    QJsonArray range = value.toArray();
+    if(range.size() != 2 || ! range[0].isDouble() || ! range[1].isDouble())
+        return false;
+
+    min = qint64(range[0].toDouble());
+    max = qint64(range[1].toDouble());
+    return min <= max;
+}
+
+RuleSet::RuleSet()
+{
+}
+
+bool RuleSet::load(const QString &filePath, QString *error)
+{
+    QFile file(filePath);
+    if(! file.open(QFile::ReadOnly)) {
+        if(error)
+            *error = file.errorString();
+        return false;
+    }
+
+    return loadJson(file.readAll(), error);
+}
+
+bool RuleSet::loadJson(const QByteArray &json, QString *error)
+{
+    auto fail = [error](const QString& message) {
+        if(error)
+            *error = message;
+        return false;
+    };
+
+    QJsonParseError parseError;
+    QJsonDocument document = QJsonDocument::fromJson(json, &parseError);
+    if(! document.isObject())
+        return fail(parseError.error != QJsonParseError::NoError ? parseError.errorString() : QString("Not a JSON object"));
+
+    QJsonObject root = document.object();
+    Qt::CaseSensitivity cs = root.value("caseSensitive").toBool(true) ? Qt::CaseSensitive : Qt::CaseInsensitive;
+
+    PatternAutomaton automaton(cs);
+    QVector<Rule> rules;
+    QVector<Message> messages;
+    QHash<QString, QString> help;
+
+    const QJsonArray ruleArray = root.value("rules").toArray();
+    for(int index = 0; index < ruleArray.size(); ++index) {
+        QJsonObject object = ruleArray[index].toObject();
+        QString context = QString("Rule %1: ").arg(index);
+
+        QString command = object.value("command").toString();
+        if(automaton.addPattern(command) != rules.size())
+            return fail(context + "\"command\" must be a non-empty ASCII string");
+
+        Rule rule;
+        QString where = object.value("where").toString("first");
+        QString when = object.value("when").toString("matched");
+        if(where != "first" && where != "anywhere")
+            return fail(context + "\"where\" must be \"first\" or \"anywhere\"");
+        if(when != "matched" && when != "invalid")
+            return fail(context + "\"when\" must be \"matched\" or \"invalid\"");
+        rule.anywhere = where == "anywhere";
+        rule.whenInvalid = when == "invalid";
+
+        QJsonObject params = object.value("params").toObject();
+        if(params.contains("count")) {
+            qint64 min = 0, max = 0;
+            if(! parseRange(params.value("count"), min, max))
+                return fail(context + "\"count\" must be [min, max]");
+            rule.checkCount = true;
+            rule.minCount = int(min);
+            rule.maxCount = int(max);
+        }
+        if(params.contains("value")) {
+            if(! parseRange(params.value("value"), rule.minValue, rule.maxValue))
+                return fail(context + "\"value\" must be [min, max]");
+            rule.checkValue = true;
+        }
+
+        rule.firstMessage = messages.size();
+        for(const QJsonValue& value : object.value("annotations").toArray()) {
+            QJsonObject annotation = value.toObject();
+            Message message;
+            if(! parseCategory(annotation.value("category").toString("unspecified"), message.category))
+                return fail(context + "unknown \"category\"");
+            message.color = QColor(annotation.value("color").toString("black"));
+            message.message = annotation.value("message").toString();
+            message.helpKey = annotation.value("helpKey").toString();
+            if(annotation.contains("help")) {
+                if(message.helpKey.isEmpty())
+                    return fail(context + "\"help\" needs a \"helpKey\"");
+                help.insert(message.helpKey, annotation.value("help").toString());
+            }
+            messages.append(message);
+        }
+        rule.messageCount = messages.size() - rule.firstMessage;
+        rules.append(rule);
+    }
+
+    automaton.build();
+
+    m_automaton = automaton;
+    m_rules = rules;
+    m_anywhereRules = int(std::count_if(rules.constBegin(), rules.constEnd(), [](const Rule& rule) {return rule.anywhere;}));
+    m_messages = messages;
+    m_help = help;
+    m_version = root.value("version").toString() + '-'
+            + QCryptographicHash::hash(json, QCryptographicHash::Md5).toHex().left(8);
+    return true;
+}
+
+void RuleSet::scanLine(const QString &line, AnnotationContainer &container) const
+{
+    const QChar* text = line.constData();
+    int length = line.size();
+
+    m_automaton.scan(text, length, [&](int id, int end) {
+        const Rule& rule = m_rules[id];
+        if(fires(rule, text, length, end - m_automaton.patternLength(id), end))
+            appendMessages(rule, container);
+    });
+}
+
+void RuleSet::scanLine(const QString &line, const QVector<KeywordSpan> &tokens, AnnotationContainer &container) const
+{
+    // "anywhere" rules can match any word, comments too, which the tokens do not cover.
+    if(m_anywhereRules > 0) {
+        scanLine(line, container);
+        return;
+    }
+
+    int commandLength = KeywordScanner::firstCommand(line, tokens).size();
+    if(commandLength == 0)
+        return;
+
+    // Only a pattern spanning the whole command can fire, the parameters are read after it.
+    const QChar* text = line.constData();
+    m_automaton.scan(text, commandLength, [&](int id, int end) {
+        if(end == commandLength && m_automaton.patternLength(id) == commandLength && fires(m_rules[id], text, line.size(), 0, end))
+            appendMessages(m_rules[id], container);
+    });
+}
+
+void RuleSet::appendMessages(const Rule &rule, AnnotationContainer &container) const
+{
+    for(int i = rule.firstMessage; i < rule.firstMessage + rule.messageCount; ++i) {
+        const Message& message = m_messages[i];
+        Annotation *annotation = new Annotation;
+        annotation->setCategory(message.category);
+        annotation->setAlertColor(message.color);
+        annotation->setMessage(message.message);
+        annotation->setHelpKey(message.helpKey);
+        container.append(annotation);
+    }
+}
+
+bool RuleSet::fires(const Rule &rule, const QChar *text, int length, int start, int end) const
+{
+    if(rule.anywhere) {
+        if((start > 0 && isWordChar(text[start - 1])) || (end < length && isWordChar(text[end])))
+            return false;
+    }
+    else if(start != 0 || (end < length && text[end] != ',')) {
+        return false;
+    }
+
+    if(! rule.checkCount && ! rule.checkValue)
+        return ! rule.whenInvalid;
+
+    // Parameters are read in place, nothing is split or copied.
+    int count = 0;
+    bool valuesOk = true;
+    int pos = end;
+    while(pos < length && text[pos] == ',') {
+        ++ pos;
+        qint64 value = 0;
+        bool numeric = pos < length && text[pos].isDigit();
+        while(pos < length && isWordChar(text[pos])) {
+            if(! text[pos].isDigit())
+                numeric = false;
+            else if(value <= rule.maxValue)
+                value = value * 10 + text[pos].digitValue();
+            ++ pos;
+        }
+        ++ count;
+        if(rule.checkValue && (! numeric || value < rule.minValue || value > rule.maxValue))
+            valuesOk = false;
+    }
+
+    bool valid = (! rule.checkCount || (count >= rule.minCount && count <= rule.maxCount)) && valuesOk;
+    return valid != rule.whenInvalid;
+}
+
+} // namespace codetextedit
@@ -0,0 +1,106 @@
+/***********************************************************************
+The CodeTextEditor provides an editor showing live hints and annotations.
+
+Copyright (c) 2020 Brian Newham <seaweedsolutionsltd@gmail.com>.
+
+CodeTextEdit is free software dual licensed under the GNU LGPL or MIT License.
+***********************************************************************/
+
+#ifndef RULESET_H
+#define RULESET_H
+
+#include <QString>
+#include <QByteArray>
+#include <QColor>
+#include <QVector>
+#include <QHash>
+
+#include "Annotation.h"
+#include "KeywordSpan.h"
+#include "PatternAutomaton.h"
+
+namespace codetextedit
+{
+    ///
+    /// \brief Annotation rules loaded from a file and compiled into one automaton.
+    ///
+    /// The rules are a JSON object:
+    ///
+    ///     {
+    ///         "version": "1",
+    ///         "caseSensitive": true,
+    ///         "rules": [{
+    ///             "command": "AA",
+    ///             "where": "first",               // or "anywhere"
+    ///             "params": {"count": [1, 3], "value": [0, 255]},
+    ///             "when": "matched",              // or "invalid"
+    ///             "annotations": [{"category": "error", "message": "...",
+    ///                              "color": "red", "helpKey": "AA.1", "help": "..."}]
+    ///         }]
+    ///     }
+    ///
+    /// A "first" command is the line's first comma separated field, an "anywhere" command is
+    /// any whole word. Its parameters are the ",value" fields straight after it. A "matched"
+    /// rule annotates when the parameters meet every constraint, an "invalid" one when they
+    /// do not. Help texts are looked up by help key when a popup shows them.
+    ///
+    /// Scanning a line is one pass of the automaton over it, only the annotations it returns
+    /// are allocated. Immutable once loaded, so one rule set can serve every thread.
+    ///
+    class RuleSet
+    {
+    public:
+        RuleSet();
+
+        bool load(const QString& filePath, QString* error = nullptr);
+        bool loadJson(const QByteArray& json, QString* error = nullptr);
+
+        int ruleCount() const {return m_rules.size();}
+        /// The file's "version" and a hash of its contents.
+        QString version() const {return m_version;}
+
+        /// Appends the annotations of line to container, the caller owns them.
+        void scanLine(const QString& line, AnnotationContainer& container) const;
+        /// Like scanLine(), with the lexer's tokens of line. "first" rules then only look at
+        /// the command the tokens found, see KeywordScanner::firstCommand(), so without
+        /// "anywhere" rules no line is scanned past its command and lines without one not at
+        /// all. A first field the lexer does not take for a command, e.g. "A-B", never fires.
+        void scanLine(const QString& line, const QVector<KeywordSpan>& tokens, AnnotationContainer& container) const;
+
+        QString solutionHelp(const QString& helpKey) const {return m_help.value(helpKey);}
+
+    private:
+        struct Message
+        {
+            Annotation::Category    category = Annotation::CATEGORY_Unspecified;
+            QColor                  color;
+            QString                 message;
+            QString                 helpKey;
+        };
+
+        struct Rule
+        {
+            bool    anywhere = false;
+            bool    whenInvalid = false;
+            bool    checkCount = false;
+            bool    checkValue = false;
+            int     minCount = 0, maxCount = 0;
+            qint64  minValue = 0, maxValue = 0;
+            int     firstMessage = 0;
+            int     messageCount = 0;
+        };
+
+        bool fires(const Rule& rule, const QChar* text, int length, int start, int end) const;
+        void appendMessages(const Rule& rule, AnnotationContainer& container) const;
+
+        PatternAutomaton        m_automaton;        // Pattern id is the rule index
+        QVector<Rule>           m_rules;
+        int                     m_anywhereRules = 0;
+        QVector<Message>        m_messages;
+        QHash<QString, QString> m_help;
+        QString                 m_version;
+    };
+
+} // namespace codetextedit
+
+#endif // RULESET_H
@@ -0,0 +1,132 @@
+/***********************************************************************
+The CodeTextEditor provides an editor showing live hints and annotations.
+
+Copyright (c) 2020 Brian Newham <seaweedsolutionsltd@gmail.com>.
+
+CodeTextEdit is free software dual licensed under the GNU LGPL or MIT License.
+***********************************************************************/
+
+#include <QElapsedTimer>
+#include <QDebug>
+
+#include "SearchWorker.h"
+#include "SubstringSearch.h"
+
+namespace codetextedit {
+
+// The text is scanned in windows so a restart is noticed quickly even without matches.
+static const int searchWindow = 1 << 20;
+// Matches are sent when this many are pending or this many milliseconds have passed.
+static const int chunkMatches = 4096;
+static const int chunkMsecs = 30;
+
+SearchWorker::SearchWorker(QObject *parent)
+    : QThread(parent)
+{
+    qRegisterMetaType<QVector<int>>("QVector<int>");
+}
+
+SearchWorker::~SearchWorker()
+{
+    kill();
+    wait();
+}
+
+void SearchWorker::kill()
+{
+    QMutexLocker locker(&mutex);
+    killLoop = true;
+    restart = true;
+    condition.wakeOne();
+}
+
+void SearchWorker::search(const QString &text, const QString &query, Qt::CaseSensitivity cs, int generation)
+{
+    QMutexLocker locker(&mutex);
+
+    this->text = text;
+    this->query = query;
+    this->cs = cs;
+    this->generation = generation;
+
+    if (!isRunning()) {
+        start(LowPriority);
+    }
+    else {
+        restart = true;
+        condition.wakeOne();
+    }
+}
+
+void SearchWorker::cancel()
+{
+    QMutexLocker locker(&mutex);
+
+    text.clear();
+    query.clear();
+    restart = true;
+    condition.wakeOne();
+}
+
+void SearchWorker::run()
+{
+    forever {
+        mutex.lock();
+        QString text = this->text;
+        QString query = this->query;
+        Qt::CaseSensitivity cs = this->cs;
+        int generation = this->generation;
+        restart = false;
+        mutex.unlock();
+
+        if(! query.isEmpty() && ! text.isEmpty()) {
+            SubstringSearch searcher(query, cs);
+            QVector<int> chunk;
+            int count = 0;
+            int from = 0;
+
+            QElapsedTimer sinceEmit;
+            sinceEmit.start();
+
+            while(from < text.size() && ! restart) {
+                // Matches starting before windowEnd, which may run past it.
+                int windowEnd = qMin(text.size(), from + searchWindow);
+                int length = qMin(text.size(), windowEnd + query.size() - 1);
+
+                int pos = searcher.indexIn(text.constData(), length, from);
+                if(pos == -1) {
+                    from = windowEnd;
+                }
+                else {
+                    chunk.append(pos);
+                    ++ count;
+                    from = pos + query.size();
+                }
+
+                if(chunk.size() >= chunkMatches || (! chunk.isEmpty() && sinceEmit.hasExpired(chunkMsecs))) {
+                    emit matchesFound(generation, chunk);
+                    chunk.clear();
+                    sinceEmit.restart();
+                }
+            }
+
+            if(! restart) {
+                if(! chunk.isEmpty())
+                    emit matchesFound(generation, chunk);
+                emit searchFinished(generation, count);
+            }
+        }
+
+        mutex.lock();
+        if (!restart)
+            condition.wait(&mutex);
+
+        if(killLoop) {
+            mutex.unlock();
+            return;
+        }
+        mutex.unlock();
+    }
+}
+
+} // namespace codetextedit
@@ -0,0 +1,59 @@
+/***********************************************************************
+The CodeTextEditor provides an editor showing live hints and annotations.
+
+Copyright (c) 2020 Brian Newham <seaweedsolutionsltd@gmail.com>.
+
+CodeTextEdit is free software dual licensed under the GNU LGPL or MIT License.
+***********************************************************************/
+
+#ifndef SEARCHWORKER_H
+#define SEARCHWORKER_H
+
+#include <QObject>
+#include <QThread>
+#include <QMutex>
+#include <QWaitCondition>
+#include <QVector>
+
+namespace codetextedit {
+
+///
+/// \brief Worker class which finds all matches in a document snapshot
+///
+/// Matches stream back in document order through matchesFound(). Every search carries
+/// the generation it was started with so the receiver can drop chunks of an older one.
+///
+class SearchWorker : public QThread
+{
+    Q_OBJECT
+
+public:
+    SearchWorker(QObject *parent = nullptr);
+    ~SearchWorker() override;
+
+    void kill();
+    void search(const QString& text, const QString& query, Qt::CaseSensitivity cs, int generation);
+    void cancel();
+
+signals:
+    void matchesFound(int generation, QVector<int> positions);
+    void searchFinished(int generation, int count);
+
+protected:
+    void run() override;
+
+private:
+    QMutex              mutex;
+    QWaitCondition      condition;
+    bool                restart = false;
+    bool                killLoop = false;
+
+    QString             text;
+    QString             query;
+    Qt::CaseSensitivity cs = Qt::CaseInsensitive;
+    int                 generation = 0;
+};
+
+} // namespace codetextedit
+
+#endif // SEARCHWORKER_H
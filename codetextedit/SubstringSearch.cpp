@@ -0,0 +1,151 @@
+/***********************************************************************
+The CodeTextEditor provides an editor showing live hints and annotations.
+
+Copyright (c) 2020 Brian Newham <seaweedsolutionsltd@gmail.com>.
+
+CodeTextEdit is free software dual licensed under the GNU LGPL or MIT License.
+***********************************************************************/
+
+#include "SubstringSearch.h"
+
+#include <QtAlgorithms>
+
+#include <cstring>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#  include <emmintrin.h>
+#  define CODETEXTEDIT_SSE2
+#endif
+
+namespace codetextedit
+{
+
+static inline ushort foldCase(ushort c)
+{
+    return ushort(QChar::toCaseFolded(uint(c)));
+}
+
+// The SIMD filter compares with the lower and upper case form only. That is exact for
+// ASCII except 'k' and 's', which also fold from KELVIN SIGN and LONG S.
+static bool hasTwoCaseForms(ushort c)
+{
+    ushort folded = foldCase(c);
+    return c < 0x80 && folded != 'k' && folded != 's';
+}
+
+SubstringSearch::SubstringSearch(const QString &needle, Qt::CaseSensitivity cs)
+    : m_needle(needle)
+    , m_foldedNeedle(needle)
+    , m_cs(cs)
+    , m_firstLower(0), m_firstUpper(0)
+    , m_lastLower(0), m_lastUpper(0)
+{
+    if(m_needle.isEmpty())
+        return;
+
+    // Folded one code unit at a time so it lines up with the text being compared.
+    for(int i = 0; i < m_foldedNeedle.size(); ++i)
+        m_foldedNeedle[i] = QChar(foldCase(m_foldedNeedle.at(i).unicode()));
+
+    ushort first = m_needle.at(0).unicode();
+    ushort last = m_needle.at(m_needle.size() - 1).unicode();
+
+    if(m_cs == Qt::CaseSensitive) {
+        m_firstLower = m_firstUpper = first;
+        m_lastLower = m_lastUpper = last;
+    }
+    else {
+        m_firstLower = ushort(QChar::toLower(uint(first)));
+        m_firstUpper = ushort(QChar::toUpper(uint(first)));
+        m_lastLower = ushort(QChar::toLower(uint(last)));
+        m_lastUpper = ushort(QChar::toUpper(uint(last)));
+    }
+}
+
+int SubstringSearch::indexIn(const QChar *haystack, int length, int from) const
+{
+    if(m_needle.isEmpty() || from < 0 || length - from < m_needle.size())
+        return -1;
+
+    const ushort* text = reinterpret_cast<const ushort*>(haystack);
+
+#ifdef CODETEXTEDIT_SSE2
+    bool exactFilter = m_cs == Qt::CaseSensitive
+            || (hasTwoCaseForms(m_needle.at(0).unicode()) && hasTwoCaseForms(m_needle.at(m_needle.size() - 1).unicode()));
+    if(exactFilter)
+        return indexInSse2(text, length, from);
+#endif
+
+    return indexInScalar(text, length, from);
+}
+
+bool SubstringSearch::matchesAt(const ushort *haystack) const
+{
+    int length = m_needle.size();
+
+    if(m_cs == Qt::CaseSensitive)
+        return std::memcmp(haystack, m_needle.utf16(), size_t(length) * sizeof(ushort)) == 0;
+
+    const ushort* folded = m_foldedNeedle.utf16();
+    for(int i = 0; i < length; ++i) {
+        if(haystack[i] != folded[i] && foldCase(haystack[i]) != folded[i])
+            return false;
+    }
+    return true;
+}
+
+int SubstringSearch::indexInScalar(const ushort *haystack, int length, int from) const
+{
+    int lastStart = length - m_needle.size();
+    ushort first = m_foldedNeedle.at(0).unicode();
+
+    for(int pos = from; pos <= lastStart; ++pos) {
+        ushort c = haystack[pos];
+        if(m_cs == Qt::CaseSensitive ? c != m_firstLower : (c != first && foldCase(c) != first))
+            continue;
+        if(matchesAt(haystack + pos))
+            return pos;
+    }
+    return -1;
+}
+
+#ifdef CODETEXTEDIT_SSE2
+int SubstringSearch::indexInSse2(const ushort *haystack, int length, int from) const
+{
+    const int lastOffset = m_needle.size() - 1;
+    const int lastStart = length - m_needle.size();
+
+    const __m128i firstLower = _mm_set1_epi16(short(m_firstLower));
+    const __m128i firstUpper = _mm_set1_epi16(short(m_firstUpper));
+    const __m128i lastLower = _mm_set1_epi16(short(m_lastLower));
+    const __m128i lastUpper = _mm_set1_epi16(short(m_lastUpper));
+
+    int pos = from;
+    for(; pos + 8 <= lastStart + 1; pos += 8) {
+        __m128i blockFirst = _mm_loadu_si128(reinterpret_cast<const __m128i*>(haystack + pos));
+        __m128i blockLast = _mm_loadu_si128(reinterpret_cast<const __m128i*>(haystack + pos + lastOffset));
+
+        __m128i matchFirst = _mm_or_si128(_mm_cmpeq_epi16(blockFirst, firstLower), _mm_cmpeq_epi16(blockFirst, firstUpper));
+        __m128i matchLast = _mm_or_si128(_mm_cmpeq_epi16(blockLast, lastLower), _mm_cmpeq_epi16(blockLast, lastUpper));
+
+        // Two mask bits per UTF-16 code unit.
+        uint mask = uint(_mm_movemask_epi8(_mm_and_si128(matchFirst, matchLast)));
+        while(mask != 0) {
+            int bit = int(qCountTrailingZeroBits(mask));
+            int candidate = pos + bit / 2;
+            if(matchesAt(haystack + candidate))
+                return candidate;
+            mask &= ~(3u << bit);
+        }
+    }
+
+    return indexInScalar(haystack, length, pos);
+}
+#else
+int SubstringSearch::indexInSse2(const ushort *haystack, int length, int from) const
+{
+    return indexInScalar(haystack, length, from);
+}
+#endif
+
+} // namespace codetextedit
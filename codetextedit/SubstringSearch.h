@@ -0,0 +1,51 @@
+/***********************************************************************
+The CodeTextEditor provides an editor showing live hints and annotations.
+
+Copyright (c) 2020 Brian Newham <seaweedsolutionsltd@gmail.com>.
+
+CodeTextEdit is free software dual licensed under the GNU LGPL or MIT License.
+***********************************************************************/
+
+#ifndef SUBSTRINGSEARCH_H
+#define SUBSTRINGSEARCH_H
+
+#include <QChar>
+#include <QString>
+
+namespace codetextedit
+{
+    ///
+    /// \brief Substring search over UTF-16 text.
+    ///
+    /// Candidates are found 8 characters at a time by comparing the needle's first and last
+    /// characters with SSE2, then verified. Other targets use the scalar loop. Case folding
+    /// follows QChar::toCaseFolded() per UTF-16 code unit.
+    ///
+    class SubstringSearch
+    {
+    public:
+        SubstringSearch(const QString& needle, Qt::CaseSensitivity cs);
+
+        /// Position of the first match starting at or after from, -1 if none. Matches must
+        /// end within length.
+        int indexIn(const QChar* haystack, int length, int from) const;
+
+        int needleLength() const {return m_needle.size();}
+
+    private:
+        bool matchesAt(const ushort* haystack) const;
+        int indexInScalar(const ushort* haystack, int length, int from) const;
+        int indexInSse2(const ushort* haystack, int length, int from) const;
+
+        QString             m_needle;
+        QString             m_foldedNeedle;
+        Qt::CaseSensitivity m_cs;
+
+        // Variants of the first and last character which can match under the sensitivity.
+        ushort              m_firstLower, m_firstUpper;
+        ushort              m_lastLower, m_lastUpper;
+    };
+
+} // namespace codetextedit
+
+#endif // SUBSTRINGSEARCH_H
@@ -0,0 +1,113 @@
+/***********************************************************************
+The CodeTextEditor provides an editor showing live hints and annotations.
+
+Copyright (c) 2020 Brian Newham <seaweedsolutionsltd@gmail.com>.
+
+CodeTextEdit is free software dual licensed under the GNU LGPL or MIT License.
+***********************************************************************/
+
+#include "SymbolIndex.h"
+
+namespace codetextedit
+{
+
+void SymbolIndex::update(BlockData *block, const QStringList &definitions, const QStringList &references, QSet<QString> &changed)
+{
+    Symbols symbols;
+    symbols.definitions = definitions;
+    symbols.references = references;
+
+    auto it = m_blocks.find(block);
+    if(it != m_blocks.end()) {
+        // Edits mostly leave a line's labels as they were.
+        if(it->definitions == definitions && it->references == references)
+            return;
+
+        for(const QString& label : it->definitions) {
+            if(! definitions.contains(label) || it->definitions.count(label) != definitions.count(label))
+                changed.insert(label);
+        }
+        subtract(block, *it);
+    }
+
+    for(const QString& label : definitions) {
+        if(it == m_blocks.end() || ! it->definitions.contains(label) || it->definitions.count(label) != definitions.count(label))
+            changed.insert(label);
+    }
+
+    if(definitions.isEmpty() && references.isEmpty()) {
+        if(it != m_blocks.end())
+            m_blocks.erase(it);
+        return;
+    }
+
+    add(block, symbols);
+    m_blocks.insert(block, symbols);
+}
+
+void SymbolIndex::remove(BlockData *block, QSet<QString> &changed)
+{
+    auto it = m_blocks.find(block);
+    if(it == m_blocks.end())
+        return;
+
+    for(const QString& label : it->definitions)
+        changed.insert(label);
+    subtract(block, *it);
+    m_blocks.erase(it);
+}
+
+void SymbolIndex::clear()
+{
+    m_blocks.clear();
+    m_definitions.clear();
+    m_definitionCounts.clear();
+    m_references.clear();
+}
+
+const QStringList &SymbolIndex::definedBy(BlockData *block) const
+{
+    static const QStringList none;
+    auto it = m_blocks.constFind(block);
+    return it != m_blocks.constEnd() ? it->definitions : none;
+}
+
+const QStringList &SymbolIndex::referencedBy(BlockData *block) const
+{
+    static const QStringList none;
+    auto it = m_blocks.constFind(block);
+    return it != m_blocks.constEnd() ? it->references : none;
+}
+
+void SymbolIndex::add(BlockData *block, const Symbols &symbols)
+{
+    for(const QString& label : symbols.definitions) {
+        m_definitions[label].insert(block);
+        ++ m_definitionCounts[label];
+    }
+    for(const QString& label : symbols.references)
+        m_references[label].insert(block);
+}
+
+void SymbolIndex::subtract(BlockData *block, const Symbols &symbols)
+{
+    for(const QString& label : symbols.definitions) {
+        if(-- m_definitionCounts[label] == 0) {
+            m_definitionCounts.remove(label);
+            m_definitions.remove(label);
+        }
+        else {
+            m_definitions[label].remove(block);
+        }
+    }
+    for(const QString& label : symbols.references) {
+        auto it = m_references.find(label);
+        if(it == m_references.end())
+            continue;
+        it->remove(block);
+        if(it->isEmpty())
+            m_references.erase(it);
+    }
+}
+
+} // namespace codetextedit
@@ -0,0 +1,65 @@
+/***********************************************************************
+The CodeTextEditor provides an editor showing live hints and annotations.
+
+Copyright (c) 2020 Brian Newham <seaweedsolutionsltd@gmail.com>.
+
+CodeTextEdit is free software dual licensed under the GNU LGPL or MIT License.
+***********************************************************************/
+
+#ifndef SYMBOLINDEX_H
+#define SYMBOLINDEX_H
+
+#include <QHash>
+#include <QSet>
+#include <QStringList>
+
+namespace codetextedit
+{
+    class BlockData;
+
+    ///
+    /// \brief Which blocks define and refer to each label.
+    ///
+    /// Kept by block rather than line number, so inserting or removing lines above a label
+    /// changes nothing here. Updating a block reports the labels whose definitions changed:
+    /// the blocks defining or referring to those are the only others to check again.
+    ///
+    class SymbolIndex
+    {
+    public:
+        SymbolIndex() {}
+
+        /// Replaces the labels block defines and refers to. Adds the labels it now defines
+        /// more or fewer times to changed.
+        void update(BlockData* block, const QStringList& definitions, const QStringList& references, QSet<QString>& changed);
+        /// Forgets a deleted block, the same way.
+        void remove(BlockData* block, QSet<QString>& changed);
+        void clear();
+
+        /// Times label is defined, by any number of blocks.
+        int definitionCount(const QString& label) const {return m_definitionCounts.value(label);}
+        QSet<BlockData*> definitions(const QString& label) const {return m_definitions.value(label);}
+        QSet<BlockData*> references(const QString& label) const {return m_references.value(label);}
+
+        const QStringList& definedBy(BlockData* block) const;
+        const QStringList& referencedBy(BlockData* block) const;
+
+    private:
+        struct Symbols
+        {
+            QStringList definitions;
+            QStringList references;
+        };
+
+        void add(BlockData* block, const Symbols& symbols);
+        void subtract(BlockData* block, const Symbols& symbols);
+
+        QHash<BlockData*, Symbols>          m_blocks;
+        QHash<QString, QSet<BlockData*>>    m_definitions;
+        QHash<QString, int>                 m_definitionCounts;     // A block may define one twice
+        QHash<QString, QSet<BlockData*>>    m_references;
+    };
+
+} // namespace codetextedit
+
+#endif // SYMBOLINDEX_H
@@ -0,0 +1,16 @@
+# The demo editor, built from the sources in the repository root.
+QT += widgets qml quick quickwidgets
+CONFIG += c++11
+
+TARGET = TestEditor
+
+INCLUDEPATH += $$PWD/..
+
+include(../codetextedit/CodeTextEdit.pri)
+
+HEADERS += \
+    ../TestAnnotator.h \
+
+SOURCES += \
+    ../TestAnnotator.cpp \
+    ../main.cpp \
@@ -0,0 +1,18 @@
+# Lints files with TestAnnotator or a rules file, for CI. Needs no display.
+QT += gui
+QT -= widgets
+CONFIG += c++11 console
+CONFIG -= app_bundle
+
+INCLUDEPATH += $$PWD/../..
+
+LIBS += -L$$OUT_PWD/../lib -lcodetextlint
+win32:CONFIG(debug, debug|release): LIBS = -L$$OUT_PWD/../lib/debug -lcodetextlint
+win32:CONFIG(release, debug|release): LIBS = -L$$OUT_PWD/../lib/release -lcodetextlint
+
+HEADERS += \
+    ../../TestAnnotator.h \
+
+SOURCES += \
+    ../../TestAnnotator.cpp \
+    main.cpp \
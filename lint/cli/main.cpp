@@ -0,0 +1,320 @@
+#include "codetextedit/LineIndex.h"
+#include "codetextedit/LintEngine.h"
+#include "codetextedit/RuleAnnotator.h"
+#include "TestAnnotator.h"
+
+#include <QCoreApplication>
+#include <QCommandLineParser>
+#include <QDirIterator>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QFileInfo>
+#include <QTextStream>
+#include <QThread>
+
+#include <algorithm>
+#include <functional>
+#include <limits>
+
+using namespace codetextedit;
+
+class TestAnnotatorFactory : public AnnotatorFactory
+{
+public:
+    Annotator* createAnnotator() override {return new TestAnnotator;}
+};
+
+class RuleAnnotatorFactory : public AnnotatorFactory
+{
+public:
+    explicit RuleAnnotatorFactory(QSharedPointer<const RuleSet> rules) : m_rules(rules) {}
+    Annotator* createAnnotator() override {return new RuleAnnotator(m_rules);}
+
+private:
+    QSharedPointer<const RuleSet> m_rules;
+};
+
+static const char* categoryName(Annotation::Category category)
+{
+    switch(category) {
+    case Annotation::CATEGORY_Error:        return "error";
+    case Annotation::CATEGORY_Warning:      return "warning";
+    case Annotation::CATEGORY_Hint:         return "hint";
+    case Annotation::CATEGORY_Unspecified:  break;
+    }
+    return "note";
+}
+
+// Directories are searched recursively, in name order so runs compare.
+static QStringList expandPaths(const QStringList& paths)
+{
+    QStringList files;
+    for(const QString& path : paths) {
+        if(! QFileInfo(path).isDir()) {
+            files.append(path);
+            continue;
+        }
+
+        QStringList found;
+        QDirIterator it(path, QDir::Files, QDirIterator::Subdirectories);
+        while(it.hasNext())
+            found.append(it.next());
+        std::sort(found.begin(), found.end());
+        files += found;
+    }
+    return files;
+}
+
+// Times TestAnnotator's hand written checks against the rule set on the same lines, in
+// memory so only the matching is measured. The best of several rounds is reported.
+static int benchmark(const QStringList& files, const RuleSet& rules, QTextStream& err)
+{
+    static const int rounds = 5;
+
+    QStringList lines;
+    for(const QString& path : files) {
+        QFile file(path);
+        if(! file.open(QFile::ReadOnly | QFile::Text)) {
+            err << path << ": " << file.errorString() << endl;
+            return 1;
+        }
+        QString text = QString::fromUtf8(file.readAll());
+        LineIndex index;
+        index.build(text.constData(), text.size());
+        lines += index.lines(text);
+    }
+    if(lines.isEmpty())
+        return 1;
+
+    auto run = [&lines](const std::function<int(const QString&)>& scan, int& annotations) {
+        qint64 best = std::numeric_limits<qint64>::max();
+        for(int round = 0; round < rounds; ++round) {
+            QElapsedTimer timer;
+            timer.start();
+            annotations = 0;
+            for(const QString& line : lines)
+                annotations += scan(line);
+            best = qMin(best, timer.nsecsElapsed());
+        }
+        return best;
+    };
+
+    TestAnnotator annotator;
+    int handCount = 0;
+    qint64 handNsecs = run([&annotator](const QString& line) {
+        AnnotationContainer container = annotator.scanLine(line);
+        qDeleteAll(container);
+        return container.size();
+    }, handCount);
+
+    int ruleCount = 0;
+    AnnotationContainer container;
+    qint64 ruleNsecs = run([&rules, &container](const QString& line) {
+        container.clear();
+        rules.scanLine(line, container);
+        qDeleteAll(container);
+        return container.size();
+    }, ruleCount);
+
+    auto report = [&err, &lines](const char* name, qint64 nsecs, int annotations) {
+        err << name << QString::number(double(nsecs) / lines.size(), 'f', 1) << " ns/line, "
+            << qint64(lines.size() / qMax(nsecs / 1e9, 1e-9)) << " lines/s, "
+            << annotations << " annotations" << endl;
+    };
+    err << lines.size() << " lines, best of " << rounds << " rounds" << endl;
+    report("TestAnnotator: ", handNsecs, handCount);
+    report("Rule set:      ", ruleNsecs, ruleCount);
+    err << "Speedup: " << QString::number(double(handNsecs) / qMax<qint64>(ruleNsecs, 1), 'f', 2) << "x" << endl;
+    return 0;
+}
+
+// Best time of a few rounds of work, in nanoseconds.
+static qint64 bestOf(int rounds, const std::function<void()>& work)
+{
+    qint64 best = std::numeric_limits<qint64>::max();
+    for(int round = 0; round < rounds; ++round) {
+        QElapsedTimer timer;
+        timer.start();
+        work();
+        best = qMin(best, timer.nsecsElapsed());
+    }
+    return best;
+}
+
+// Times line and field splitting on each file. The file is memory mapped and indexed as
+// UTF-8 in place, so files of several GB work. Files a QString can hold are also decoded
+// and split the QString::split() way and the LineIndex way, for comparison.
+static int benchmarkLines(const QStringList& files, QTextStream& err)
+{
+    static const int rounds = 3;
+    static const qint64 maxStringBytes = qint64(1) << 30;
+
+    auto rate = [](qint64 bytes, qint64 nsecs) {
+        return QString::number(bytes / qMax(nsecs / 1e9, 1e-9) / 1e9, 'f', 2) + " GB/s";
+    };
+
+    for(const QString& path : files) {
+        QFile file(path);
+        if(! file.open(QFile::ReadOnly)) {
+            err << path << ": " << file.errorString() << endl;
+            return 1;
+        }
+        qint64 size = file.size();
+        const uchar* data = size > 0 ? file.map(0, size) : nullptr;
+        if(size > 0 && data == nullptr) {
+            err << path << ": " << file.errorString() << endl;
+            return 1;
+        }
+
+        LineIndex index;
+        qint64 mappedNsecs = bestOf(rounds, [&]() {index.build(reinterpret_cast<const char*>(data), size);});
+        err << path << ": " << QString::number(size / 1e9, 'f', 3) << " GB, " << index.lineCount() << " lines" << endl;
+        err << "  LineIndex, mapped UTF-8:   " << rate(size, mappedNsecs) << endl;
+
+        if(size > maxStringBytes) {
+            err << "  Too large for a QString, the decoding comparisons are skipped" << endl;
+            continue;
+        }
+
+        QString text = QString::fromUtf8(reinterpret_cast<const char*>(data), int(size));
+        int splitCount = 0;
+        qint64 splitNsecs = bestOf(rounds, [&]() {splitCount = text.split('\n').size();});
+        qint64 indexNsecs = bestOf(rounds, [&]() {index.build(text.constData(), text.size());});
+        err << "  QString::split('\\n'):      " << rate(size, splitNsecs) << ", " << splitCount << " lines" << endl;
+        err << "  LineIndex, UTF-16:         " << rate(size, indexNsecs) << ", " << index.lineCount() << " lines" << endl;
+
+        // The field splitting an annotator does on every line.
+        int fieldCount = 0;
+        qint64 splitFieldsNsecs = bestOf(rounds, [&]() {
+            fieldCount = 0;
+            for(int i = 0; i < index.lineCount(); ++i)
+                fieldCount += index.line(text, i).toString().split(',').size();
+        });
+        QVector<QStringRef> fields;
+        QString line;
+        qint64 viewFieldsNsecs = bestOf(rounds, [&]() {
+            fieldCount = 0;
+            for(int i = 0; i < index.lineCount(); ++i) {
+                QStringRef view = index.line(text, i);
+                line.setRawData(view.unicode(), view.size());
+                splitFields(line, ',', fields);
+                fieldCount += fields.size();
+            }
+        });
+        err << "  Fields, QString::split():  " << rate(size, splitFieldsNsecs) << endl;
+        err << "  Fields, splitFields():     " << rate(size, viewFieldsNsecs) << ", " << fieldCount << " fields" << endl;
+    }
+    return 0;
+}
+
+int main(int argc, char *argv[])
+{
+    // A core application only, so no display is needed.
+    QCoreApplication app(argc, argv);
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Lints scripts with TestAnnotator or a rules file, and the keyword checks.");
+    parser.addHelpOption();
+    QCommandLineOption jobsOption({"j", "jobs"}, "Files analyzed in parallel, the number of cores by default.", "count");
+    QCommandLineOption keywordsOption({"k", "keywords"}, "JSON keywords file, unknown commands are errors.", "file");
+    QCommandLineOption rulesOption({"r", "rules"}, "JSON rules file, used instead of TestAnnotator.", "file");
+    QCommandLineOption benchmarkOption("benchmark", "Time TestAnnotator against the rules file instead of linting.");
+    QCommandLineOption benchmarkLinesOption("benchmark-lines", "Time line and field splitting on the files instead of linting.");
+    parser.addOption(jobsOption);
+    parser.addOption(keywordsOption);
+    parser.addOption(rulesOption);
+    parser.addOption(benchmarkOption);
+    parser.addOption(benchmarkLinesOption);
+    parser.addPositionalArgument("paths", "Files or directories to lint.", "<paths...>");
+    parser.process(app);
+
+    QTextStream out(stdout);
+    QTextStream err(stderr);
+
+    QStringList files = expandPaths(parser.positionalArguments());
+    if(files.isEmpty())
+        parser.showHelp(1);
+
+    Keywords keywords;
+    bool haveKeywords = parser.isSet(keywordsOption);
+    if(haveKeywords) {
+        QString error;
+        if(! loadKeywords(parser.value(keywordsOption), keywords, &error)) {
+            err << parser.value(keywordsOption) << ": " << error << endl;
+            return 2;
+        }
+    }
+
+    if(parser.isSet(benchmarkLinesOption))
+        return benchmarkLines(files, err);
+
+    QSharedPointer<RuleSet> rules;
+    if(parser.isSet(rulesOption)) {
+        rules.reset(new RuleSet);
+        QString error;
+        if(! rules->load(parser.value(rulesOption), &error)) {
+            err << parser.value(rulesOption) << ": " << error << endl;
+            return 2;
+        }
+    }
+
+    if(parser.isSet(benchmarkOption)) {
+        if(rules.isNull()) {
+            err << "--benchmark needs --rules" << endl;
+            return 2;
+        }
+        return benchmark(files, *rules, err);
+    }
+
+    TestAnnotatorFactory testFactory;
+    RuleAnnotatorFactory ruleFactory(rules);
+    AnnotatorFactory* factory = rules.isNull() ? static_cast<AnnotatorFactory*>(&testFactory) : &ruleFactory;
+    LintEngine engine(factory);
+    engine.setKeywords(haveKeywords ? &keywords : nullptr);
+    engine.setJobs(parser.isSet(jobsOption) ? parser.value(jobsOption).toInt() : QThread::idealThreadCount());
+
+    // Diagnostics go to stdout as each file finishes, timings to stderr.
+    QObject::connect(&engine, &LintEngine::fileLinted, [&out, &err](const LintFileResult& result) {
+        if(! result.readOk) {
+            out << result.filePath << ": error: " << result.error << endl;
+            return;
+        }
+
+        for(const LintDiagnostic& diagnostic : result.diagnostics) {
+            out << result.filePath << ':' << diagnostic.line + 1 << ':' << diagnostic.column + 1 << ": "
+                << categoryName(diagnostic.category) << ": " << diagnostic.message;
+            if(! diagnostic.helpKey.isEmpty())
+                out << " [" << diagnostic.helpKey << ']';
+            out << '\n';
+        }
+        out.flush();
+
+        err << result.filePath << ": " << result.lineCount << " lines in "
+            << QString::number(result.nsecs / 1e6, 'f', 2) << " ms" << endl;
+    });
+
+    int status = 0;
+    QObject::connect(&engine, &LintEngine::finished, [&app, &err, &status](const LintSummary& summary) {
+        double wallSecs = qMax(summary.wallNsecs / 1e9, 1e-9);
+        err << summary.files << " files";
+        if(summary.failedFiles > 0)
+            err << " (" << summary.failedFiles << " unreadable)";
+        err << ", " << summary.lines << " lines, "
+            << QString::number(summary.bytes / 1e6, 'f', 1) << " MB in "
+            << QString::number(summary.wallNsecs / 1e6, 'f', 1) << " ms ("
+            << QString::number(summary.cpuNsecs / 1e6, 'f', 1) << " ms in jobs), "
+            << QString::number(summary.bytes / 1e6 / wallSecs, 'f', 1) << " MB/s, "
+            << qint64(summary.lines / wallSecs) << " lines/s" << endl;
+        err << summary.diagnostics[Annotation::CATEGORY_Error] << " errors, "
+            << summary.diagnostics[Annotation::CATEGORY_Warning] << " warnings, "
+            << summary.diagnostics[Annotation::CATEGORY_Hint] << " hints, "
+            << summary.diagnostics[Annotation::CATEGORY_Unspecified] << " notes" << endl;
+
+        status = summary.failedFiles > 0 || summary.diagnostics[Annotation::CATEGORY_Error] > 0 ? 1 : 0;
+        app.quit();
+    });
+
+    engine.lint(files);
+    app.exec();
+    return status;
+}
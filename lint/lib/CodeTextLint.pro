@@ -0,0 +1,7 @@
+# CodeTextEdit's annotator and keyword checks without widgets.
+TEMPLATE = lib
+TARGET = codetextlint
+CONFIG += staticlib c++11
+QT -= widgets
+
+include(../../codetextedit/CodeTextLint.pri)
@@ -0,0 +1,11 @@
+# Headless linting: the engine as a library and a command line tool using it.
+TEMPLATE = subdirs
+
+SUBDIRS += \
+    lib \
+    cli \
+
+# The project files are not named after their directories.
+lib.file = lib/CodeTextLint.pro
+cli.file = cli/TestLint.pro
+cli.depends = lib
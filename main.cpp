@@ -1,5 +1,7 @@
 #include "codetextedit/AnnotationEdit.h"
 #include "TestAnnotator.h"
+#include "codetextedit/RemoteAnnotator.h"
+#include "codetextedit/RuleAnnotator.h"
 
 #include <QApplication>
 #include <QMainWindow>
@@ -22,19 +24,60 @@ int main(int argc, char *argv[])
     QFontDatabase::addApplicationFont(":/fonts/SourceCodePro-Bold.ttf");
     QFontDatabase::addApplicationFont(":/fonts/SourceCodePro-BoldItalic.ttf");
 
-    TestAnnotator *annotator = new TestAnnotator;
+    // "--remote-annotator <helper>" runs the analysis out of process, e.g. in TestAnnotatorHost.
+    // "--rules <file>" annotates with a rules file such as TestRules.json.
+    // "--profile <report>" times the analysis of every line and writes the report on exit.
+    Annotator *annotator = nullptr;
+    TestAnnotator helpTexts;
+    int remoteIndex = app.arguments().indexOf("--remote-annotator");
+    int rulesIndex = app.arguments().indexOf("--rules");
+    if (remoteIndex != -1 && remoteIndex + 1 < app.arguments().size())
+    {
+        RemoteAnnotator *remote = new RemoteAnnotator(app.arguments()[remoteIndex + 1]);
+        remote->setVersion("remote-1");
+        annotator = remote;
+    }
+    else if (rulesIndex != -1 && rulesIndex + 1 < app.arguments().size())
+    {
+        QSharedPointer<RuleSet> rules(new RuleSet);
+        QString error;
+        if (!rules->load(app.arguments()[rulesIndex + 1], &error))
+        {
+            qWarning("%s: %s", qPrintable(app.arguments()[rulesIndex + 1]), qPrintable(error));
+            return 2;
+        }
+        annotator = new RuleAnnotator(rules);
+    }
+    else
+    {
+        annotator = new TestAnnotator;
+    }
+
     CodeTextHighlighter *highlighter = new CodeTextHighlighter;
     highlighter->setKeywords(&TestKeywords_0);
 
     AnnotationEdit *editor = new AnnotationEdit(annotator, highlighter);
+    // Help keys come back from the helper, the texts are looked up locally.
+    if (remoteIndex != -1)
+        editor->setSolutionHelpProvider(&helpTexts);
     editor->setContents(
         "XX,1   AA,1,2,4\n"
         "YY,4   BB,1,2,8\n");
+    int profileIndex = app.arguments().indexOf("--profile");
+    if (profileIndex != -1 && profileIndex + 1 < app.arguments().size())
+        editor->setProfilingEnabled(true);
     editor->show();
     editor->setGeometry(50, 50, 800, 500);
 
     auto status = app.exec();
 
+    if (editor->isProfilingEnabled())
+    {
+        QString error;
+        if (!editor->exportProfile(app.arguments()[profileIndex + 1], &error))
+            qWarning("%s: %s", qPrintable(app.arguments()[profileIndex + 1]), qPrintable(error));
+    }
+
     delete editor;
     delete annotator;
     delete highlighter;
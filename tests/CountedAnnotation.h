@@ -0,0 +1,35 @@
+/***********************************************************************
+The CodeTextEditor provides an editor showing live hints and annotations.
+
+Copyright (c) 2020 Brian Newham <seaweedsolutionsltd@gmail.com>.
+
+CodeTextEdit is free software dual licensed under the GNU LGPL or MIT License.
+***********************************************************************/
+
+#ifndef COUNTEDANNOTATION_H
+#define COUNTEDANNOTATION_H
+
+#include <QAtomicInt>
+
+#include "codetextedit/Annotation.h"
+
+///
+/// \brief Annotation which counts its live instances, so tests see which ones were deleted.
+///
+class CountedAnnotation : public codetextedit::Annotation
+{
+public:
+    CountedAnnotation() {counter().ref();}
+    ~CountedAnnotation() override {counter().deref();}
+
+    static int live() {return counter().loadAcquire();}
+
+private:
+    static QAtomicInt& counter()
+    {
+        static QAtomicInt count;
+        return count;
+    }
+};
+
+#endif // COUNTEDANNOTATION_H
@@ -0,0 +1,38 @@
+/***********************************************************************
+The CodeTextEditor provides an editor showing live hints and annotations.
+
+Copyright (c) 2020 Brian Newham <seaweedsolutionsltd@gmail.com>.
+
+CodeTextEdit is free software dual licensed under the GNU LGPL or MIT License.
+***********************************************************************/
+
+#ifndef RANDOMROUNDS_H
+#define RANDOMROUNDS_H
+
+#include <QtTest>
+#include <QRandomGenerator>
+
+/// Seed of every randomized test, so a failing round fails the same way on any machine.
+static const quint32 randomSeed = 2020;
+
+///
+/// \brief Runs a randomized test as rounds sharing one generator seeded with randomSeed.
+///
+/// Each round makes its random changes to the code under test and to a plain model of
+/// it, then compares the two with QCOMPARE or QVERIFY. The first failing round ends the
+/// test and its number is reported.
+///
+template<typename Round>
+void runRandomRounds(int rounds, Round round)
+{
+    QRandomGenerator random(randomSeed);
+    for(int i = 0; i < rounds; ++i) {
+        round(random);
+        if(QTest::currentTestFailed()) {
+            qWarning("Failed in random round %d of %d", i + 1, rounds);
+            return;
+        }
+    }
+}
+
+#endif // RANDOMROUNDS_H
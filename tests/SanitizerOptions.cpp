@@ -0,0 +1,33 @@
+/***********************************************************************
+The CodeTextEditor provides an editor showing live hints and annotations.
+
+Copyright (c) 2020 Brian Newham <seaweedsolutionsltd@gmail.com>.
+
+CodeTextEdit is free software dual licensed under the GNU LGPL or MIT License.
+***********************************************************************/
+
+// Defaults the sanitizers read at start up, so "make check" and a test started by hand
+// both check for leaks. ASAN_OPTIONS and UBSAN_OPTIONS still override them. Only built
+// where tests.pri turns the sanitizers on.
+
+extern "C" const char* __asan_default_options()
+{
+#ifdef __linux__
+    return "detect_leaks=1";
+#else
+    // LeakSanitizer is not part of the macOS toolchain, asking for it aborts the test.
+    return "";
+#endif
+}
+
+// Font configuration is cached for the life of the process, the widget tests would
+// otherwise report it.
+extern "C" const char* __lsan_default_suppressions()
+{
+    return "leak:libfontconfig\n";
+}
+
+extern "C" const char* __ubsan_default_options()
+{
+    return "print_stacktrace=1";
+}
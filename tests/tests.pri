@@ -0,0 +1,22 @@
+# Settings shared by the unit tests.
+#
+# On Linux and macOS they are built with AddressSanitizer and UndefinedBehaviorSanitizer,
+# and on Linux run with leak checking, so an annotation deleted twice or never fails the
+# test that lost it. MinGW and MSVC have no runtimes for them and build the tests plain.
+QT += testlib
+QT -= widgets
+CONFIG += c++11 console testcase
+CONFIG -= app_bundle
+
+INCLUDEPATH += $$PWD/.. $$PWD
+
+linux|macx {
+    QMAKE_CXXFLAGS += -fsanitize=address,undefined -fno-sanitize-recover=undefined -fno-omit-frame-pointer
+    QMAKE_LFLAGS += -fsanitize=address,undefined
+
+    SOURCES += $$PWD/SanitizerOptions.cpp
+}
+
+HEADERS += \
+    $$PWD/CountedAnnotation.h \
+    $$PWD/RandomRounds.h \
@@ -0,0 +1,17 @@
+# Unit tests, one QtTest executable each. "make check" builds and runs them.
+TEMPLATE = subdirs
+
+SUBDIRS += \
+    tst_annotationedit \
+    tst_annotationresult \
+    tst_annotationsummarytree \
+    tst_annotationworker \
+    tst_blockheightindex \
+    tst_keywordscanner \
+    tst_linediff \
+    tst_lineindex \
+    tst_lintengine \
+    tst_patternautomaton \
+    tst_ruleset \
+    tst_substringsearch \
+    tst_symbolindex \
@@ -0,0 +1,137 @@
+/***********************************************************************
+The CodeTextEditor provides an editor showing live hints and annotations.
+
+Copyright (c) 2020 Brian Newham <seaweedsolutionsltd@gmail.com>.
+
+CodeTextEdit is free software dual licensed under the GNU LGPL or MIT License.
+***********************************************************************/
+
+#include <QtTest>
+#include <QApplication>
+#include <QTemporaryDir>
+
+#include "codetextedit/AnnotationEdit.h"
+#include "codetextedit/AnnotationTextEdit.h"
+#include "codetextedit/CodeTextHighlighter.h"
+
+using namespace codetextedit;
+
+///
+/// \brief Annotator finding nothing, the tests only need the editor's document.
+///
+class NullAnnotator : public Annotator
+{
+public:
+    using Annotator::prepareAnalysis;
+    void prepareAnalysis(QStringList /*lines*/) override {}
+    bool analyzeStep() override {return false;}
+    AnnotationMap analysisResult() override {return AnnotationMap();}
+};
+
+class tst_AnnotationEdit : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void replacingDocumentCancelsSave_data();
+    void replacingDocumentCancelsSave();
+};
+
+static void writeFile(const QString& filePath, const QByteArray& contents)
+{
+    QFile file(filePath);
+    QVERIFY(file.open(QFile::WriteOnly));
+    QCOMPARE(file.write(contents), qint64(contents.size()));
+}
+
+static QByteArray readFile(const QString& filePath)
+{
+    QFile file(filePath);
+    return file.open(QFile::ReadOnly) ? file.readAll() : QByteArray();
+}
+
+/// Text taking several save chunks, so the save is still reading it when saveFile() returns.
+static QString longText()
+{
+    QStringList lines;
+    for(int i = 0; i < 8000; ++i)
+        lines.append(QString("XX,%1   AA,1,2,4   BB,1,2,8   CC,3,4,5,6,7").arg(i));
+    return lines.join('\n');
+}
+
+void tst_AnnotationEdit::replacingDocumentCancelsSave_data()
+{
+    QTest::addColumn<QString>("call");
+
+    for(const char* call : {"setPlainText", "setContents", "loadFile", "beginBulkEdit"})
+        QTest::newRow(call) << QString(call);
+}
+
+void tst_AnnotationEdit::replacingDocumentCancelsSave()
+{
+    QFETCH(QString, call);
+
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+    const QString target = QFileInfo(dir.filePath("target.txt")).absoluteFilePath();
+    const QString other = dir.filePath("other.txt");
+    writeFile(target, "on disk\n");
+    writeFile(other, "other\n");
+
+    NullAnnotator annotator;
+    CodeTextHighlighter highlighter;
+    AnnotationEdit edit(&annotator, &highlighter);
+    AnnotationTextEdit* textEdit = edit.findChild<AnnotationTextEdit*>();
+    QVERIFY(textEdit != nullptr);
+    edit.setPlainText(longText());
+
+    QSignalSpy saved(&edit, &AnnotationEdit::fileSaved);
+    QSignalSpy failed(&edit, &AnnotationEdit::saveFailed);
+    QVERIFY(edit.saveFile(target));
+    QVERIFY(edit.isSaving());
+    QVERIFY(textEdit->isReadOnly());
+
+    if(call == "setPlainText")
+        edit.setPlainText("replaced");
+    else if(call == "setContents")
+        edit.setContents("replaced");
+    else if(call == "loadFile")
+        edit.loadFile(other);
+    else
+        edit.beginBulkEdit();
+
+    // Cancelled before the blocks it was reading went away.
+    QVERIFY(!edit.isSaving());
+    QVERIFY(!textEdit->isReadOnly());
+    QCOMPARE(failed.count(), 1);
+    QCOMPARE(failed.at(0).at(0).toString(), target);
+
+    // The chunks it had scheduled find nothing to do, and the file keeps its contents.
+    QTest::qWait(100);
+    QCOMPARE(saved.count(), 0);
+    QCOMPARE(failed.count(), 1);
+    QCOMPARE(readFile(target), QByteArray("on disk\n"));
+
+    if(call == "beginBulkEdit")
+        edit.endBulkEdit();
+
+    // A new save writes the document as it is now.
+    QByteArray expected = edit.toPlainText().toUtf8();
+    QVERIFY(edit.saveFile(target));
+    QTRY_COMPARE(saved.count(), 1);
+    QCOMPARE(failed.count(), 1);
+    QCOMPARE(readFile(target), expected);
+}
+
+int main(int argc, char *argv[])
+{
+    // No display needed, e.g. for "make check" on a build server.
+    if(qEnvironmentVariableIsEmpty("QT_QPA_PLATFORM"))
+        qputenv("QT_QPA_PLATFORM", "offscreen");
+
+    QApplication app(argc, argv);
+    tst_AnnotationEdit test;
+    return QTest::qExec(&test, argc, argv);
+}
+
+#include "tst_annotationedit.moc"
@@ -0,0 +1,11 @@
+# AnnotationEdit saving while the document is replaced. Runs on the offscreen platform
+# unless QT_QPA_PLATFORM asks for another.
+include(../tests.pri)
+include(../../codetextedit/CodeTextEdit.pri)
+
+QT += widgets
+
+TARGET = tst_annotationedit
+
+SOURCES += \
+    tst_annotationedit.cpp \
@@ -0,0 +1,141 @@
+/***********************************************************************
+The CodeTextEditor provides an editor showing live hints and annotations.
+
+Copyright (c) 2020 Brian Newham <seaweedsolutionsltd@gmail.com>.
+
+CodeTextEdit is free software dual licensed under the GNU LGPL or MIT License.
+***********************************************************************/
+
+#include <QtTest>
+
+#include <utility>
+
+#include "codetextedit/AnnotationResult.h"
+#include "CountedAnnotation.h"
+
+using namespace codetextedit;
+
+class tst_AnnotationResult : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void cleanup();
+
+    void deletesOnDestruction();
+    void moveConstructLeavesEmptySource();
+    void moveAssignDeletesTarget();
+    void releaseHandsOwnershipOn();
+    void adoptMergesLines();
+};
+
+static AnnotationContainer annotations(int count)
+{
+    AnnotationContainer container;
+    for(int i = 0; i < count; ++i)
+        container.append(new CountedAnnotation);
+    return container;
+}
+
+void tst_AnnotationResult::cleanup()
+{
+    QCOMPARE(CountedAnnotation::live(), 0);
+}
+
+void tst_AnnotationResult::deletesOnDestruction()
+{
+    {
+        AnnotationResult result(1);
+        result.insert(3, annotations(2));
+        result.insert(3, annotations(1));
+        QCOMPARE(result.line(3).size(), 3);
+        QCOMPARE(CountedAnnotation::live(), 3);
+    }
+    QCOMPARE(CountedAnnotation::live(), 0);
+}
+
+void tst_AnnotationResult::moveConstructLeavesEmptySource()
+{
+    AnnotationResult source(4);
+    source.insert(1, annotations(2));
+    source.addLineCost(1, 100);
+    source.setLineRanges({qMakePair(1, 2)});
+
+    AnnotationResult target(std::move(source));
+    QCOMPARE(target.revision(), 4);
+    QCOMPARE(target.line(1).size(), 2);
+    QCOMPARE(target.lineCosts().size(), 1);
+    QVERIFY(target.isPartial());
+
+    QCOMPARE(source.revision(), -1);
+    QVERIFY(source.isEmpty());
+    QVERIFY(source.lineCosts().isEmpty());
+    QVERIFY(!source.isPartial());
+
+    // Neither may touch the annotations the target owns now.
+    source.clear();
+    QVERIFY(source.release().isEmpty());
+    QCOMPARE(CountedAnnotation::live(), 2);
+    QCOMPARE(target.line(1).size(), 2);
+}
+
+void tst_AnnotationResult::moveAssignDeletesTarget()
+{
+    AnnotationResult source(2);
+    source.insert(5, annotations(1));
+
+    AnnotationResult target(1);
+    target.insert(0, annotations(3));
+    target.addLineCost(0, 10);
+
+    target = std::move(source);
+    QCOMPARE(CountedAnnotation::live(), 1);
+    QCOMPARE(target.revision(), 2);
+    QVERIFY(target.line(0).isEmpty());
+    QCOMPARE(target.line(5).size(), 1);
+    QVERIFY(target.lineCosts().isEmpty());
+
+    QCOMPARE(source.revision(), -1);
+    QVERIFY(source.release().isEmpty());
+    source.clear();
+    QCOMPARE(CountedAnnotation::live(), 1);
+
+    // A moved from result takes new annotations like a fresh one.
+    source.insert(7, annotations(2));
+    QCOMPARE(CountedAnnotation::live(), 3);
+}
+
+void tst_AnnotationResult::releaseHandsOwnershipOn()
+{
+    AnnotationMap released;
+    {
+        AnnotationResult result(1);
+        result.insert(2, annotations(2));
+        released = result.release();
+        QVERIFY(result.isEmpty());
+    }
+    QCOMPARE(CountedAnnotation::live(), 2);
+
+    for(const AnnotationContainer& container : qAsConst(released))
+        qDeleteAll(container);
+}
+
+void tst_AnnotationResult::adoptMergesLines()
+{
+    AnnotationResult result(1);
+    result.insert(1, annotations(1));
+
+    AnnotationMap map;
+    map[1] = annotations(2);
+    map[4] = annotations(1);
+    result.adopt(map);
+
+    QVERIFY(map.isEmpty());
+    QCOMPARE(result.line(1).size(), 3);
+    QCOMPARE(result.line(4).size(), 1);
+    QCOMPARE(CountedAnnotation::live(), 4);
+}
+
+QTEST_GUILESS_MAIN(tst_AnnotationResult)
+
+#include "tst_annotationresult.moc"
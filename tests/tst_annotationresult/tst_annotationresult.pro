@@ -0,0 +1,12 @@
+# AnnotationResult ownership across moves, clear() and release().
+include(../tests.pri)
+
+TARGET = tst_annotationresult
+
+HEADERS += \
+    ../../codetextedit/Annotation.h \
+    ../../codetextedit/AnnotationResult.h \
+
+SOURCES += \
+    ../../codetextedit/AnnotationResult.cpp \
+    tst_annotationresult.cpp \
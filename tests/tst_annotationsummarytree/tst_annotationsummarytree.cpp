@@ -0,0 +1,212 @@
+/***********************************************************************
+The CodeTextEditor provides an editor showing live hints and annotations.
+
+Copyright (c) 2020 Brian Newham <seaweedsolutionsltd@gmail.com>.
+
+CodeTextEdit is free software dual licensed under the GNU LGPL or MIT License.
+***********************************************************************/
+
+#include <QtTest>
+
+#include "codetextedit/AnnotationSummaryTree.h"
+#include "RandomRounds.h"
+
+using namespace codetextedit;
+
+using Summary = AnnotationSummaryTree::Summary;
+
+class tst_AnnotationSummaryTree : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void initTestCase();
+    void emptyTree();
+    void setLineAndSum();
+    void clampsRanges();
+    void replaceLines();
+    void matchesLinearSums();
+
+private:
+    /// Container with the given number of annotations of each category.
+    AnnotationContainer annotations(int unspecified, int hints, int warnings, int errors);
+
+    Annotation m_annotations[AnnotationSummaryTree::categoryCount];
+};
+
+/// Counts of lines [first, end) added one line at a time.
+static Summary linearSum(const QVector<Summary>& lines, int first, int end)
+{
+    Summary sum;
+    for(int line = qMax(first, 0); line < qMin(end, lines.size()); ++line)
+        sum.add(lines[line]);
+    return sum;
+}
+
+static bool sameCounts(const Summary& a, const Summary& b)
+{
+    for(int category = 0; category < AnnotationSummaryTree::categoryCount; ++category) {
+        if(a.counts[category] != b.counts[category])
+            return false;
+    }
+    return true;
+}
+
+void tst_AnnotationSummaryTree::initTestCase()
+{
+    for(int category = 0; category < AnnotationSummaryTree::categoryCount; ++category)
+        m_annotations[category].setCategory(Annotation::Category(category));
+}
+
+AnnotationContainer tst_AnnotationSummaryTree::annotations(int unspecified, int hints, int warnings, int errors)
+{
+    const int counts[] = {unspecified, hints, warnings, errors};
+    AnnotationContainer container;
+    for(int category = 0; category < AnnotationSummaryTree::categoryCount; ++category) {
+        for(int i = 0; i < counts[category]; ++i)
+            container += &m_annotations[category];
+    }
+    return container;
+}
+
+void tst_AnnotationSummaryTree::emptyTree()
+{
+    AnnotationSummaryTree tree;
+    QCOMPARE(tree.count(), 0);
+    QCOMPARE(tree.summary(0, 5).total(), 0u);
+    QCOMPARE(tree.summary(0, 5).worstCategory(), -1);
+
+    tree.setLine(0, annotations(0, 1, 0, 0));
+    QCOMPARE(tree.summary(0, 1).total(), 0u);
+
+    tree.replaceLines(0, 0, 3);
+    QCOMPARE(tree.count(), 3);
+    QCOMPARE(tree.summary(0, 3).total(), 0u);
+}
+
+void tst_AnnotationSummaryTree::setLineAndSum()
+{
+    AnnotationSummaryTree tree;
+    tree.reset(5);
+    tree.setLine(1, annotations(0, 1, 0, 1));
+    tree.setLine(3, annotations(1, 0, 2, 0));
+
+    Summary all = tree.summary(0, 5);
+    QCOMPARE(all.total(), 5u);
+    QCOMPARE(all.counts[Annotation::CATEGORY_Unspecified], 1u);
+    QCOMPARE(all.counts[Annotation::CATEGORY_Hint], 1u);
+    QCOMPARE(all.counts[Annotation::CATEGORY_Warning], 2u);
+    QCOMPARE(all.counts[Annotation::CATEGORY_Error], 1u);
+    QCOMPARE(all.worstCategory(), int(Annotation::CATEGORY_Error));
+
+    QCOMPARE(tree.summary(2, 4).total(), 3u);
+    QCOMPARE(tree.summary(2, 4).worstCategory(), int(Annotation::CATEGORY_Warning));
+    QCOMPARE(tree.summary(0, 1).worstCategory(), -1);
+    QCOMPARE(tree.summary(3, 3).total(), 0u);
+
+    // Setting a line replaces its counts rather than adding to them.
+    tree.setLine(1, annotations(0, 2, 0, 0));
+    QCOMPARE(tree.summary(0, 5).total(), 5u);
+    QCOMPARE(tree.summary(0, 5).counts[Annotation::CATEGORY_Error], 0u);
+    tree.setLine(1, AnnotationContainer());
+    QCOMPARE(tree.summary(0, 3).total(), 0u);
+}
+
+void tst_AnnotationSummaryTree::clampsRanges()
+{
+    AnnotationSummaryTree tree;
+    tree.reset(3);
+    tree.setLine(0, annotations(0, 1, 0, 0));
+    tree.setLine(2, annotations(0, 0, 0, 1));
+
+    tree.setLine(-1, annotations(0, 0, 1, 0));
+    tree.setLine(3, annotations(0, 0, 1, 0));
+    QCOMPARE(tree.summary(-5, 99).total(), 2u);
+    QCOMPARE(tree.summary(2, 1).total(), 0u);
+
+    tree.reset(-4);
+    QCOMPARE(tree.count(), 0);
+}
+
+void tst_AnnotationSummaryTree::replaceLines()
+{
+    AnnotationSummaryTree tree;
+    tree.reset(4);
+    tree.setLine(0, annotations(0, 1, 0, 0));
+    tree.setLine(1, annotations(0, 0, 1, 0));
+    tree.setLine(3, annotations(0, 0, 0, 1));
+
+    // One for one, the replaced line loses its annotations and the rest keep theirs.
+    tree.replaceLines(1, 1, 1);
+    QCOMPARE(tree.count(), 4);
+    QCOMPARE(tree.summary(0, 4).total(), 2u);
+    QCOMPARE(tree.summary(3, 4).worstCategory(), int(Annotation::CATEGORY_Error));
+
+    tree.replaceLines(1, 1, 3);
+    QCOMPARE(tree.count(), 6);
+    QCOMPARE(tree.summary(0, 1).total(), 1u);
+    QCOMPARE(tree.summary(5, 6).worstCategory(), int(Annotation::CATEGORY_Error));
+
+    tree.replaceLines(0, 1, 0);
+    QCOMPARE(tree.count(), 5);
+    QCOMPARE(tree.summary(0, 5).total(), 1u);
+    QCOMPARE(tree.summary(4, 5).total(), 1u);
+
+    // Clamped to the lines there are.
+    tree.replaceLines(10, 2, 1);
+    QCOMPARE(tree.count(), 6);
+    tree.replaceLines(3, 10, 0);
+    QCOMPARE(tree.count(), 3);
+    QCOMPARE(tree.summary(0, 3).total(), 0u);
+}
+
+void tst_AnnotationSummaryTree::matchesLinearSums()
+{
+    AnnotationSummaryTree tree;
+    QVector<Summary> lines;
+
+    tree.reset(29);
+    lines.fill(Summary(), 29);
+
+    runRandomRounds(2000, [&](QRandomGenerator& random) {
+        int operation = random.bounded(8);
+        if(operation == 0 && lines.size() < 200) {
+            int first = random.bounded(lines.size() + 1);
+            int removed = random.bounded(4);
+            int added = random.bounded(4);
+            tree.replaceLines(first, removed, added);
+            lines.remove(first, qMin(removed, lines.size() - first));
+            lines.insert(first, added, Summary());
+        }
+        else if(operation == 1 && !lines.isEmpty()) {
+            int first = random.bounded(lines.size());
+            int count = qMin(random.bounded(1, 4), lines.size() - first);
+            tree.replaceLines(first, count, count);
+            for(int line = first; line < first + count; ++line)
+                lines[line] = Summary();
+        }
+        else if(!lines.isEmpty()) {
+            int line = random.bounded(lines.size());
+            Summary summary;
+            for(int category = 0; category < AnnotationSummaryTree::categoryCount; ++category)
+                summary.counts[category] = random.bounded(3);
+            tree.setLine(line, annotations(summary.counts[0], summary.counts[1],
+                                           summary.counts[2], summary.counts[3]));
+            lines[line] = summary;
+        }
+
+        QCOMPARE(tree.count(), lines.size());
+        for(int probe = 0; probe < 8; ++probe) {
+            int first = random.bounded(lines.size() + 2) - 1;
+            int end = random.bounded(lines.size() + 2) - 1;
+            Summary expected = linearSum(lines, first, end);
+            Summary actual = tree.summary(first, end);
+            QVERIFY(sameCounts(actual, expected));
+            QCOMPARE(actual.worstCategory(), expected.worstCategory());
+        }
+    });
+}
+
+QTEST_GUILESS_MAIN(tst_AnnotationSummaryTree)
+
+#include "tst_annotationsummarytree.moc"
@@ -0,0 +1,12 @@
+# AnnotationSummaryTree range sums while lines are set, inserted and removed.
+include(../tests.pri)
+
+TARGET = tst_annotationsummarytree
+
+HEADERS += \
+    ../../codetextedit/Annotation.h \
+    ../../codetextedit/AnnotationSummaryTree.h \
+
+SOURCES += \
+    ../../codetextedit/AnnotationSummaryTree.cpp \
+    tst_annotationsummarytree.cpp \
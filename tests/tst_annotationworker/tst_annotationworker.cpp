@@ -0,0 +1,232 @@
+/***********************************************************************
+The CodeTextEditor provides an editor showing live hints and annotations.
+
+Copyright (c) 2020 Brian Newham <seaweedsolutionsltd@gmail.com>.
+
+CodeTextEdit is free software dual licensed under the GNU LGPL or MIT License.
+***********************************************************************/
+
+#include <QtTest>
+#include <QSemaphore>
+#include <QElapsedTimer>
+
+#include "codetextedit/AnnotationWorker.h"
+#include "CountedAnnotation.h"
+
+using namespace codetextedit;
+
+///
+/// \brief Gives every line one annotation, and can hold the worker inside a call.
+///
+/// Batched annotators implement analyzeRange(), the others only analyzeStep(). While the
+/// worker is held the test restarts or destroys it, which a real run is too quick for.
+///
+class FakeAnnotator : public Annotator
+{
+public:
+    explicit FakeAnnotator(bool batched) : m_batched(batched) {}
+
+    /// The next analyzeRange() or analyzeStep() releases entered and waits for proceed.
+    void holdNextCall() {m_hold.storeRelease(1);}
+
+    QSemaphore entered;
+    QSemaphore proceed;
+
+    /// Lines analyzed in each run. Read it once the worker published or went idle.
+    QVector<int> analyzed;
+
+    void prepareAnalysis(QStringList lines) override
+    {
+        m_lines = lines;
+        m_current = 0;
+        analyzed.append(0);
+    }
+
+    bool analyzeStep() override
+    {
+        hold();
+        m_map[m_current] = annotate();
+        ++analyzed.last();
+
+        ++m_current;
+        return m_current < m_lines.size();
+    }
+
+    bool analyzeRange(int /*first*/, int count, AnnotationContainer* results) override
+    {
+        if(!m_batched)
+            return false;
+
+        hold();
+        for(int i = 0; i < count; ++i)
+            results[i] = annotate();
+        analyzed.last() += count;
+        return true;
+    }
+
+    AnnotationMap analysisResult() override
+    {
+        AnnotationMap result;
+        result.swap(m_map);
+        return result;
+    }
+
+private:
+    void hold()
+    {
+        if(m_hold.testAndSetOrdered(1, 0)) {
+            entered.release();
+            proceed.acquire();
+        }
+    }
+
+    static AnnotationContainer annotate() {return AnnotationContainer{new CountedAnnotation};}
+
+    bool        m_batched;
+    QAtomicInt  m_hold;
+    QStringList m_lines;
+    int         m_current = 0;
+    AnnotationMap m_map;
+};
+
+class tst_AnnotationWorker : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void cleanup();
+
+    void cancelBatchedRun();
+    void cancelStepRun();
+    void replaceUntakenResult();
+    void destroyWithPendingResult();
+    void destroyDuringRun();
+};
+
+static const int waitMsecs = 5000;
+
+static QStringList lines(int count)
+{
+    QStringList lines;
+    for(int i = 0; i < count; ++i)
+        lines.append(QStringLiteral("XX,%1").arg(i));
+    return lines;
+}
+
+/// The worker's next result, or an empty one with revision -1 if none comes in time.
+static AnnotationResult nextResult(AnnotationWorker& worker)
+{
+    QElapsedTimer timer;
+    timer.start();
+    forever {
+        AnnotationResult result = worker.takeResult();
+        if(result.revision() != -1 || timer.elapsed() > waitMsecs)
+            return result;
+        QTest::qWait(5);
+    }
+}
+
+void tst_AnnotationWorker::cleanup()
+{
+    QCOMPARE(CountedAnnotation::live(), 0);
+}
+
+void tst_AnnotationWorker::cancelBatchedRun()
+{
+    FakeAnnotator annotator(true);
+    AnnotationWorker worker(&annotator);
+
+    annotator.holdNextCall();
+    worker.analyze(lines(1000), 1);
+    QVERIFY(annotator.entered.tryAcquire(1, waitMsecs));
+    worker.analyze(lines(1000), 2);
+    annotator.proceed.release();
+
+    AnnotationResult result = nextResult(worker);
+    QCOMPARE(result.revision(), 2);
+    QCOMPARE(result.annotations().size(), 1000);
+
+    // The first run stopped after the batch it was held in, and deleted what it had found.
+    QCOMPARE(annotator.analyzed.size(), 2);
+    QVERIFY(annotator.analyzed[0] < 1000);
+    QCOMPARE(annotator.analyzed[1], 1000);
+    QCOMPARE(CountedAnnotation::live(), 1000);
+}
+
+void tst_AnnotationWorker::cancelStepRun()
+{
+    FakeAnnotator annotator(false);
+    AnnotationWorker worker(&annotator);
+
+    annotator.holdNextCall();
+    worker.analyze(lines(1000), 1);
+    QVERIFY(annotator.entered.tryAcquire(1, waitMsecs));
+    worker.analyze(lines(1000), 2);
+    annotator.proceed.release();
+
+    AnnotationResult result = nextResult(worker);
+    QCOMPARE(result.revision(), 2);
+    QCOMPARE(result.annotations().size(), 1000);
+
+    // The partial result of the first run was taken from the annotator and deleted.
+    QCOMPARE(annotator.analyzed.size(), 2);
+    QVERIFY(annotator.analyzed[0] < 1000);
+    QCOMPARE(CountedAnnotation::live(), 1000);
+}
+
+void tst_AnnotationWorker::replaceUntakenResult()
+{
+    FakeAnnotator annotator(true);
+    AnnotationWorker worker(&annotator);
+    QAtomicInt published;
+    connect(&worker, &AnnotationWorker::resultReady, [&published]() {published.ref();});
+
+    worker.analyze(lines(10), 1);
+    QTRY_COMPARE_WITH_TIMEOUT(published.loadAcquire(), 1, waitMsecs);
+    worker.analyze(lines(20), 2);
+    QTRY_COMPARE_WITH_TIMEOUT(published.loadAcquire(), 2, waitMsecs);
+
+    // The first result was deleted when the second took its place.
+    QCOMPARE(CountedAnnotation::live(), 20);
+
+    AnnotationResult result = worker.takeResult();
+    QCOMPARE(result.revision(), 2);
+    QCOMPARE(result.annotations().size(), 20);
+    QCOMPARE(worker.takeResult().revision(), -1);
+}
+
+void tst_AnnotationWorker::destroyWithPendingResult()
+{
+    FakeAnnotator annotator(true);
+    AnnotationWorker* worker = new AnnotationWorker(&annotator);
+    QAtomicInt published;
+    connect(worker, &AnnotationWorker::resultReady, [&published]() {published.ref();});
+
+    worker->analyze(lines(10), 1);
+    QTRY_COMPARE_WITH_TIMEOUT(published.loadAcquire(), 1, waitMsecs);
+    QCOMPARE(CountedAnnotation::live(), 10);
+
+    delete worker;
+    QCOMPARE(CountedAnnotation::live(), 0);
+}
+
+void tst_AnnotationWorker::destroyDuringRun()
+{
+    FakeAnnotator annotator(true);
+    AnnotationWorker* worker = new AnnotationWorker(&annotator);
+
+    annotator.holdNextCall();
+    worker->analyze(lines(1000), 1);
+    QVERIFY(annotator.entered.tryAcquire(1, waitMsecs));
+
+    // Killed while held, so the run is cancelled instead of finished, and the worker must
+    // not wait for work afterwards.
+    worker->kill();
+    annotator.proceed.release();
+    delete worker;
+    QVERIFY(annotator.analyzed[0] < 1000);
+}
+
+QTEST_GUILESS_MAIN(tst_AnnotationWorker)
+
+#include "tst_annotationworker.moc"
@@ -0,0 +1,14 @@
+# AnnotationWorker runs, their cancellation and the hand over of results.
+include(../tests.pri)
+
+TARGET = tst_annotationworker
+
+HEADERS += \
+    ../../codetextedit/Annotation.h \
+    ../../codetextedit/AnnotationResult.h \
+    ../../codetextedit/AnnotationWorker.h \
+
+SOURCES += \
+    ../../codetextedit/AnnotationResult.cpp \
+    ../../codetextedit/AnnotationWorker.cpp \
+    tst_annotationworker.cpp \
@@ -0,0 +1,182 @@
+/***********************************************************************
+The CodeTextEditor provides an editor showing live hints and annotations.
+
+Copyright (c) 2020 Brian Newham <seaweedsolutionsltd@gmail.com>.
+
+CodeTextEdit is free software dual licensed under the GNU LGPL or MIT License.
+***********************************************************************/
+
+#include <QtTest>
+
+#include "codetextedit/BlockHeightIndex.h"
+#include "RandomRounds.h"
+
+using namespace codetextedit;
+
+class tst_BlockHeightIndex : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void emptyIndex();
+    void defaultHeights();
+    void setHeight();
+    void blockAtBoundaries();
+    void skipsHiddenBlocks();
+    void insertAndRemove();
+    void matchesLinearSums();
+};
+
+/// Number of blocks ending at or above y, what blockAt() descends to.
+static int linearBlockAt(const QVector<qreal>& heights, qreal y)
+{
+    int blocks = 0;
+    qreal bottom = 0;
+    while(blocks < heights.size() && bottom + heights[blocks] <= y)
+        bottom += heights[blocks++];
+    return qMin(blocks, heights.size() - 1);
+}
+
+void tst_BlockHeightIndex::emptyIndex()
+{
+    BlockHeightIndex index;
+    QCOMPARE(index.count(), 0);
+    QCOMPARE(index.totalHeight(), 0.0);
+    QCOMPARE(index.blockAt(0), -1);
+
+    index.reset(0, 10);
+    QCOMPARE(index.blockAt(5), -1);
+    index.removeBlocks(0, 3);
+    QCOMPARE(index.count(), 0);
+}
+
+void tst_BlockHeightIndex::defaultHeights()
+{
+    BlockHeightIndex index;
+    index.reset(5, 10);
+    QCOMPARE(index.count(), 5);
+    QCOMPARE(index.top(0), 0.0);
+    QCOMPARE(index.top(3), 30.0);
+    QCOMPARE(index.totalHeight(), 50.0);
+    QCOMPARE(index.top(9), 50.0);
+}
+
+void tst_BlockHeightIndex::setHeight()
+{
+    BlockHeightIndex index;
+    index.reset(4, 10);
+
+    QVERIFY(index.setHeight(1, 25));
+    QVERIFY(!index.setHeight(1, 25));
+    QVERIFY(!index.setHeight(-1, 5));
+    QVERIFY(!index.setHeight(4, 5));
+
+    QCOMPARE(index.height(1), 25.0);
+    QCOMPARE(index.top(1), 10.0);
+    QCOMPARE(index.top(2), 35.0);
+    QCOMPARE(index.totalHeight(), 55.0);
+}
+
+void tst_BlockHeightIndex::blockAtBoundaries()
+{
+    BlockHeightIndex index;
+    index.reset(3, 10);
+
+    QCOMPARE(index.blockAt(-5), 0);
+    QCOMPARE(index.blockAt(0), 0);
+    QCOMPARE(index.blockAt(9.5), 0);
+    QCOMPARE(index.blockAt(10), 1);
+    QCOMPARE(index.blockAt(29), 2);
+    QCOMPARE(index.blockAt(30), 2);
+    QCOMPARE(index.blockAt(1000), 2);
+}
+
+void tst_BlockHeightIndex::skipsHiddenBlocks()
+{
+    BlockHeightIndex index;
+    index.reset(5, 10);
+    index.setHeight(1, 0);
+    index.setHeight(2, 0);
+
+    QCOMPARE(index.top(3), 10.0);
+    QCOMPARE(index.blockAt(9), 0);
+    QCOMPARE(index.blockAt(10), 3);
+}
+
+void tst_BlockHeightIndex::insertAndRemove()
+{
+    BlockHeightIndex index;
+    index.reset(3, 10);
+    index.setHeight(2, 30);
+    index.setDefaultHeight(5);
+
+    index.insertBlocks(1, 2);
+    QCOMPARE(index.count(), 5);
+    QCOMPARE(index.height(1), 5.0);
+    QCOMPARE(index.height(4), 30.0);
+    QCOMPARE(index.totalHeight(), 60.0);
+
+    index.removeBlocks(0, 2);
+    QCOMPARE(index.count(), 3);
+    QCOMPARE(index.height(0), 5.0);
+    QCOMPARE(index.totalHeight(), 45.0);
+
+    // Clamped to the blocks there are.
+    index.insertBlocks(10, 1);
+    QCOMPARE(index.height(3), 5.0);
+    index.removeBlocks(2, 10);
+    QCOMPARE(index.count(), 2);
+    QCOMPARE(index.totalHeight(), 15.0);
+}
+
+void tst_BlockHeightIndex::matchesLinearSums()
+{
+    BlockHeightIndex index;
+    QVector<qreal> heights;
+
+    index.reset(37, 12);
+    heights.fill(12, 37);
+
+    runRandomRounds(2000, [&](QRandomGenerator& random) {
+        int operation = random.bounded(10);
+        if(operation == 0 && heights.size() < 200) {
+            int at = random.bounded(heights.size() + 1);
+            int count = random.bounded(1, 5);
+            index.insertBlocks(at, count);
+            heights.insert(at, count, 12);
+        }
+        else if(operation == 1 && !heights.isEmpty()) {
+            int at = random.bounded(heights.size());
+            int count = random.bounded(1, 5);
+            index.removeBlocks(at, count);
+            heights.remove(at, qMin(count, heights.size() - at));
+        }
+        else if(!heights.isEmpty()) {
+            // Whole numbers, so the sums are exact. Some blocks are hidden.
+            int block = random.bounded(heights.size());
+            qreal height = random.bounded(4) * 12;
+            index.setHeight(block, height);
+            heights[block] = height;
+        }
+
+        QCOMPARE(index.count(), heights.size());
+        if(heights.isEmpty())
+            return;
+
+        qreal top = 0;
+        for(int block = 0; block < heights.size(); ++block) {
+            QCOMPARE(index.top(block), top);
+            top += heights[block];
+        }
+        QCOMPARE(index.totalHeight(), top);
+
+        for(int probe = 0; probe < 8; ++probe) {
+            qreal y = random.bounded(int(top) + 24) - 12;
+            QCOMPARE(index.blockAt(y), linearBlockAt(heights, y));
+        }
+    });
+}
+
+QTEST_APPLESS_MAIN(tst_BlockHeightIndex)
+
+#include "tst_blockheightindex.moc"
@@ -0,0 +1,11 @@
+# BlockHeightIndex prefix sums and the block at a y position.
+include(../tests.pri)
+
+TARGET = tst_blockheightindex
+
+HEADERS += \
+    ../../codetextedit/BlockHeightIndex.h \
+
+SOURCES += \
+    ../../codetextedit/BlockHeightIndex.cpp \
+    tst_blockheightindex.cpp \
@@ -0,0 +1,173 @@
+/***********************************************************************
+The CodeTextEditor provides an editor showing live hints and annotations.
+
+Copyright (c) 2020 Brian Newham <seaweedsolutionsltd@gmail.com>.
+
+CodeTextEdit is free software dual licensed under the GNU LGPL or MIT License.
+***********************************************************************/
+
+#include <QtTest>
+
+#include "codetextedit/KeywordScanner.h"
+
+using namespace codetextedit;
+
+class tst_KeywordScanner : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void initTestCase();
+
+    void separatorErrors_data();
+    void separatorErrors();
+    void errorMessages();
+    void firstCommand_data();
+    void firstCommand();
+    void labelSymbols();
+
+private:
+    Keywords m_keywords;
+};
+
+/// The error spans of line as "kind@start+length", in order.
+static QStringList errors(const KeywordScanner& scanner, const QString& line)
+{
+    QVector<KeywordSpan> spans;
+    scanner.scan(line, spans);
+
+    QStringList errors;
+    for(const KeywordSpan& span : spans) {
+        if(!span.isError())
+            continue;
+        const char* kind = span.kind == KeywordSpan::SPAN_MissingSeparator ? "missing" : "bad";
+        errors.append(QString("%1@%2+%3").arg(kind).arg(span.start).arg(span.length));
+    }
+    return errors;
+}
+
+void tst_KeywordScanner::initTestCase()
+{
+    m_keywords.controlCommands = QStringList{"X", "XX"};
+    m_keywords.deviceCommands = QStringList{"AA", "BB", "CC"};
+    m_keywords.goodLabelNames = QStringList{"LOOP"};
+}
+
+void tst_KeywordScanner::separatorErrors_data()
+{
+    QTest::addColumn<QString>("line");
+    QTest::addColumn<QStringList>("expected");
+
+    const QStringList none;
+    QTest::newRow("separated") << "X AA;BB" << none;
+    QTest::newRow("separated with params") << "X,2 AA,1;BB,2M" << none;
+    QTest::newRow("leading separator") << "X ;AA" << none;
+    QTest::newRow("single device command") << "X AA,1" << none;
+    QTest::newRow("after params") << "X AA,1BB;CC" << QStringList{"missing@6+0"};
+    QTest::newRow("after a comma") << "X AA;BB,CC;AA" << QStringList{"missing@8+0"};
+    QTest::newRow("doubled") << "X AA;;BB" << QStringList{"bad@4+2"};
+    QTest::newRow("both") << "X AA;;BB,1CC" << QStringList{"bad@4+2", "missing@10+0"};
+}
+
+void tst_KeywordScanner::separatorErrors()
+{
+    QFETCH(QString, line);
+    QFETCH(QStringList, expected);
+
+    // Syntax errors do not depend on the keywords.
+    KeywordScanner scanner;
+    QCOMPARE(errors(scanner, line), expected);
+    scanner.setKeywords(&m_keywords);
+    QCOMPARE(errors(scanner, line), expected);
+}
+
+void tst_KeywordScanner::errorMessages()
+{
+    KeywordSpan missing;
+    missing.kind = KeywordSpan::SPAN_MissingSeparator;
+    missing.start = 6;
+    QCOMPARE(KeywordScanner::errorMessage("X AA,1BB;CC", missing), QString("Missing ';' before device command"));
+
+    KeywordSpan bad;
+    bad.kind = KeywordSpan::SPAN_BadSeparator;
+    bad.start = 4;
+    bad.length = 2;
+    QCOMPARE(KeywordScanner::errorMessage("X AA;;BB", bad), QString("Expected ';' between device commands, found ';;'"));
+
+    KeywordSpan command;
+    command.kind = KeywordSpan::SPAN_ControlCommand;
+    QVERIFY(!command.isError());
+    QVERIFY(KeywordScanner::errorMessage("X", command).isEmpty());
+}
+
+void tst_KeywordScanner::firstCommand_data()
+{
+    QTest::addColumn<QString>("line");
+    QTest::addColumn<bool>("withKeywords");
+    QTest::addColumn<QString>("expected");
+
+    QTest::newRow("alone") << "XX" << false << "XX";
+    QTest::newRow("label tag") << "XX,1" << false << "XX";
+    QTest::newRow("control command") << "XX,1" << true << "XX";
+    QTest::newRow("known label") << "LOOP,2" << true << "LOOP";
+    QTest::newRow("device commands") << "XX,1 AA;BB" << true << "XX";
+    QTest::newRow("space after") << "XX 1" << true << "";
+    QTest::newRow("not a comma") << "XX;1" << false << "";
+    QTest::newRow("indented") << " XX" << false << "";
+    QTest::newRow("declaration") << "#XX = 1" << false << "";
+    QTest::newRow("empty") << "" << false << "";
+}
+
+void tst_KeywordScanner::firstCommand()
+{
+    QFETCH(QString, line);
+    QFETCH(bool, withKeywords);
+    QFETCH(QString, expected);
+
+    KeywordScanner scanner;
+    if(withKeywords)
+        scanner.setKeywords(&m_keywords);
+
+    QVector<KeywordSpan> spans;
+    scanner.scan(line, spans);
+    QCOMPARE(KeywordScanner::firstCommand(line, spans).toString(), expected);
+}
+
+void tst_KeywordScanner::labelSymbols()
+{
+    KeywordScanner scanner;
+    QVector<KeywordSpan> spans;
+    QStringList definitions, references;
+
+    // Without keywords nothing is a label.
+    scanner.scan("LOOP,1", spans);
+    scanner.labelSymbols("LOOP,1", spans, definitions, references);
+    QVERIFY(definitions.isEmpty());
+
+    scanner.setKeywords(&m_keywords);
+    spans.clear();
+    scanner.scan("LOOP,1", spans);
+    scanner.labelSymbols("LOOP,1", spans, definitions, references);
+    QCOMPARE(definitions, QStringList{"LOOP,1"});
+    QVERIFY(references.isEmpty());
+
+    definitions.clear();
+    const QString line = "XX,1   LOOP,3";
+    spans.clear();
+    scanner.scan(line, spans);
+    scanner.labelSymbols(line, spans, definitions, references);
+    QVERIFY(definitions.isEmpty());
+    QCOMPARE(references, QStringList{"LOOP,3"});
+
+    // Only a single number refers to a label.
+    references.clear();
+    const QString twoNumbers = "XX,1   LOOP,3,4";
+    spans.clear();
+    scanner.scan(twoNumbers, spans);
+    scanner.labelSymbols(twoNumbers, spans, definitions, references);
+    QVERIFY(references.isEmpty());
+}
+
+QTEST_APPLESS_MAIN(tst_KeywordScanner)
+
+#include "tst_keywordscanner.moc"
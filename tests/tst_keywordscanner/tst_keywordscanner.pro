@@ -0,0 +1,13 @@
+# KeywordScanner separator errors, commands and label symbols.
+include(../tests.pri)
+
+TARGET = tst_keywordscanner
+
+HEADERS += \
+    ../../codetextedit/Keywords.h \
+    ../../codetextedit/KeywordScanner.h \
+    ../../codetextedit/KeywordSpan.h \
+
+SOURCES += \
+    ../../codetextedit/KeywordScanner.cpp \
+    tst_keywordscanner.cpp \
@@ -0,0 +1,151 @@
+/***********************************************************************
+The CodeTextEditor provides an editor showing live hints and annotations.
+
+Copyright (c) 2020 Brian Newham <seaweedsolutionsltd@gmail.com>.
+
+CodeTextEdit is free software dual licensed under the GNU LGPL or MIT License.
+***********************************************************************/
+
+#include <QtTest>
+
+#include <utility>
+
+#include "codetextedit/LineDiff.h"
+#include "RandomRounds.h"
+
+using namespace codetextedit;
+
+class tst_LineDiff : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void hunks_data();
+    void hunks();
+    void fallsBackPastMaxEdits();
+    void randomEdits();
+};
+
+/// Applies the hunks in order, checking each starts where the text has got to.
+static QStringList applyHunks(const QStringList& oldLines, const QVector<LineHunk>& hunks)
+{
+    QStringList lines;
+    int oldPos = 0;
+    for(const LineHunk& hunk : hunks) {
+        if(hunk.oldStart < oldPos || hunk.newStart != lines.size() + hunk.oldStart - oldPos)
+            return QStringList() << "<hunks out of order>";
+        lines += oldLines.mid(oldPos, hunk.oldStart - oldPos);
+        lines += hunk.lines;
+        oldPos = hunk.oldStart + hunk.oldCount;
+    }
+    lines += oldLines.mid(oldPos);
+    return lines;
+}
+
+/// Lines the hunks delete and insert.
+static int editCount(const QVector<LineHunk>& hunks)
+{
+    int edits = 0;
+    for(const LineHunk& hunk : hunks)
+        edits += hunk.oldCount + hunk.lines.size();
+    return edits;
+}
+
+/// The fewest deletions and insertions, from the longest common subsequence.
+static int minimalEdits(const QStringList& a, const QStringList& b)
+{
+    QVector<int> row(b.size() + 1, 0), previous(b.size() + 1, 0);
+    for(int i = 1; i <= a.size(); ++i) {
+        for(int j = 1; j <= b.size(); ++j)
+            row[j] = a[i - 1] == b[j - 1] ? previous[j - 1] + 1 : qMax(previous[j], row[j - 1]);
+        std::swap(row, previous);
+    }
+    return a.size() + b.size() - 2 * previous[b.size()];
+}
+
+static QStringList split(const char* text)
+{
+    return QString(text).split(' ', QString::SkipEmptyParts);
+}
+
+void tst_LineDiff::hunks_data()
+{
+    QTest::addColumn<QStringList>("oldLines");
+    QTest::addColumn<QStringList>("newLines");
+    QTest::addColumn<int>("hunkCount");
+
+    QTest::newRow("equal") << split("a b c") << split("a b c") << 0;
+    QTest::newRow("both empty") << QStringList() << QStringList() << 0;
+    QTest::newRow("from empty") << QStringList() << split("a b") << 1;
+    QTest::newRow("to empty") << split("a b") << QStringList() << 1;
+    QTest::newRow("insert") << split("a c") << split("a b c") << 1;
+    QTest::newRow("delete") << split("a b c") << split("a c") << 1;
+    QTest::newRow("replace") << split("a b c") << split("a x c") << 1;
+    QTest::newRow("two apart") << split("a b c d e") << split("x b c d y") << 2;
+    QTest::newRow("move") << split("a b c d") << split("b c d a") << 2;
+}
+
+void tst_LineDiff::hunks()
+{
+    QFETCH(QStringList, oldLines);
+    QFETCH(QStringList, newLines);
+    QFETCH(int, hunkCount);
+
+    QVector<LineHunk> hunks = diffLines(oldLines, newLines);
+    QCOMPARE(hunks.size(), hunkCount);
+    QCOMPARE(applyHunks(oldLines, hunks), newLines);
+    QCOMPARE(editCount(hunks), minimalEdits(oldLines, newLines));
+}
+
+void tst_LineDiff::fallsBackPastMaxEdits()
+{
+    QStringList oldLines, newLines;
+    for(int i = 0; i < 20; ++i) {
+        oldLines << "same" << QString("old %1").arg(i);
+        newLines << "same" << QString("new %1").arg(i);
+    }
+    oldLines << "tail";
+    newLines << "tail";
+
+    // Forty edits are needed, four are allowed: one hunk over the differing lines.
+    QVector<LineHunk> hunks = diffLines(oldLines, newLines, 4);
+    QCOMPARE(hunks.size(), 1);
+    QCOMPARE(hunks[0].oldStart, 1);
+    QCOMPARE(hunks[0].oldCount, 39);
+    QCOMPARE(applyHunks(oldLines, hunks), newLines);
+
+    hunks = diffLines(oldLines, newLines, 40);
+    QCOMPARE(hunks.size(), 20);
+    QCOMPARE(applyHunks(oldLines, hunks), newLines);
+}
+
+void tst_LineDiff::randomEdits()
+{
+    // Few distinct lines, so there are many equally long matches to choose from.
+    auto randomLines = [](QRandomGenerator& random, int count) {
+        QStringList lines;
+        for(int i = 0; i < count; ++i)
+            lines << QString(QChar('a' + random.bounded(3)));
+        return lines;
+    };
+
+    runRandomRounds(500, [&](QRandomGenerator& random) {
+        QStringList oldLines = randomLines(random, random.bounded(30));
+        QStringList newLines = oldLines;
+        for(int edit = random.bounded(8); edit > 0; --edit) {
+            int at = random.bounded(newLines.size() + 1);
+            if(random.bounded(2) == 0 || at == newLines.size())
+                newLines.insert(at, randomLines(random, 1).first());
+            else
+                newLines.removeAt(at);
+        }
+
+        QVector<LineHunk> hunks = diffLines(oldLines, newLines);
+        QCOMPARE(applyHunks(oldLines, hunks), newLines);
+        QCOMPARE(editCount(hunks), minimalEdits(oldLines, newLines));
+    });
+}
+
+QTEST_APPLESS_MAIN(tst_LineDiff)
+
+#include "tst_linediff.moc"
@@ -0,0 +1,11 @@
+# diffLines() hunks, their minimality and the fallback past maxEdits.
+include(../tests.pri)
+
+TARGET = tst_linediff
+
+HEADERS += \
+    ../../codetextedit/LineDiff.h \
+
+SOURCES += \
+    ../../codetextedit/LineDiff.cpp \
+    tst_linediff.cpp \
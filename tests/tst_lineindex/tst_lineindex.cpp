@@ -0,0 +1,180 @@
+/***********************************************************************
+The CodeTextEditor provides an editor showing live hints and annotations.
+
+Copyright (c) 2020 Brian Newham <seaweedsolutionsltd@gmail.com>.
+
+CodeTextEdit is free software dual licensed under the GNU LGPL or MIT License.
+***********************************************************************/
+
+#include <QtTest>
+
+#include "codetextedit/LineIndex.h"
+#include "RandomRounds.h"
+
+using namespace codetextedit;
+
+class tst_LineIndex : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void emptyText();
+    void lineViews();
+    void fields_data();
+    void fields();
+    void randomUtf16();
+    void randomUtf8();
+    void randomFields();
+};
+
+static const int rounds = 2000;
+
+/// Offsets after each newline, what the vector loops must find.
+template<typename Unit>
+static QVector<qint64> scalarStarts(const Unit* text, qint64 length)
+{
+    QVector<qint64> starts{0};
+    for(qint64 i = 0; i < length; ++i) {
+        if(text[i] == Unit('\n'))
+            starts.append(i + 1);
+    }
+    return starts;
+}
+
+static QVector<qint64> indexedStarts(const LineIndex& index)
+{
+    QVector<qint64> starts;
+    for(int line = 0; line < index.lineCount(); ++line)
+        starts.append(index.lineStart(line));
+    return starts;
+}
+
+static QStringList toStrings(const QVector<QStringRef>& refs)
+{
+    QStringList strings;
+    for(const QStringRef& ref : refs)
+        strings.append(ref.toString());
+    return strings;
+}
+
+/// Random text of the code units the index must tell apart.
+static QString randomText(QRandomGenerator& random, int length)
+{
+    // Besides the separators, code units which only share a byte with '\n' or ',', so a
+    // compare of the wrong width would find them.
+    static const ushort units[] = {'a', 'b', '\n', '\r', ',', ' ', 0x0A0A, 0x010A, 0x2C00, 0xD83D, 0xDE00};
+    QString text(length, Qt::Uninitialized);
+    for(int i = 0; i < length; ++i)
+        text[i] = QChar(units[random.bounded(int(sizeof(units) / sizeof(units[0])))]);
+    return text;
+}
+
+void tst_LineIndex::emptyText()
+{
+    LineIndex index;
+    index.build(static_cast<const QChar*>(nullptr), 0);
+    QCOMPARE(index.lineCount(), 1);
+    QCOMPARE(index.lineStart(0), qint64(0));
+    QCOMPARE(index.lineEnd(0), qint64(0));
+    QCOMPARE(index.lines(QString()), QStringList{QString()});
+
+    index.build("\n", 1);
+    QCOMPARE(index.lineCount(), 2);
+    QCOMPARE(index.lineStart(1), qint64(1));
+}
+
+void tst_LineIndex::lineViews()
+{
+    const QString text = "one\r\ntwo\n\r\nthree\r";
+    LineIndex index;
+    index.build(text.constData(), text.size());
+
+    QCOMPARE(index.lineCount(), 4);
+    QCOMPARE(index.line(text, 0).toString(), QString("one"));
+    QCOMPARE(index.line(text, 1).toString(), QString("two"));
+    QCOMPARE(index.line(text, 2).toString(), QString(""));
+    QCOMPARE(index.line(text, 3).toString(), QString("three"));
+    QCOMPARE(index.lineEnd(1), qint64(8));
+}
+
+void tst_LineIndex::fields_data()
+{
+    QTest::addColumn<QString>("line");
+
+    QTest::newRow("empty") << "";
+    QTest::newRow("one field") << "XX";
+    QTest::newRow("fields") << "XX,1,2";
+    QTest::newRow("empty fields") << ",,X,";
+    QTest::newRow("long") << "AAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAA,BBBBBBBBBBBBBBBBBBBBBBBBBBBBBBBBBBBBBBBBBB,C";
+}
+
+void tst_LineIndex::fields()
+{
+    QFETCH(QString, line);
+
+    QVector<QStringRef> fields;
+    splitFields(line, ',', fields);
+    QCOMPARE(toStrings(fields), line.split(','));
+    QCOMPARE(firstField(line, ',').toString(), line.split(',').first());
+}
+
+void tst_LineIndex::randomUtf16()
+{
+    runRandomRounds(rounds, [](QRandomGenerator& random) {
+        QString text = randomText(random, random.bounded(300));
+
+        // From an odd offset too, so loads are not aligned.
+        int offset = qMin(text.size(), int(random.bounded(3)));
+        const QChar* data = text.constData() + offset;
+        qint64 length = text.size() - offset;
+
+        LineIndex index;
+        index.build(data, length);
+        QCOMPARE(indexedStarts(index), scalarStarts(reinterpret_cast<const ushort*>(data), length));
+        QCOMPARE(index.lineEnd(index.lineCount() - 1), length);
+
+        if(offset == 0) {
+            QStringList expected = text.split('\n');
+            for(QString& line : expected) {
+                if(line.endsWith('\r'))
+                    line.chop(1);
+            }
+            QCOMPARE(index.lines(text), expected);
+        }
+    });
+}
+
+void tst_LineIndex::randomUtf8()
+{
+    runRandomRounds(rounds, [](QRandomGenerator& random) {
+        QByteArray bytes = randomText(random, random.bounded(300)).toUtf8();
+        int offset = qMin(bytes.size(), int(random.bounded(3)));
+        const char* data = bytes.constData() + offset;
+        qint64 length = bytes.size() - offset;
+
+        LineIndex index;
+        index.build(data, length);
+        QCOMPARE(indexedStarts(index), scalarStarts(reinterpret_cast<const uchar*>(data), length));
+    });
+}
+
+void tst_LineIndex::randomFields()
+{
+    QVector<QStringRef> fields;
+    runRandomRounds(rounds, [&fields](QRandomGenerator& random) {
+        QString line = randomText(random, random.bounded(120));
+        QChar separator = random.bounded(2) ? QChar(',') : QChar('\n');
+
+        splitFields(line, separator, fields);
+        QCOMPARE(toStrings(fields), line.split(separator));
+        QCOMPARE(firstField(line, separator).toString(), line.split(separator).first());
+
+        int from = random.bounded(-2, line.size() + 3);
+        int expected = from < 0 ? -1 : line.indexOf(separator, from);
+        QCOMPARE(indexOfChar(line.constData(), line.size(), from, separator), expected);
+    });
+}
+
+QTEST_APPLESS_MAIN(tst_LineIndex)
+
+#include "tst_lineindex.moc"
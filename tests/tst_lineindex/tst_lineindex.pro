@@ -0,0 +1,14 @@
+# LineIndex and the field views against plain scalar scans, on random input.
+#
+# The build's target decides which loops run: SSE2 on x86, AVX2 when built with
+# QMAKE_CXXFLAGS+=-mavx2, the scalar loop elsewhere.
+include(../tests.pri)
+
+TARGET = tst_lineindex
+
+HEADERS += \
+    ../../codetextedit/LineIndex.h \
+
+SOURCES += \
+    ../../codetextedit/LineIndex.cpp \
+    tst_lineindex.cpp \
@@ -0,0 +1,202 @@
+/***********************************************************************
+The CodeTextEditor provides an editor showing live hints and annotations.
+
+Copyright (c) 2020 Brian Newham <seaweedsolutionsltd@gmail.com>.
+
+CodeTextEdit is free software dual licensed under the GNU LGPL or MIT License.
+***********************************************************************/
+
+#include <QtTest>
+#include <QTemporaryDir>
+
+#include "codetextedit/LintEngine.h"
+
+using namespace codetextedit;
+
+///
+/// \brief Warns about every line using the device command AA, stepwise or batched.
+///
+class MarkingAnnotator : public Annotator
+{
+public:
+    explicit MarkingAnnotator(bool batched) : m_batched(batched) {}
+
+    void prepareAnalysis(QStringList lines) override
+    {
+        m_lines = lines;
+        m_next = 0;
+        m_result.clear();
+    }
+
+    bool analyzeStep() override
+    {
+        if(m_next < m_lines.size()) {
+            if(marks(m_next))
+                m_result[m_next].append(mark());
+            ++ m_next;
+        }
+        return m_next < m_lines.size();
+    }
+
+    bool analyzeRange(int first, int count, AnnotationContainer* results) override
+    {
+        if(!m_batched)
+            return false;
+
+        for(int i = 0; i < count; ++i) {
+            if(marks(first + i))
+                results[i].append(mark());
+        }
+        return true;
+    }
+
+    AnnotationMap analysisResult() override
+    {
+        AnnotationMap result;
+        result.swap(m_result);
+        return result;
+    }
+
+private:
+    bool marks(int line) const {return m_lines[line].contains("AA");}
+
+    static Annotation* mark()
+    {
+        Annotation* annotation = new Annotation;
+        annotation->setCategory(Annotation::CATEGORY_Warning);
+        annotation->setMessage("Uses AA");
+        annotation->setHelpKey("aa");
+        return annotation;
+    }
+
+    bool            m_batched;
+    QStringList     m_lines;
+    int             m_next = 0;
+    AnnotationMap   m_result;
+};
+
+class tst_LintEngine : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void initTestCase();
+
+    void keywordAndAnnotatorDiagnostics_data();
+    void keywordAndAnnotatorDiagnostics();
+    void withoutKeywords();
+    void missingFile();
+
+private:
+    QString writeFile(const QString& name, const QStringList& lines);
+
+    QTemporaryDir   m_dir;
+    Keywords        m_keywords;
+};
+
+/// The diagnostics as "line:column category message", in the order reported.
+static QStringList describe(const LintFileResult& result)
+{
+    QStringList described;
+    for(const LintDiagnostic& diagnostic : result.diagnostics) {
+        const char* category = diagnostic.category == Annotation::CATEGORY_Error ? "error" : "warning";
+        described.append(QString("%1:%2 %3 %4").arg(diagnostic.line).arg(diagnostic.column).arg(category).arg(diagnostic.message));
+    }
+    return described;
+}
+
+/// The file as it would be opened in the editor: lines joined by '\n', without a final one.
+QString tst_LintEngine::writeFile(const QString &name, const QStringList &lines)
+{
+    QString filePath = m_dir.filePath(name);
+    QFile file(filePath);
+    if(!file.open(QFile::WriteOnly))
+        return QString();
+    file.write(lines.join('\n').toUtf8());
+    return filePath;
+}
+
+void tst_LintEngine::initTestCase()
+{
+    QVERIFY(m_dir.isValid());
+
+    m_keywords.controlCommands = QStringList{"X"};
+    m_keywords.deviceCommands = QStringList{"AA", "LOOP"};
+    m_keywords.goodLabelNames = QStringList{"LOOP"};
+}
+
+static const QStringList program = {
+    "LOOP,1",
+    "X AA",
+    "X LOOP,1",
+    "X LOOP,7",
+    "LOOP,1",
+    "Y AA",
+    "X AA;;AA",
+};
+
+void tst_LintEngine::keywordAndAnnotatorDiagnostics_data()
+{
+    QTest::addColumn<bool>("batched");
+
+    QTest::newRow("analyzeStep") << false;
+    QTest::newRow("analyzeRange") << true;
+}
+
+void tst_LintEngine::keywordAndAnnotatorDiagnostics()
+{
+    QFETCH(bool, batched);
+
+    QString filePath = writeFile("program.txt", program);
+    QVERIFY(!filePath.isEmpty());
+
+    MarkingAnnotator annotator(batched);
+    LintFileResult result = LintEngine::lintFile(filePath, &annotator, &m_keywords);
+
+    QVERIFY(result.readOk);
+    QCOMPARE(result.filePath, filePath);
+    QCOMPARE(result.lineCount, program.size());
+    QCOMPARE(result.bytes, qint64(program.join('\n').size()));
+
+    // Sorted by line only: on a line the keyword checks come first, then the annotator,
+    // then the label checks, which need the whole file.
+    const QStringList expected = {
+        "0:0 error Label 'LOOP,1' is defined 2 times",
+        "1:0 warning Uses AA",
+        "3:2 error Label 'LOOP,7' is not defined",
+        "4:0 error Label 'LOOP,1' is defined 2 times",
+        "5:0 error Unknown control command 'Y'",
+        "5:0 warning Uses AA",
+        "6:4 error Expected ';' between device commands, found ';;'",
+        "6:0 warning Uses AA",
+    };
+    QCOMPARE(describe(result), expected);
+    QCOMPARE(result.diagnostics[1].helpKey, QString("aa"));
+    QVERIFY(result.diagnostics[0].helpKey.isEmpty());
+}
+
+void tst_LintEngine::withoutKeywords()
+{
+    QString filePath = writeFile("plain.txt", program);
+    QVERIFY(!filePath.isEmpty());
+
+    // Neither labels nor unknown commands are checked, the separators still are.
+    LintFileResult result = LintEngine::lintFile(filePath, nullptr, nullptr);
+    QVERIFY(result.readOk);
+    QCOMPARE(describe(result), QStringList{"6:4 error Expected ';' between device commands, found ';;'"});
+}
+
+void tst_LintEngine::missingFile()
+{
+    MarkingAnnotator annotator(false);
+    LintFileResult result = LintEngine::lintFile(m_dir.filePath("missing.txt"), &annotator, &m_keywords);
+
+    QVERIFY(!result.readOk);
+    QVERIFY(!result.error.isEmpty());
+    QCOMPARE(result.lineCount, 0);
+    QVERIFY(result.diagnostics.isEmpty());
+}
+
+QTEST_GUILESS_MAIN(tst_LintEngine)
+
+#include "tst_lintengine.moc"
@@ -0,0 +1,8 @@
+# LintEngine::lintFile, its keyword and label checks and the annotator's diagnostics.
+include(../tests.pri)
+include(../../codetextedit/CodeTextLint.pri)
+
+TARGET = tst_lintengine
+
+SOURCES += \
+    tst_lintengine.cpp \
@@ -0,0 +1,152 @@
+/***********************************************************************
+The CodeTextEditor provides an editor showing live hints and annotations.
+
+Copyright (c) 2020 Brian Newham <seaweedsolutionsltd@gmail.com>.
+
+CodeTextEdit is free software dual licensed under the GNU LGPL or MIT License.
+***********************************************************************/
+
+#include <QtTest>
+
+#include <algorithm>
+
+#include "codetextedit/PatternAutomaton.h"
+#include "RandomRounds.h"
+
+using namespace codetextedit;
+
+using Match = QPair<int, int>;      // Pattern id and end
+
+class tst_PatternAutomaton : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void rejectsPatterns();
+    void overlappingMatches();
+    void caseInsensitive();
+    void emptyAutomaton();
+    void matchesPlainSearch();
+};
+
+/// Every match in the order scan() reports them, with {-1, -1} appended if an end went back.
+static QVector<Match> scan(const PatternAutomaton& automaton, const QString& text)
+{
+    QVector<Match> matches;
+    bool ordered = true;
+    automaton.scan(text.constData(), text.size(), [&](int id, int end) {
+        if(!matches.isEmpty() && end < matches.last().second)
+            ordered = false;
+        matches.append(qMakePair(id, end));
+    });
+    if(!ordered)
+        matches.append(qMakePair(-1, -1));
+    return matches;
+}
+
+static QVector<Match> sorted(QVector<Match> matches)
+{
+    std::sort(matches.begin(), matches.end(), [](const Match& a, const Match& b) {
+        return a.second != b.second ? a.second < b.second : a.first < b.first;
+    });
+    return matches;
+}
+
+static bool sameChar(QChar patternChar, QChar textChar, Qt::CaseSensitivity cs)
+{
+    if(textChar.unicode() >= 128)
+        return false;
+    if(cs == Qt::CaseInsensitive)
+        return patternChar.toLower() == textChar.toLower();
+    return patternChar == textChar;
+}
+
+static QVector<Match> plainSearch(const QStringList& patterns, const QString& text, Qt::CaseSensitivity cs)
+{
+    QVector<Match> matches;
+    for(int end = 1; end <= text.size(); ++end) {
+        for(int id = 0; id < patterns.size(); ++id) {
+            const QString& pattern = patterns[id];
+            int start = end - pattern.size();
+            bool match = start >= 0;
+            for(int i = 0; match && i < pattern.size(); ++i)
+                match = sameChar(pattern[i], text[start + i], cs);
+            if(match)
+                matches.append(qMakePair(id, end));
+        }
+    }
+    return matches;
+}
+
+void tst_PatternAutomaton::rejectsPatterns()
+{
+    PatternAutomaton automaton;
+    QCOMPARE(automaton.addPattern(QString()), -1);
+    QCOMPARE(automaton.addPattern(QString::fromUtf8("caf\xc3\xa9")), -1);
+    QCOMPARE(automaton.addPattern("AB"), 0);
+    QCOMPARE(automaton.addPattern("AB"), 1);
+    QCOMPARE(automaton.patternCount(), 2);
+    QCOMPARE(automaton.patternLength(1), 2);
+}
+
+void tst_PatternAutomaton::overlappingMatches()
+{
+    const QStringList patterns = {"he", "she", "his", "hers"};
+    PatternAutomaton automaton;
+    for(const QString& pattern : patterns)
+        automaton.addPattern(pattern);
+    automaton.build();
+
+    QCOMPARE(sorted(scan(automaton, "ushers")), (QVector<Match>{{0, 4}, {1, 4}, {3, 6}}));
+}
+
+void tst_PatternAutomaton::caseInsensitive()
+{
+    PatternAutomaton sensitive(Qt::CaseSensitive);
+    PatternAutomaton insensitive(Qt::CaseInsensitive);
+    for(PatternAutomaton* automaton : {&sensitive, &insensitive}) {
+        automaton->addPattern("Ab1");
+        automaton->build();
+    }
+
+    QCOMPARE(scan(sensitive, "ab1 AB1 Ab1"), (QVector<Match>{{0, 11}}));
+    QCOMPARE(scan(insensitive, "ab1 AB1 Ab1"), (QVector<Match>{{0, 3}, {0, 7}, {0, 11}}));
+}
+
+void tst_PatternAutomaton::emptyAutomaton()
+{
+    PatternAutomaton automaton;
+    QCOMPARE(automaton.stateCount(), 1);
+    QVERIFY(scan(automaton, "anything").isEmpty());
+}
+
+void tst_PatternAutomaton::matchesPlainSearch()
+{
+    // A small alphabet, so patterns share prefixes and suffixes and overlap a lot.
+    const QString alphabet = QString::fromUtf8("abcAB,\xc3\xa1");
+    auto randomText = [&alphabet](QRandomGenerator& random, int length) {
+        QString text;
+        for(int i = 0; i < length; ++i)
+            text += alphabet[random.bounded(alphabet.size())];
+        return text;
+    };
+
+    runRandomRounds(300, [&](QRandomGenerator& random) {
+        Qt::CaseSensitivity cs = random.bounded(2) ? Qt::CaseInsensitive : Qt::CaseSensitive;
+        PatternAutomaton automaton(cs);
+        QStringList patterns;
+        for(int count = random.bounded(1, 12); count > 0; --count) {
+            QString pattern = randomText(random, random.bounded(1, 5));
+            if(automaton.addPattern(pattern) >= 0)
+                patterns.append(pattern);
+        }
+        automaton.build();
+
+        QString text = randomText(random, random.bounded(60));
+        QCOMPARE(sorted(scan(automaton, text)), plainSearch(patterns, text, cs));
+    });
+}
+
+QTEST_APPLESS_MAIN(tst_PatternAutomaton)
+
+#include "tst_patternautomaton.moc"
@@ -0,0 +1,11 @@
+# PatternAutomaton matches against a plain search of every pattern.
+include(../tests.pri)
+
+TARGET = tst_patternautomaton
+
+HEADERS += \
+    ../../codetextedit/PatternAutomaton.h \
+
+SOURCES += \
+    ../../codetextedit/PatternAutomaton.cpp \
+    tst_patternautomaton.cpp \
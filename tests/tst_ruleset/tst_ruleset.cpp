@@ -0,0 +1,236 @@
+/***********************************************************************
+The CodeTextEditor provides an editor showing live hints and annotations.
+
+Copyright (c) 2020 Brian Newham <seaweedsolutionsltd@gmail.com>.
+
+CodeTextEdit is free software dual licensed under the GNU LGPL or MIT License.
+***********************************************************************/
+
+#include <QtTest>
+
+#include "codetextedit/KeywordScanner.h"
+#include "codetextedit/RuleSet.h"
+
+using namespace codetextedit;
+
+static const char commandRules[] = R"({
+    "version": "7",
+    "rules": [
+        {"command": "AA", "annotations": [{"message": "AA"}]},
+        {"command": "CC", "params": {"count": [1, 2]}, "annotations": [{"message": "CC"}]},
+        {"command": "DD", "params": {"value": [0, 255]}, "annotations": [{"message": "DD"}]},
+        {"command": "EE", "params": {"value": [0, 255]}, "when": "invalid",
+         "annotations": [{"message": "EE", "category": "error", "helpKey": "EE.1", "help": "Keep it a byte"}]},
+        {"command": "FF", "annotations": [{"message": "FF 1"}, {"message": "FF 2", "category": "hint"}]}
+    ]
+})";
+
+static const char anywhereRules[] = R"({
+    "version": "8",
+    "caseSensitive": false,
+    "rules": [
+        {"command": "BB", "where": "anywhere", "annotations": [{"message": "BB"}]},
+        {"command": "AA", "annotations": [{"message": "AA"}]}
+    ]
+})";
+
+class tst_RuleSet : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void initTestCase();
+
+    void loadErrors_data();
+    void loadErrors();
+    void version();
+
+    void fires_data();
+    void fires();
+    void anywhere_data();
+    void anywhere();
+    void annotationContents();
+    void tokensGiveSameResult_data();
+    void tokensGiveSameResult();
+
+private:
+    RuleSet m_commands;
+    RuleSet m_anywhere;
+};
+
+/// Messages of the annotations, which are deleted.
+static QStringList takeMessages(const AnnotationContainer& container)
+{
+    QStringList messages;
+    for(const Annotation* annotation : container)
+        messages.append(annotation->message());
+    qDeleteAll(container);
+    return messages;
+}
+
+static QStringList messages(const RuleSet& rules, const QString& line)
+{
+    AnnotationContainer container;
+    rules.scanLine(line, container);
+    return takeMessages(container);
+}
+
+/// The same from the tokens of a scanner without keywords, as the editor has before any are set.
+static QStringList tokenMessages(const RuleSet& rules, const QString& line)
+{
+    KeywordScanner scanner;
+    QVector<KeywordSpan> tokens;
+    scanner.scan(line, tokens);
+
+    AnnotationContainer container;
+    rules.scanLine(line, tokens, container);
+    return takeMessages(container);
+}
+
+void tst_RuleSet::initTestCase()
+{
+    QString error;
+    QVERIFY2(m_commands.loadJson(commandRules, &error), qPrintable(error));
+    QVERIFY2(m_anywhere.loadJson(anywhereRules, &error), qPrintable(error));
+    QCOMPARE(m_commands.ruleCount(), 5);
+}
+
+void tst_RuleSet::loadErrors_data()
+{
+    QTest::addColumn<QByteArray>("json");
+
+    QTest::newRow("not json") << QByteArray("{");
+    QTest::newRow("not an object") << QByteArray("[]");
+    QTest::newRow("empty command") << QByteArray(R"({"rules": [{"command": ""}]})");
+    QTest::newRow("non-ascii command") << QByteArray(R"({"rules": [{"command": "é"}]})");
+    QTest::newRow("bad where") << QByteArray(R"({"rules": [{"command": "AA", "where": "middle"}]})");
+    QTest::newRow("bad when") << QByteArray(R"({"rules": [{"command": "AA", "when": "never"}]})");
+    QTest::newRow("bad count") << QByteArray(R"({"rules": [{"command": "AA", "params": {"count": [3, 1]}}]})");
+    QTest::newRow("bad category") << QByteArray(R"({"rules": [{"command": "AA", "annotations": [{"category": "fatal"}]}]})");
+    QTest::newRow("help without key") << QByteArray(R"({"rules": [{"command": "AA", "annotations": [{"help": "text"}]}]})");
+}
+
+void tst_RuleSet::loadErrors()
+{
+    QFETCH(QByteArray, json);
+
+    RuleSet rules;
+    QVERIFY(rules.loadJson(commandRules));
+
+    QString error;
+    QVERIFY(!rules.loadJson(json, &error));
+    QVERIFY(!error.isEmpty());
+
+    // A failed load keeps the rules it had.
+    QCOMPARE(rules.ruleCount(), 5);
+    QCOMPARE(messages(rules, "AA"), QStringList{"AA"});
+}
+
+void tst_RuleSet::version()
+{
+    QVERIFY(m_commands.version().startsWith("7-"));
+    QVERIFY(m_anywhere.version().startsWith("8-"));
+
+    RuleSet edited;
+    QByteArray json(commandRules);
+    json.replace("Keep it a byte", "Keep it small");
+    QVERIFY(edited.loadJson(json));
+    QVERIFY(edited.version() != m_commands.version());
+}
+
+void tst_RuleSet::fires_data()
+{
+    QTest::addColumn<QString>("line");
+    QTest::addColumn<QStringList>("expected");
+
+    const QStringList none;
+    QTest::newRow("first") << "AA" << QStringList{"AA"};
+    QTest::newRow("first with params") << "AA,1,x" << QStringList{"AA"};
+    QTest::newRow("prefix of a word") << "AAB,1" << none;
+    QTest::newRow("suffix of a word") << "XAA,1" << none;
+    QTest::newRow("not first") << "XX,AA" << none;
+    QTest::newRow("space after") << "AA 1" << none;
+    QTest::newRow("indented") << " AA" << none;
+    QTest::newRow("case") << "aa" << none;
+
+    QTest::newRow("count low") << "CC" << none;
+    QTest::newRow("count in range") << "CC,1,2" << QStringList{"CC"};
+    QTest::newRow("count high") << "CC,1,2,3" << none;
+
+    QTest::newRow("value in range") << "DD,0,255" << QStringList{"DD"};
+    QTest::newRow("value high") << "DD,12,256" << none;
+    QTest::newRow("value not a number") << "DD,1x" << none;
+    QTest::newRow("value overflowing") << "DD,99999999999999999999999999" << none;
+
+    QTest::newRow("invalid fires") << "EE,300" << QStringList{"EE"};
+    QTest::newRow("valid does not") << "EE,3" << none;
+
+    QTest::newRow("several annotations") << "FF" << QStringList{"FF 1", "FF 2"};
+}
+
+void tst_RuleSet::fires()
+{
+    QFETCH(QString, line);
+    QFETCH(QStringList, expected);
+
+    QCOMPARE(messages(m_commands, line), expected);
+}
+
+void tst_RuleSet::anywhere_data()
+{
+    QTest::addColumn<QString>("line");
+    QTest::addColumn<QStringList>("expected");
+
+    const QStringList none;
+    QTest::newRow("alone") << "BB" << QStringList{"BB"};
+    QTest::newRow("between words") << "x bb,y" << QStringList{"BB"};
+    QTest::newRow("twice") << "Bb;bB" << QStringList{"BB", "BB"};
+    QTest::newRow("in a word") << "xBB BBx B_BB" << none;
+    QTest::newRow("first, case insensitive") << "aa,1" << QStringList{"AA"};
+    QTest::newRow("both") << "AA,BB" << QStringList{"AA", "BB"};
+}
+
+void tst_RuleSet::anywhere()
+{
+    QFETCH(QString, line);
+    QFETCH(QStringList, expected);
+
+    QCOMPARE(messages(m_anywhere, line), expected);
+    QCOMPARE(tokenMessages(m_anywhere, line), expected);
+}
+
+void tst_RuleSet::annotationContents()
+{
+    AnnotationContainer container;
+    m_commands.scanLine("EE,1000", container);
+    QCOMPARE(container.size(), 1);
+
+    const Annotation* annotation = container.first();
+    QCOMPARE(annotation->category(), Annotation::CATEGORY_Error);
+    QCOMPARE(annotation->helpKey(), QString("EE.1"));
+    QVERIFY(annotation->solutionHelp().isEmpty());
+    QCOMPARE(m_commands.solutionHelp(annotation->helpKey()), QString("Keep it a byte"));
+    QCOMPARE(annotation->alertColor(), QColor("black"));
+    qDeleteAll(container);
+}
+
+void tst_RuleSet::tokensGiveSameResult_data()
+{
+    QTest::addColumn<QString>("line");
+
+    for(const char* line : {"AA", "AA,1", "AA;1", "AA 1", " AA", "#AA = 1", "AA,1   XX,2;YY", "AA,1   XX,2 YY",
+                            "CC", "CC,1,2", "CC,1,2,3", "DD,256", "EE,300", "EE,3", "FF", "FF // note",
+                            "LABEL,3", "XX,AA", "", ";"})
+        QTest::newRow(*line ? line : "empty") << QString(line);
+}
+
+void tst_RuleSet::tokensGiveSameResult()
+{
+    QFETCH(QString, line);
+
+    QCOMPARE(tokenMessages(m_commands, line), messages(m_commands, line));
+}
+
+QTEST_GUILESS_MAIN(tst_RuleSet)
+
+#include "tst_ruleset.moc"
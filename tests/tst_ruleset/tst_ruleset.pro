@@ -0,0 +1,17 @@
+# RuleSet loading and the rules a line fires, with and without the lexer's tokens.
+include(../tests.pri)
+
+TARGET = tst_ruleset
+
+HEADERS += \
+    ../../codetextedit/Annotation.h \
+    ../../codetextedit/KeywordScanner.h \
+    ../../codetextedit/KeywordSpan.h \
+    ../../codetextedit/PatternAutomaton.h \
+    ../../codetextedit/RuleSet.h \
+
+SOURCES += \
+    ../../codetextedit/KeywordScanner.cpp \
+    ../../codetextedit/PatternAutomaton.cpp \
+    ../../codetextedit/RuleSet.cpp \
+    tst_ruleset.cpp \
@@ -0,0 +1,193 @@
+/***********************************************************************
+The CodeTextEditor provides an editor showing live hints and annotations.
+
+Copyright (c) 2020 Brian Newham <seaweedsolutionsltd@gmail.com>.
+
+CodeTextEdit is free software dual licensed under the GNU LGPL or MIT License.
+***********************************************************************/
+
+#include <QtTest>
+
+#include "codetextedit/SubstringSearch.h"
+#include "RandomRounds.h"
+
+using namespace codetextedit;
+
+class tst_SubstringSearch : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void emptyNeedle();
+    void blockBoundaries_data();
+    void blockBoundaries();
+    void matchEndsWithinLength();
+    void foldedToAscii_data();
+    void foldedToAscii();
+    void matchesIndexOf();
+};
+
+static const QChar kelvinSign(0x212A);
+static const QChar longS(0x017F);
+
+/// Every match of needle from from on, found one after the other.
+static QVector<int> allMatches(const SubstringSearch& search, const QString& text, int from)
+{
+    QVector<int> matches;
+    for(int pos = search.indexIn(text.constData(), text.size(), from); pos >= 0;
+        pos = search.indexIn(text.constData(), text.size(), pos + 1))
+        matches.append(pos);
+    return matches;
+}
+
+static QVector<int> allIndexOf(const QString& needle, Qt::CaseSensitivity cs, const QString& text, int from)
+{
+    QVector<int> matches;
+    for(int pos = text.indexOf(needle, from, cs); pos >= 0; pos = text.indexOf(needle, pos + 1, cs))
+        matches.append(pos);
+    return matches;
+}
+
+void tst_SubstringSearch::emptyNeedle()
+{
+    const QString text = "abc";
+    SubstringSearch search(QString(), Qt::CaseSensitive);
+    QCOMPARE(search.indexIn(text.constData(), text.size(), 0), -1);
+
+    SubstringSearch a("a", Qt::CaseSensitive);
+    QCOMPARE(a.indexIn(text.constData(), text.size(), -1), -1);
+    QCOMPARE(a.indexIn(text.constData(), text.size(), 4), -1);
+}
+
+void tst_SubstringSearch::blockBoundaries_data()
+{
+    QTest::addColumn<QString>("needle");
+    QTest::addColumn<int>("position");
+    QTest::addColumn<bool>("caseSensitive");
+
+    // 8 code units per SSE2 block, 40 in the text: the needle's first or last character
+    // falls on either side of a block edge, and near the end into the scalar tail.
+    const int textLength = 40;
+    for(int length : {1, 2, 8, 9}) {
+        QString needle = QString("abcdefghi").left(length);
+        for(int position : {0, 1, 7, 8, 9, 15, 16, 17, textLength - length - 1, textLength - length}) {
+            QTest::addRow("%d at %d", length, position) << needle << position << true;
+            QTest::addRow("%d at %d, insensitive", length, position) << needle << position << false;
+        }
+    }
+}
+
+void tst_SubstringSearch::blockBoundaries()
+{
+    QFETCH(QString, needle);
+    QFETCH(int, position);
+    QFETCH(bool, caseSensitive);
+    Qt::CaseSensitivity cs = caseSensitive ? Qt::CaseSensitive : Qt::CaseInsensitive;
+
+    QString text(40, QChar('x'));
+    text.replace(position, needle.size(), cs == Qt::CaseSensitive ? needle : needle.toUpper());
+
+    SubstringSearch search(needle, cs);
+    QCOMPARE(search.indexIn(text.constData(), text.size(), 0), position);
+    QCOMPARE(search.indexIn(text.constData(), text.size(), position), position);
+    QCOMPARE(search.indexIn(text.constData(), text.size(), position + 1), -1);
+
+    // The other case only matches insensitively.
+    SubstringSearch upper(needle.toUpper(), cs);
+    QCOMPARE(upper.indexIn(text.constData(), text.size(), 0), cs == Qt::CaseSensitive ? -1 : position);
+}
+
+void tst_SubstringSearch::matchEndsWithinLength()
+{
+    const QString text = QString(20, QChar('x')) + "abcdefghi";
+
+    for(Qt::CaseSensitivity cs : {Qt::CaseSensitive, Qt::CaseInsensitive}) {
+        SubstringSearch search("abcdefghi", cs);
+        QCOMPARE(search.indexIn(text.constData(), text.size(), 0), 20);
+        QCOMPARE(search.indexIn(text.constData(), text.size() - 1, 0), -1);
+        QCOMPARE(search.indexIn(text.constData(), text.size(), 21), -1);
+    }
+}
+
+void tst_SubstringSearch::foldedToAscii_data()
+{
+    QTest::addColumn<QString>("text");
+    QTest::addColumn<QString>("needle");
+    QTest::addColumn<int>("expected");
+
+    // KELVIN SIGN folds to 'k' and LONG S to 's', beside their own ASCII case pair. The
+    // needles starting or ending with them take the scalar path.
+    QString kelvinText = QString(12, QChar('x')) + kelvinSign + QString(12, QChar('x'));
+    QString longSText = QString(7, QChar('x')) + longS + QString(20, QChar('x'));
+    QTest::newRow("k finds KELVIN SIGN") << kelvinText << "k" << 12;
+    QTest::newRow("K finds KELVIN SIGN") << kelvinText << "K" << 12;
+    QTest::newRow("KELVIN SIGN finds k") << "xxxxxxxxxk" << QString(kelvinSign) << 9;
+    QTest::newRow("s finds LONG S") << longSText << "s" << 7;
+    QTest::newRow("S finds LONG S") << longSText << "S" << 7;
+    QTest::newRow("LONG S finds s") << "xxxxxxxxxxxxxxxxS" << QString(longS) << 16;
+
+    QString mixed = QString(15, QChar('x')) + kelvinSign + "abcdef" + longS + QString(9, QChar('x'));
+    QTest::newRow("length 8 across blocks") << mixed << "kabcdefs" << 15;
+    QTest::newRow("length 2, first") << mixed << "KA" << 15;
+    QTest::newRow("length 2, last") << mixed << "fS" << 21;
+    QTest::newRow("length 9") << (QString("xxxxxxx") + longS + "abcdefg" + kelvinSign) << "sabcdefgk" << 7;
+    QTest::newRow("KELVIN SIGN inside") << (QString(9, QChar('x')) + "a" + kelvinSign + "b" + QString(10, QChar('x'))) << "AKB" << 9;
+    QTest::newRow("in the tail") << (QString(30, QChar('x')) + "a" + kelvinSign) << "ak" << 30;
+}
+
+void tst_SubstringSearch::foldedToAscii()
+{
+    QFETCH(QString, text);
+    QFETCH(QString, needle);
+    QFETCH(int, expected);
+
+    SubstringSearch insensitive(needle, Qt::CaseInsensitive);
+    QCOMPARE(insensitive.indexIn(text.constData(), text.size(), 0), expected);
+    QCOMPARE(text.indexOf(needle, 0, Qt::CaseInsensitive), expected);
+
+    SubstringSearch sensitive(needle, Qt::CaseSensitive);
+    QCOMPARE(sensitive.indexIn(text.constData(), text.size(), 0), text.indexOf(needle));
+}
+
+void tst_SubstringSearch::matchesIndexOf()
+{
+    // Mostly characters with case variants, KELVIN SIGN and LONG S among them, and some
+    // anywhere in the BMP. Surrogates are left out, QString folds them as pairs.
+    static const ushort units[] = {'a', 'b', 'A', 'B', 'k', 'K', 's', 'S', 'x', 0x212A, 0x017F, 0x00E1, 0x00C1};
+    auto randomUnit = [](QRandomGenerator& random) {
+        if(random.bounded(4) == 0) {
+            ushort unit = ushort(random.bounded(0x20, 0xFFFE));
+            return QChar(unit >= 0xD800 && unit < 0xE000 ? ushort('y') : unit);
+        }
+        return QChar(units[random.bounded(int(sizeof(units) / sizeof(units[0])))]);
+    };
+
+    runRandomRounds(2000, [&](QRandomGenerator& random) {
+        QString text(int(random.bounded(200)), Qt::Uninitialized);
+        for(QChar& c : text)
+            c = randomUnit(random);
+
+        static const int lengths[] = {1, 2, 8, 9};
+        int length = random.bounded(2) ? lengths[random.bounded(4)] : random.bounded(1, 20);
+        QString needle;
+        if(random.bounded(2) && text.size() >= length) {
+            // Taken from the text, so it matches at least once, in another case half the time.
+            needle = text.mid(random.bounded(text.size() - length + 1), length);
+            if(random.bounded(2))
+                needle = random.bounded(2) ? needle.toUpper() : needle.toLower();
+        }
+        else {
+            for(int i = 0; i < length; ++i)
+                needle += randomUnit(random);
+        }
+
+        Qt::CaseSensitivity cs = random.bounded(2) ? Qt::CaseInsensitive : Qt::CaseSensitive;
+        SubstringSearch search(needle, cs);
+        int from = random.bounded(4) ? 0 : random.bounded(text.size() + 1);
+        QCOMPARE(allMatches(search, text, from), allIndexOf(needle, cs, text, from));
+    });
+}
+
+QTEST_APPLESS_MAIN(tst_SubstringSearch)
+
+#include "tst_substringsearch.moc"
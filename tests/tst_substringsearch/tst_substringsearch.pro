@@ -0,0 +1,11 @@
+# SubstringSearch against QString::indexOf, through the SSE2 filter and the scalar loop.
+include(../tests.pri)
+
+TARGET = tst_substringsearch
+
+HEADERS += \
+    ../../codetextedit/SubstringSearch.h \
+
+SOURCES += \
+    ../../codetextedit/SubstringSearch.cpp \
+    tst_substringsearch.cpp \
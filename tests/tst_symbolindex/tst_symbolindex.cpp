@@ -0,0 +1,205 @@
+/***********************************************************************
+The CodeTextEditor provides an editor showing live hints and annotations.
+
+Copyright (c) 2020 Brian Newham <seaweedsolutionsltd@gmail.com>.
+
+CodeTextEdit is free software dual licensed under the GNU LGPL or MIT License.
+***********************************************************************/
+
+#include <QtTest>
+
+#include "codetextedit/SymbolIndex.h"
+#include "RandomRounds.h"
+
+using namespace codetextedit;
+
+class tst_SymbolIndex : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void defineAndRefer();
+    void unchangedUpdate();
+    void definedTwice();
+    void removeBlock();
+    void emptyUpdateForgetsBlock();
+    void matchesModel();
+
+private:
+    /// The index only keeps the pointers, so any distinct addresses stand in for blocks.
+    BlockData* block(int i) {return reinterpret_cast<BlockData*>(&m_blocks[i]);}
+
+    int m_blocks[8] = {};
+};
+
+static QSet<QString> labels(std::initializer_list<const char*> names)
+{
+    QSet<QString> set;
+    for(const char* name : names)
+        set.insert(name);
+    return set;
+}
+
+void tst_SymbolIndex::defineAndRefer()
+{
+    SymbolIndex index;
+    QSet<QString> changed;
+
+    index.update(block(0), {"LOOP,1"}, {}, changed);
+    QCOMPARE(changed, labels({"LOOP,1"}));
+
+    changed.clear();
+    index.update(block(1), {}, {"LOOP,1", "END,2"}, changed);
+    QVERIFY(changed.isEmpty());
+
+    QCOMPARE(index.definitionCount("LOOP,1"), 1);
+    QCOMPARE(index.definitionCount("END,2"), 0);
+    QCOMPARE(index.definitions("LOOP,1"), QSet<BlockData*>{block(0)});
+    QCOMPARE(index.references("LOOP,1"), QSet<BlockData*>{block(1)});
+    QCOMPARE(index.references("END,2"), QSet<BlockData*>{block(1)});
+    QCOMPARE(index.definedBy(block(0)), QStringList{"LOOP,1"});
+    QCOMPARE(index.referencedBy(block(1)), (QStringList{"LOOP,1", "END,2"}));
+    QVERIFY(index.definedBy(block(2)).isEmpty());
+}
+
+void tst_SymbolIndex::unchangedUpdate()
+{
+    SymbolIndex index;
+    QSet<QString> changed;
+    index.update(block(0), {"A,1"}, {"B,1"}, changed);
+
+    changed.clear();
+    index.update(block(0), {"A,1"}, {"B,1"}, changed);
+    QVERIFY(changed.isEmpty());
+
+    // A new reference alone changes no definitions.
+    index.update(block(0), {"A,1"}, {"B,1", "C,1"}, changed);
+    QVERIFY(changed.isEmpty());
+    QCOMPARE(index.references("C,1"), QSet<BlockData*>{block(0)});
+}
+
+void tst_SymbolIndex::definedTwice()
+{
+    SymbolIndex index;
+    QSet<QString> changed;
+    index.update(block(0), {"A,1", "A,1"}, {}, changed);
+    index.update(block(1), {"A,1"}, {}, changed);
+    QCOMPARE(index.definitionCount("A,1"), 3);
+
+    changed.clear();
+    index.update(block(0), {"A,1"}, {}, changed);
+    QCOMPARE(changed, labels({"A,1"}));
+    QCOMPARE(index.definitionCount("A,1"), 2);
+    QCOMPARE(index.definitions("A,1"), (QSet<BlockData*>{block(0), block(1)}));
+
+    changed.clear();
+    index.update(block(1), {"B,1"}, {}, changed);
+    QCOMPARE(changed, labels({"A,1", "B,1"}));
+    QCOMPARE(index.definitions("A,1"), QSet<BlockData*>{block(0)});
+}
+
+void tst_SymbolIndex::removeBlock()
+{
+    SymbolIndex index;
+    QSet<QString> changed;
+    index.update(block(0), {"A,1"}, {"B,1"}, changed);
+    index.update(block(1), {"B,1"}, {"A,1"}, changed);
+
+    changed.clear();
+    index.remove(block(0), changed);
+    QCOMPARE(changed, labels({"A,1"}));
+    QCOMPARE(index.definitionCount("A,1"), 0);
+    QVERIFY(index.definitions("A,1").isEmpty());
+    QVERIFY(index.references("B,1").isEmpty());
+    QCOMPARE(index.references("A,1"), QSet<BlockData*>{block(1)});
+
+    // Removing a block the index does not know is a no-op.
+    changed.clear();
+    index.remove(block(0), changed);
+    QVERIFY(changed.isEmpty());
+
+    index.clear();
+    QCOMPARE(index.definitionCount("B,1"), 0);
+    QVERIFY(index.definedBy(block(1)).isEmpty());
+}
+
+void tst_SymbolIndex::emptyUpdateForgetsBlock()
+{
+    SymbolIndex index;
+    QSet<QString> changed;
+    index.update(block(0), {"A,1"}, {"B,1"}, changed);
+
+    changed.clear();
+    index.update(block(0), {}, {}, changed);
+    QCOMPARE(changed, labels({"A,1"}));
+    QVERIFY(index.definedBy(block(0)).isEmpty());
+    QVERIFY(index.referencedBy(block(0)).isEmpty());
+    QVERIFY(index.references("B,1").isEmpty());
+}
+
+void tst_SymbolIndex::matchesModel()
+{
+    // The index against a plain map of every block's labels.
+    struct Symbols {QStringList definitions, references;};
+    QHash<int, Symbols> model;
+
+    const QStringList names = {"A,1", "B,1", "C,2"};
+    auto randomLabels = [&names](QRandomGenerator& random) {
+        QStringList list;
+        for(int count = random.bounded(3); count > 0; --count)
+            list.append(names[random.bounded(names.size())]);
+        return list;
+    };
+
+    SymbolIndex index;
+    runRandomRounds(3000, [&](QRandomGenerator& random) {
+        int b = random.bounded(8);
+        Symbols before = model.value(b);
+        Symbols after;
+        QSet<QString> changed;
+
+        if(random.bounded(5) == 0) {
+            index.remove(block(b), changed);
+            model.remove(b);
+        }
+        else {
+            after.definitions = randomLabels(random);
+            after.references = randomLabels(random);
+            index.update(block(b), after.definitions, after.references, changed);
+            if(after.definitions.isEmpty() && after.references.isEmpty())
+                model.remove(b);
+            else
+                model.insert(b, after);
+        }
+
+        QSet<QString> expectedChanged;
+        for(const QString& name : names) {
+            if(before.definitions.count(name) != after.definitions.count(name))
+                expectedChanged.insert(name);
+        }
+        QCOMPARE(changed, expectedChanged);
+
+        for(const QString& name : names) {
+            int count = 0;
+            QSet<BlockData*> definitions, references;
+            for(auto it = model.constBegin(); it != model.constEnd(); ++it) {
+                count += it->definitions.count(name);
+                if(it->definitions.contains(name))
+                    definitions.insert(block(it.key()));
+                if(it->references.contains(name))
+                    references.insert(block(it.key()));
+            }
+            QCOMPARE(index.definitionCount(name), count);
+            QCOMPARE(index.definitions(name), definitions);
+            QCOMPARE(index.references(name), references);
+        }
+        for(int i = 0; i < 8; ++i) {
+            QCOMPARE(index.definedBy(block(i)), model.value(i).definitions);
+            QCOMPARE(index.referencedBy(block(i)), model.value(i).references);
+        }
+    });
+}
+
+QTEST_APPLESS_MAIN(tst_SymbolIndex)
+
+#include "tst_symbolindex.moc"
@@ -0,0 +1,11 @@
+# SymbolIndex bookkeeping and the labels it reports changed.
+include(../tests.pri)
+
+TARGET = tst_symbolindex
+
+HEADERS += \
+    ../../codetextedit/SymbolIndex.h \
+
+SOURCES += \
+    ../../codetextedit/SymbolIndex.cpp \
+    tst_symbolindex.cpp \